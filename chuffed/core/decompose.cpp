@@ -0,0 +1,242 @@
+#include "chuffed/core/engine.h"
+#include "chuffed/core/options.h"
+#include "chuffed/core/propagator.h"
+#include "chuffed/core/sat-types.h"
+#include "chuffed/core/sat.h"
+#include "chuffed/flatzinc/flatzinc.h"
+#include "chuffed/support/union_find.h"
+#include "chuffed/support/vec.h"
+#include "chuffed/vars/int-var.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+// Splits the problem into the components of its constraint graph, once the
+// propagators linking the objective to its terms are left out. This is only
+// done when the objective is a sum of terms, defined by linear constraints
+// that all have the same variables and a unit coefficient on the objective:
+// the objective is then optimal when each component minimises its own part
+// of the sum, so the components can be improved one at a time.
+void Engine::decompose() {
+	auto* fzn = dynamic_cast<FlatZinc::FlatZincSpace*>(problem);
+	if (opt_var == nullptr || opt_var->isFixed() || !so.lazy || so.mip || so.ldsb ||
+			(fzn != nullptr && (fzn->restart_status >= 0 || fzn->enable_on_restart))) {
+		return;
+	}
+	// Only the placeholder for the objective bound may be assumed
+	if (assumptions.size() > 1 || (assumptions.size() == 1 && assumptions[0] != toInt(lit_True))) {
+		return;
+	}
+
+	// Propagators on the objective, which must all be over the same terms
+	vec<bool> cut(propagators.size(), false);
+	vec<int> a;
+	vec<IntVar*> x;
+	vec<IntVar*> terms;
+	for (int i = 0; i < opt_var->pinfo.size(); i++) {
+		Propagator* p = opt_var->pinfo[i].p;
+		if (!p->getLinearTerms(a, x)) {
+			return;
+		}
+		int unit = 0;
+		for (int j = 0; j < x.size(); j++) {
+			if (x[j] == opt_var) {
+				unit += (a[j] == 1 || a[j] == -1) ? 1 : 2;
+			}
+		}
+		if (unit != 1) {
+			return;
+		}
+		std::sort((IntVar**)x, (IntVar**)x + x.size());
+		if (terms.size() == 0) {
+			x.copyTo(terms);
+		} else if (x.size() != terms.size() || !std::equal((IntVar**)x, (IntVar**)x + x.size(),
+																													 (IntVar**)terms)) {
+			return;
+		}
+		cut[p->prop_id] = true;
+	}
+	if (terms.size() == 0) {
+		return;
+	}
+
+	// Vertices are the int vars, the other SAT vars and the propagators. The
+	// literals of an int var stand for it, fixed variables link nothing.
+	const int nv = vars.size();
+	const int ns = sat.nVars();
+	UF<int> uf(nv + ns + propagators.size());
+	auto node = [&](int v) {
+		const ChannelInfo& ci = sat.c_info[v];
+		if (ci.cons_type == 1) {
+			return vars[ci.cons_id]->isFixed() ? -1 : static_cast<int>(ci.cons_id);
+		}
+		if (ci.cons_type == 2) {
+			return nv + ns + static_cast<int>(ci.cons_id);
+		}
+		return sat.value(Lit(v, false)) != l_Undef ? -1 : nv + v;
+	};
+	const int obj = opt_var->var_id;
+	auto objective = [&](int u) { return u == obj || (u >= nv + ns && cut[u - nv - ns]); };
+	auto link = [&](int u, int v) {
+		if (u == -1 || v == -1 || u == v) {
+			return true;
+		}
+		// Only the cut propagators may involve the objective
+		if (objective(u) || objective(v)) {
+			return false;
+		}
+		uf.unite(u, v);
+		return true;
+	};
+
+	for (int i = 0; i < nv; i++) {
+		if (i == obj || vars[i]->isFixed()) {
+			continue;
+		}
+		for (int j = 0; j < vars[i]->pinfo.size(); j++) {
+			const Propagator* p = vars[i]->pinfo[j].p;
+			if (!cut[p->prop_id]) {
+				link(i, nv + ns + p->prop_id);
+			}
+		}
+	}
+	for (int i = 0; i < sat.watches.size(); i++) {
+		const int u = node(var(toLit(i)));
+		for (int j = 0; j < sat.watches[i].size(); j++) {
+			const WatchElem& we = sat.watches[i][j];
+			bool ok = true;
+			switch (we.d.type) {
+				case 1:
+					ok = link(u, node(var(toLit(we.d.d2))));
+					break;
+				case 2:
+					ok = link(u, nv + ns + we.d.d2);
+					break;
+				default:
+					for (int k = 0; k < we.pt->size(); k++) {
+						ok = ok && link(u, node(var((*we.pt)[k])));
+					}
+			}
+			if (!ok) {
+				return;
+			}
+		}
+	}
+
+	// Components of the unfixed variables
+	vec<int> comp(uf.getSize(), -1);
+	auto component = [&](int u) {
+		const int r = uf.find(u);
+		if (comp[r] == -1) {
+			comp[r] = comp_vars.size();
+			comp_vars.push();
+			comp_bools.push();
+		}
+		return comp[r];
+	};
+	for (int i = 0; i < nv; i++) {
+		if (i != obj && !vars[i]->isFixed()) {
+			comp_vars[component(i)].push(vars[i]);
+		}
+	}
+	for (int v = 0; v < ns; v++) {
+		if (sat.c_info[v].cons_type == 0 && node(v) != -1) {
+			comp_bools[component(nv + v)].push(v);
+		}
+	}
+	vec<bool> has_term(comp_vars.size(), false);
+	for (int i = 0; i < terms.size(); i++) {
+		if (terms[i] != opt_var && !terms[i]->isFixed()) {
+			has_term[comp[uf.find(terms[i]->var_id)]] = true;
+		}
+	}
+	for (int c = 0; c < comp_vars.size(); c++) {
+		if (has_term[c]) {
+			opt_comps.push(c);
+		}
+	}
+
+	if (so.verbosity >= 1) {
+		fprintf(stderr, "%% %d independent components, %d with objective terms\n", comp_vars.size(),
+						opt_comps.size());
+	}
+	if (opt_comps.size() < 2) {
+		comp_vars.clear();
+		comp_bools.clear();
+		opt_comps.clear();
+		return;
+	}
+	comp_min.growTo(nv);
+	comp_max.growTo(nv);
+	comp_assigns.growTo(ns);
+}
+
+void Engine::saveComponentSolution() {
+	for (int c = 0; c < comp_vars.size(); c++) {
+		for (int i = 0; i < comp_vars[c].size(); i++) {
+			IntVar* v = comp_vars[c][i];
+			comp_min[v->var_id] = v->getMin();
+			comp_max[v->var_id] = v->getMax();
+		}
+		for (int i = 0; i < comp_bools[c].size(); i++) {
+			const int v = comp_bools[c][i];
+			comp_assigns[v] = sat.assigns[v];
+		}
+	}
+}
+
+// Assumes that component c keeps its values in the best solution
+void Engine::fixComponent(int c) {
+	for (int i = 0; i < comp_vars[c].size(); i++) {
+		IntVar* v = comp_vars[c][i];
+		if (comp_min[v->var_id] > v->getMin()) {
+			assumptions.push(toInt(v->getLit(comp_min[v->var_id], LR_GE)));
+		}
+		if (comp_max[v->var_id] < v->getMax()) {
+			assumptions.push(toInt(v->getLit(comp_max[v->var_id], LR_LE)));
+		}
+	}
+	for (int i = 0; i < comp_bools[c].size(); i++) {
+		const int v = comp_bools[c][i];
+		if (comp_assigns[v] != toInt(l_Undef)) {
+			assumptions.push(toInt(Lit(v, comp_assigns[v] == toInt(l_False))));
+		}
+	}
+}
+
+// Finds any solution, then improves the components with objective terms one
+// at a time, the others being fixed by assumptions. A component is done when
+// the assumptions and the objective bound fail together, and as they are
+// independent, one pass over them is enough.
+RESULT Engine::searchComponents(const std::string& problemLabel) {
+	stop_at_solution = true;
+	RESULT res = search(problemLabel);
+	stop_at_solution = false;
+	if (res != RES_SAT) {
+		return res;
+	}
+	for (int i = 0; i < opt_comps.size(); i++) {
+		if (decisionLevel() != 0) {
+			sat.btToLevel(0);
+		}
+		assumptions.clear();
+		for (int c = 0; c < comp_vars.size(); c++) {
+			if (c != opt_comps[i]) {
+				fixComponent(c);
+			}
+		}
+		// The objective bound goes last, where constrain() updates it
+		assumptions.push(toInt(opt_type != 0 ? opt_var->getLit(best_sol + 1, LR_GE)
+																				 : opt_var->getLit(best_sol - 1, LR_LE)));
+		res = search(problemLabel);
+		if (res != RES_LUN) {
+			break;
+		}
+	}
+	if (decisionLevel() != 0) {
+		sat.btToLevel(0);
+	}
+	assumptions.clear();
+	return res;
+}
@@ -340,6 +340,9 @@ inline bool Engine::constrain() {
 	if (fzn != nullptr) {
 		fzn->storeSolution();
 	}
+	if (comp_vars.size() != 0) {
+		saveComponentSolution();
+	}
 
 	sat.btToLevel(0);
 	restart_count++;
@@ -1045,6 +1048,9 @@ RESULT Engine::search(const std::string& problemLabel) {
 				if (!constrain()) {
 					return RES_GUN;
 				}
+				if (stop_at_solution) {
+					return RES_SAT;
+				}
 				continue;
 			}
 
@@ -1097,6 +1103,10 @@ void Engine::solve(Problem* p, const std::string& problemLabel) {
 
 	init();
 
+	if (so.decompose) {
+		decompose();
+	}
+
 	time_out = chuffed_clock::now() + so.time_out;
 
 	init_time = std::chrono::duration_cast<duration>(chuffed_clock::now() - start_time);
@@ -1125,7 +1135,7 @@ void Engine::solve(Problem* p, const std::string& problemLabel) {
 	}
 
 	// sequential
-	status = search(problemLabel);
+	status = opt_comps.size() != 0 ? searchComponents(problemLabel) : search(problemLabel);
 	if (status == RES_GUN || status == RES_LUN) {
 		if (solutions > 0) {
 			(*output_stream) << "==========\n";
@@ -3,6 +3,7 @@
 
 #include "chuffed/support/misc.h"
 
+#include <cstdint>
 #include <functional>
 #include <random>
 #include <string>
@@ -53,6 +54,15 @@ public:
 	IntVar* last_int;  // Int var last branched on - for impact calculation
 #endif
 
+	// Independent components of a sum objective, improved one at a time
+	vec<vec<IntVar*> > comp_vars;  // Unfixed int vars of each component
+	vec<vec<int> > comp_bools;     // Unfixed Boolean vars of each component
+	vec<int> opt_comps;            // Components with terms in the objective
+	vec<int> comp_min;             // Bounds of the int vars in the best solution
+	vec<int> comp_max;
+	vec<int8_t> comp_assigns;  // Values of the Boolean vars in the best solution
+	bool stop_at_solution{false};
+
 	// Intermediate propagation state
 	vec<IntVar*> v_queue;            // List of changed vars
 	vec<vec<Propagator*> > p_queue;  // Queue of propagators to run
@@ -84,6 +94,12 @@ private:
 	void init();
 	void initMPI();
 
+	// Decomposition
+	void decompose();
+	void saveComponentSolution();
+	void fixComponent(int c);
+	RESULT searchComponents(const std::string& problemLabel);
+
 	// Engine core
 	void newDecisionLevel();
 	void doFixPointStuff();
@@ -10,6 +10,10 @@
 void process_ircs();
 
 void Engine::init() {
+	// Post the deferred cumulative constraints
+
+	cumulative_init();
+
 	// Get the vars ready
 	for (int i = 0; i < vars.size(); i++) {
 		IntVar* v = vars[i];
@@ -256,6 +256,11 @@ void printLongHelp(int& argc, char**& argv, const std::string& fileExt) {
 				 "solution so far. If not possible, "
 				 "     value selection is the user-defined one. (default "
 			<< (def.sbps ? "on" : "off")
+			<< ").\n"
+				 "  --decompose [on|off], --no-decompose\n"
+				 "     When the objective is a sum over independent subproblems, improve each\n"
+				 "     subproblem on its own while the others keep their best values (default "
+			<< (def.decompose ? "on" : "off")
 			<< ").\n"
 				 "\n"
 				 "Learning Options:\n"
@@ -355,6 +360,11 @@ void printLongHelp(int& argc, char**& argv, const std::string& fileExt) {
 				 "  --cumu-global [on|off], --no-cumu-global\n"
 				 "     Use the global cumulative propagator if possible (default "
 			<< (def.cumu_global ? "on" : "off")
+			<< ").\n"
+				 "  --cumu-merge [on|off], --no-cumu-merge\n"
+				 "     Use one multi-resource propagator for cumulative constraints over the same\n"
+				 "     start times and durations (default "
+			<< (def.cumu_merge ? "on" : "off")
 			<< ").\n"
 				 "  --disj-edge-find [on|off], --no-disj-edge-find\n"
 				 "     Use the edge-finding propagator for disjunctive constraints (default "
@@ -363,6 +373,12 @@ void printLongHelp(int& argc, char**& argv, const std::string& fileExt) {
 				 "  --disj-set-bp [on|off], --no-disj-set-bp\n"
 				 "     Use the set bounds propagator for disjunctive constraints (default "
 			<< (def.disj_set_bp ? "on" : "off")
+			<< ").\n"
+				 "  --disj-theta [on|off], --no-disj-theta\n"
+				 "     Use the Theta-Lambda tree propagator (edge finding, not-first/not-last,\n"
+				 "     detectable precedences) for disjunctive constraints instead of the\n"
+				 "     edge-finding and set bounds propagators (default "
+			<< (def.disj_theta ? "on" : "off")
 			<< ").\n"
 				 "  --mdd [on|off], --no-mdd\n"
 				 "     Use the MDD propagator if possible (default "
@@ -398,6 +414,11 @@ void printLongHelp(int& argc, char**& argv, const std::string& fileExt) {
 				 "     (default "
 			<< (def.ldsbad ? "on" : "off")
 			<< ").\n"
+				 "  --sym-detect [on|off], --no-sym-detect\n"
+				 "     Detect interchangeable variables of FlatZinc models, and break their\n"
+				 "     symmetries with the method chosen above (default "
+			<< (def.sym_detect ? "on" : "off")
+			<< ").\n"
 #ifdef HAS_PROFILER
 				 "\n"
 				 "More Profiler Options:\n"
@@ -505,14 +526,20 @@ void parseOptions(int& argc, char**& argv, std::string* fileArg, const std::stri
 			so.sat_polarity = intBuffer;
 		} else if (cop.getBool("--sbps", boolBuffer)) {
 			so.sbps = boolBuffer;
+		} else if (cop.getBool("--decompose", boolBuffer)) {
+			so.decompose = boolBuffer;
 		} else if (cop.getBool("--prop-fifo", boolBuffer)) {
 			so.prop_fifo = boolBuffer;
 		} else if (cop.getBool("--disj-edge-find", boolBuffer)) {
 			so.disj_edge_find = boolBuffer;
 		} else if (cop.getBool("--disj-set-bp", boolBuffer)) {
 			so.disj_set_bp = boolBuffer;
+		} else if (cop.getBool("--disj-theta", boolBuffer)) {
+			so.disj_theta = boolBuffer;
 		} else if (cop.getBool("--cumu-global", boolBuffer)) {
 			so.cumu_global = boolBuffer;
+		} else if (cop.getBool("--cumu-merge", boolBuffer)) {
+			so.cumu_merge = boolBuffer;
 		} else if (cop.getBool("--sat-simplify", boolBuffer)) {
 			so.sat_simplify = boolBuffer;
 		} else if (cop.getBool("--fd-simplify", boolBuffer)) {
@@ -583,6 +610,8 @@ void parseOptions(int& argc, char**& argv, std::string* fileArg, const std::stri
 			so.ldsbta = boolBuffer;
 		} else if (cop.getBool("--ldsbad", boolBuffer)) {
 			so.ldsbad = boolBuffer;
+		} else if (cop.getBool("--sym-detect", boolBuffer)) {
+			so.sym_detect = boolBuffer;
 		} else if (cop.getBool("--well-founded", boolBuffer)) {
 			so.well_founded = boolBuffer;
 		} else if (cop.get("-a")) {
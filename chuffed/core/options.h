@@ -38,6 +38,7 @@ public:
 	int sat_polarity{
 			0};            // Polarity of bool var to choose (0 = default, 1 = same, 2 = anti, 3 = random)
 	bool sbps{false};  // Use Solution-based phase saving
+	bool decompose{false};  // Improve the independent parts of a sum objective one at a time
 
 	// Propagator options
 	bool prop_fifo{false};  // Propagators are queued in FIFO, otherwise LIFO
@@ -45,9 +46,11 @@ public:
 	// Disjunctive propagator options
 	bool disj_edge_find{true};  // Use edge finding
 	bool disj_set_bp{true};     // Use set bounds propagation
+	bool disj_theta{false};     // Use the Theta-Lambda tree propagator
 
 	// Cumulative propagator options
 	bool cumu_global{true};  // Use the global cumulative propagator
+	bool cumu_merge{true};   // Merge cumulative constraints over the same tasks
 
 	// Preprocessing options
 	bool sat_simplify{true};  // Simplify clause database at top level
@@ -105,6 +108,7 @@ public:
 	bool ldsb{false};    // Use lightweight dynamic symmetry breaking 1UIP crippled
 	bool ldsbta{false};  // Use lightweight dynamic symmetry breaking 1UIP
 	bool ldsbad{false};  // Use lightweight dynamic symmetry breaking all decision clause
+	bool sym_detect{false};  // Detect the variable symmetries of FlatZinc models
 
 	// Well founded semantics options
 	bool well_founded;
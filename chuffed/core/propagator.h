@@ -79,6 +79,9 @@ public:
 
 	// Print statistics
 	virtual void printStats() {}
+
+	// Give the terms of the constraint if it is sum a*x >= c
+	virtual bool getLinearTerms(vec<int>& /*a*/, vec<IntVar*>& /*x*/) { return false; }
 };
 
 class Requeueable {
@@ -2,6 +2,8 @@
 #include "chuffed/core/options.h"
 #include "chuffed/core/sat.h"
 #include "chuffed/ldsb/ldsb.h"
+#include "chuffed/ldsb/sym-detect.h"
+#include "chuffed/mdd/opcache.h"
 #include "chuffed/mip/mip.h"
 #include "chuffed/support/misc.h"
 #include "chuffed/vars/int-var.h"
@@ -75,6 +77,22 @@ void Engine::printStats() {
 
 		if (so.ldsb) {
 			printf("%%%%%%mzn-stat: ldsbTime=%.3f\n", to_sec(ldsb.ldsb_time));
+			ldsb.printStats();
+		}
+		if (so.sym_detect) {
+			sym_detect.printStats();
+		}
+		if (so.decompose) {
+			printf("%%%%%%mzn-stat: components=%d\n", comp_vars.size());
+			printf("%%%%%%mzn-stat: objectiveComponents=%d\n", opt_comps.size());
+		}
+		const OpCache::Stats& oc = OpCache::totals;
+		if (oc.hits + oc.misses > 0) {
+			printf("%%%%%%mzn-stat: mddOpCacheHits=%lld\n", oc.hits);
+			printf("%%%%%%mzn-stat: mddOpCacheMisses=%lld\n", oc.misses);
+			printf("%%%%%%mzn-stat: mddOpCacheEvictions=%lld\n", oc.evictions);
+			printf("%%%%%%mzn-stat: mddOpCacheResizes=%lld\n", oc.resizes);
+			printf("%%%%%%mzn-stat: mddOpCachePeakMem=%.2f\n", oc.peak_bytes / 1048576.0);
 		}
 		sat.printStats();
 		/* sat.printLearntStats(); */
@@ -26,6 +26,7 @@
 #define DECOMP 1
 #define USEMDD 2
 #define USEGCC 4
+#define USEGRAMMAR 8
 
 #define DISTINCT_REST
 
@@ -94,7 +95,7 @@ public:
 	vec<vec<IntVar*> > xv;
 	IntVar* cost;
 
-	ShiftSched(int _staff, int _shifts, int _acts, vec<vec<int> >& _demand, int /*mode*/)
+	ShiftSched(int _staff, int _shifts, int _acts, vec<vec<int> >& _demand, int mode)
 			: staff(_staff), shifts(_shifts), acts(_acts), dom(acts + maxG), demand(_demand) {
 		for (int ww = 0; ww < staff; ww++) {
 			xv.push();
@@ -157,21 +158,27 @@ public:
 		//       }
 		//     } else {
 
-		// Construct variables for the circuit
-		MDDTable mdd_tab(shifts);
-		std::vector<std::vector<MDD> > seq;
-		for (int ii = 0; ii < shifts; ii++) {
-			seq.emplace_back();
-			for (int kk = 0; kk < dom; kk++) {
-				seq[ii].push_back(mdd_tab.vareq(ii, kk));
+		if ((mode & USEGRAMMAR) != 0) {
+			for (int ww = 0; ww < staff; ww++) {
+				grammar(xv[ww], g);
 			}
-		}
-		MDD const gcirc(parseCYK(mdd_tab.fff(), seq, g));
+		} else {
+			// Construct variables for the circuit
+			MDDTable mdd_tab(shifts);
+			std::vector<std::vector<MDD> > seq;
+			for (int ii = 0; ii < shifts; ii++) {
+				seq.emplace_back();
+				for (int kk = 0; kk < dom; kk++) {
+					seq[ii].push_back(mdd_tab.vareq(ii, kk));
+				}
+			}
+			MDD const gcirc(parseCYK(mdd_tab.fff(), seq, g));
 
-		// Enforce the schedule for each worker.
-		const MDDOpts opts;
-		for (int ww = 0; ww < staff; ww++) {
-			addMDD(xv[ww], gcirc, opts);
+			// Enforce the schedule for each worker.
+			const MDDOpts opts;
+			for (int ww = 0; ww < staff; ww++) {
+				addMDD(xv[ww], gcirc, opts);
+			}
 		}
 		// }
 
@@ -386,6 +393,13 @@ int main(int argc, char** argv) {
 			}
 			continue;
 		}
+		value = hasPrefix(argv[ii], "-grammar=");
+		if (value != nullptr) {
+			if (strcmp(value, "true") == 0) {
+				mode |= USEGRAMMAR;
+			}
+			continue;
+		}
 
 		argv[jj++] = argv[ii];
 	}
@@ -30,6 +30,7 @@
 #include "chuffed/core/sat.h"
 #include "chuffed/flatzinc/ast.h"
 #include "chuffed/globals/globals.h"
+#include "chuffed/ldsb/sym-detect.h"
 #include "chuffed/primitives/primitives.h"
 #include "chuffed/support/misc.h"
 #include "chuffed/support/vec.h"
@@ -42,10 +43,13 @@
 #include <cstdio>
 #include <exception>
 #include <iostream>
+#include <map>
 #include <ostream>
 #include <random>
+#include <sstream>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace FlatZinc {
 
@@ -197,6 +201,31 @@ void FlatZincSpace::newIntVar(IntVarSpec* vs, const std::string& name) {
 		iv[intVarCount++] = v;
 	}
 	iv_introduced[intVarCount - 1] = considerIntroduced;
+	if (so.sym_detect) {
+		iv_vertex.resize(intVarCount);
+		if (vs->alias) {
+			iv_vertex[intVarCount - 1] = iv_vertex[vs->i];
+		} else if (vs->assigned) {
+			iv_vertex[intVarCount - 1] = -1;
+		} else {
+			// Variables are only exchanged if their declared domains agree
+			std::stringstream ss;
+			ss << "int";
+			if (vs->domain()) {
+				AST::SetLit* sl = vs->domain.some();
+				if (sl->interval) {
+					ss << " " << sl->min << ".." << sl->max;
+				} else {
+					std::vector<int> d = sl->s;
+					std::sort(d.begin(), d.end());
+					for (const int v : d) {
+						ss << " " << v;
+					}
+				}
+			}
+			iv_vertex[intVarCount - 1] = sym_detect.intVertex(iv[intVarCount - 1], ss.str());
+		}
+	}
 }
 
 void FlatZincSpace::newBoolVar(BoolVarSpec* vs) {
@@ -274,6 +303,16 @@ void FlatZincSpace::newBoolVar(BoolVarSpec* vs) {
 		bv[boolVarCount++] = v;
 	}
 	bv_introduced[boolVarCount - 1] = considerIntroduced;
+	if (so.sym_detect) {
+		bv_vertex.resize(boolVarCount);
+		if (vs->alias) {
+			bv_vertex[boolVarCount - 1] = bv_vertex[vs->i];
+		} else if (vs->assigned) {
+			bv_vertex[boolVarCount - 1] = -1;
+		} else {
+			bv_vertex[boolVarCount - 1] = sym_detect.fixedVertex();
+		}
+	}
 }
 
 void FlatZincSpace::newSetVar(SetVarSpec* /*unused*/) {
@@ -282,6 +321,9 @@ void FlatZincSpace::newSetVar(SetVarSpec* /*unused*/) {
 
 void FlatZincSpace::postConstraint(const ConExpr& ce, AST::Node* ann) {
 	try {
+		if (so.sym_detect) {
+			s->symConstraint(ce);
+		}
 		registry().post(ce, ann);
 	} catch (AST::TypeError& e) {
 		throw FlatZinc::Error("Type error", e.what());
@@ -290,6 +332,162 @@ void FlatZincSpace::postConstraint(const ConExpr& ce, AST::Node* ann) {
 	}
 }
 
+// Roles of the arguments of the constraints that do not depend on the order
+// of some of their variables. A digit marks an argument whose elements are
+// taken as a multiset, pooled with the other arguments of the same digit; 'W'
+// is an array of weights for the variables of the 'T' argument after it.
+// Arguments without a role are positional, as are the extra ones of the _reif
+// and _imp forms.
+static std::string symRoles(const std::string& id) {
+	static const std::map<std::string, std::string> roles = {
+			{"int_eq", "00"},
+			{"int_ne", "00"},
+			{"int_plus", "00"},
+			{"int_times", "00"},
+			{"int_min", "00"},
+			{"int_max", "00"},
+			{"bool_eq", "00"},
+			{"bool_ne", "00"},
+			{"bool_and", "00"},
+			{"bool_or", "00"},
+			{"bool_xor", "00"},
+			{"int_lin_eq", "WT"},
+			{"int_lin_ne", "WT"},
+			{"int_lin_le", "WT"},
+			{"int_lin_lt", "WT"},
+			{"int_lin_ge", "WT"},
+			{"int_lin_gt", "WT"},
+			{"bool_lin_eq", "WT"},
+			{"bool_lin_ne", "WT"},
+			{"bool_lin_le", "WT"},
+			{"bool_lin_lt", "WT"},
+			{"bool_lin_ge", "WT"},
+			{"bool_lin_gt", "WT"},
+			{"bool_sum_eq", "0"},
+			{"bool_sum_le", "0"},
+			{"bool_sum_lt", "0"},
+			{"bool_sum_ge", "0"},
+			{"bool_sum_gt", "0"},
+			{"array_bool_and", "0"},
+			{"array_bool_or", "0"},
+			{"bool_clause", "01"},
+			{"all_different_int", "0"},
+			{"fzn_all_different_int", "0"},
+			{"chuffed_array_int_minimum", ".0"},
+			{"chuffed_array_int_maximum", ".0"},
+	};
+	std::string base = id;
+	for (const std::string suffix : {"_reif", "_imp"}) {
+		if (base.size() > suffix.size() &&
+				base.compare(base.size() - suffix.size(), suffix.size(), suffix) == 0) {
+			base.resize(base.size() - suffix.size());
+		}
+	}
+	auto it = roles.find(base);
+	return it == roles.end() ? "" : it->second;
+}
+
+int FlatZincSpace::symVertex(AST::Node* n, std::string& constant) const {
+	if (n->isIntVar()) {
+		const int i = n->getIntVar();
+		if (iv_vertex[i] >= 0) {
+			return iv_vertex[i];
+		}
+		constant = std::to_string(iv[i]->getMin());
+	} else if (n->isBoolVar()) {
+		const int i = n->getBoolVar();
+		if (bv_vertex[i] >= 0) {
+			return bv_vertex[i];
+		}
+		constant = bv[i].isTrue() ? "true" : "false";
+	} else if (n->isInt()) {
+		constant = std::to_string(n->getInt());
+	} else if (n->isBool()) {
+		constant = n->getBool() ? "true" : "false";
+	} else if (n->isSet()) {
+		AST::SetLit* sl = n->getSet();
+		std::stringstream ss;
+		if (sl->interval) {
+			ss << sl->min << ".." << sl->max;
+		} else {
+			std::vector<int> d = sl->s;
+			std::sort(d.begin(), d.end());
+			ss << "{";
+			for (const int v : d) {
+				ss << v << ",";
+			}
+			ss << "}";
+		}
+		constant = ss.str();
+	} else {
+		std::stringstream ss;
+		n->print(ss);
+		constant = ss.str();
+	}
+	return -1;
+}
+
+// The constraint is a vertex coloured by its name and constant arguments,
+// linked to each of its variables through a vertex coloured by the role of
+// the variable in the constraint
+void FlatZincSpace::symConstraint(const ConExpr& ce) {
+	if (ce.id == "variables_interchange" || ce.id == "values_interchange" ||
+			ce.id == "variables_sequences" || ce.id == "values_sequences") {
+		return;
+	}
+	const std::string roles = symRoles(ce.id);
+	std::stringstream colour;
+	colour << ce.id;
+	std::vector<std::pair<int, std::string> > occs;
+	std::string constant;
+	for (unsigned int k = 0; k < ce.args->a.size(); k++) {
+		const char role = k < roles.size() ? roles[k] : '.';
+		if (role == 'W') {
+			continue;
+		}
+		std::vector<AST::Node*> elems;
+		if (ce[k]->isArray()) {
+			elems = ce[k]->getArray()->a;
+		} else {
+			elems.push_back(ce[k]);
+		}
+		colour << "|" << elems.size();
+		for (unsigned int j = 0; j < elems.size(); j++) {
+			std::stringstream label;
+			if (role == 'T') {
+				label << "*" << ce[k - 1]->getArray()->a[j]->getInt();
+			} else if (role == '.') {
+				label << k << "." << j;
+			} else {
+				label << "g" << role;
+			}
+			const int v = symVertex(elems[j], constant);
+			if (v >= 0) {
+				occs.emplace_back(v, label.str());
+			} else if (role == '.') {
+				colour << "|" << label.str() << "=" << constant;
+			} else {
+				occs.emplace_back(-1, label.str() + "=" + constant);
+			}
+		}
+	}
+	const int c = sym_detect.vertex(colour.str());
+	for (const auto& occ : occs) {
+		const int o = sym_detect.vertex(ce.id + "/" + occ.second);
+		sym_detect.addEdge(c, o);
+		if (occ.first >= 0) {
+			sym_detect.addEdge(o, occ.first);
+		}
+	}
+}
+
+void FlatZincSpace::detectSymmetries(int objective) {
+	if (objective >= 0 && iv_vertex[objective] >= 0) {
+		sym_detect.isolate(iv_vertex[objective]);
+	}
+	sym_detect.detect();
+}
+
 // Parsing the 'int_search' annotation and setting up the branching for it
 void FlatZincSpace::parseSolveAnnIntSearch(AST::Node* elemAnn, BranchGroup* branching,
 																					 int& nbNonEmptySearchAnnotations) {
@@ -604,18 +802,27 @@ void FlatZincSpace::fixAllSearch() {
 void FlatZincSpace::solve(AST::Array* ann) {
 	parseSolveAnn(ann);
 	fixAllSearch();
+	if (so.sym_detect) {
+		detectSymmetries(-1);
+	}
 }
 
 void FlatZincSpace::minimize(int var, AST::Array* ann) {
 	parseSolveAnn(ann);
 	optimize(iv[var], OPT_MIN);
 	fixAllSearch();
+	if (so.sym_detect) {
+		detectSymmetries(var);
+	}
 }
 
 void FlatZincSpace::maximize(int var, AST::Array* ann) {
 	parseSolveAnn(ann);
 	optimize(iv[var], OPT_MAX);
 	fixAllSearch();
+	if (so.sym_detect) {
+		detectSymmetries(var);
+	}
 }
 
 void FlatZincSpace::setOutputElem(AST::Node* ai) const {
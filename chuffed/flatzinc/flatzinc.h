@@ -305,6 +305,9 @@ public:
 	vec<BoolView> bv;
 	/// Indicates whether a Boolean variable is introduced by mzn2fzn
 	std::vector<bool> bv_introduced;
+	/// Vertices of the variables in the symmetry detection graph (-1 for constants)
+	std::vector<int> iv_vertex;
+	std::vector<int> bv_vertex;
 
 	vec<BoolView> assumptions;
 
@@ -365,6 +368,12 @@ public:
 
 	/// Post a constraint specified by \a ce
 	static void postConstraint(const ConExpr& ce, AST::Node* annotation);
+	/// Add a constraint to the symmetry detection graph
+	void symConstraint(const ConExpr& ce);
+	/// Vertex of the variable at \a n, or -1 with its value in \a constant
+	int symVertex(AST::Node* n, std::string& constant) const;
+	/// Detect the symmetries of the model, which must fix \a objective (or -1)
+	void detectSymmetries(int objective);
 
 	/// Post the solve item
 	void solve(AST::Array* annotation);
@@ -29,6 +29,7 @@
 #include "chuffed/globals/globals.h"
 #include "chuffed/globals/mddglobals.h"
 #include "chuffed/ldsb/ldsb.h"
+#include "chuffed/mdd/CFG.h"
 #include "chuffed/mdd/opts.h"
 #include "chuffed/primitives/primitives.h"
 #include "chuffed/support/misc.h"
@@ -36,6 +37,7 @@
 #include "chuffed/vars/bool-view.h"
 #include "chuffed/vars/int-var.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <list>
@@ -157,6 +159,20 @@ std::list<std::string> getCumulativeOptions(AST::Node* ann) {
 				opt.emplace_back("ttef_filt_off");
 			}
 		}
+		if (ann->hasCall("ttef_tree")) {
+			if (ann->getCall("ttef_tree")->args->getBool()) {
+				opt.emplace_back("ttef_tree_on");
+			} else {
+				opt.emplace_back("ttef_tree_off");
+			}
+		}
+		if (ann->hasCall("er_check")) {
+			if (ann->getCall("er_check")->args->getBool()) {
+				opt.emplace_back("er_check_on");
+			} else {
+				opt.emplace_back("er_check_off");
+			}
+		}
 		if (ann->hasCall("name")) {
 			opt.push_back("__name__" + ann->getCall("name")->args->getString());
 		}
@@ -686,6 +702,40 @@ void p_regular(const ConExpr& ce, AST::Node* ann) {
 	}
 }
 
+void p_grammar(const ConExpr& ce, AST::Node* /*ann*/) {
+	vec<IntVar*> iv;
+	arg2intvarargs(iv, ce[0]);
+	const int nv = ce[1]->getInt();
+	const int start = ce[2]->getInt();
+	vec<int> bin;
+	arg2intargs(bin, ce[3]);
+	vec<int> term;
+	arg2intargs(term, ce[4]);
+	assert(bin.size() % 3 == 0 && term.size() % 2 == 0);
+	assert(start >= 1 && start <= nv);
+
+	// Nonterminals are 1..nv, terminals are the values of x
+	int alphsz = 0;
+	for (int i = 0; i < term.size(); i += 2) {
+		if (term[i + 1] < 0) {
+			CHUFFED_ERROR("Negative terminal %d in grammar\n", term[i + 1]);
+		}
+		alphsz = std::max(alphsz, term[i + 1] + 1);
+	}
+	CFG::CFG g(alphsz);
+	for (int v = 0; v < nv; v++) {
+		g.var(v);
+	}
+	g.setStart(g.var(start - 1));
+	for (int i = 0; i < bin.size(); i += 3) {
+		g.prod(g.var(bin[i] - 1), CFG::E() << g.var(bin[i + 1] - 1) << g.var(bin[i + 2] - 1));
+	}
+	for (int i = 0; i < term.size(); i += 2) {
+		g.prod(g.var(term[i] - 1), CFG::E() << term[i + 1]);
+	}
+	grammar(iv, g);
+}
+
 void p_cost_regular(const ConExpr& ce, AST::Node* ann) {
 	vec<IntVar*> iv;
 	arg2intvarargs(iv, ce[0]);
@@ -699,21 +749,13 @@ void p_cost_regular(const ConExpr& ce, AST::Node* ann) {
 
 	assert(d_flat.size() == q * s);
 
+	// The weighted DFA is indexed from 0: row i holds state i+1, column j value
+	// j+1, and a destination of 0 is the dead state.
 	vec<vec<int> > d;
 	vec<vec<int> > w;
-	// State 0 is garbage
-	d.push();
-	for (int j = 0; j <= s; j++) {
-		d.last().push(0);
-		w.last().push(0);
-	}
-	// Fill in the remaining transitions
 	for (int i = 0; i < q; i++) {
 		d.push();
 		w.push();
-		// Values start from 1, so [x = 0] goes to garbage.
-		d.last().push(0);
-		w.last().push(0);
 		for (int j = 0; j < s; j++) {
 			d.last().push(d_flat[i * s + j]);
 			w.last().push(w_flat[i * s + j]);
@@ -735,7 +777,7 @@ void p_cost_regular(const ConExpr& ce, AST::Node* ann) {
 
 	IntVar* cost = getIntVar(ce[7]);
 
-	wmdd_cost_regular(iv, q + 1, s + 1, d, w, q0, f, cost, getMDDOpts(ann));
+	wmdd_cost_regular(iv, q, s, d, w, q0, f, cost, getMDDOpts(ann));
 }
 
 void p_disjunctive(const ConExpr& ce, AST::Node* /*ann*/) {
@@ -806,6 +848,15 @@ void p_circuit(const ConExpr& ce, AST::Node* /*ann*/) {
 	circuit(x, index_offset);
 }
 
+void p_circuit_cost(const ConExpr& ce, AST::Node* /*ann*/) {
+	vec<IntVar*> x;
+	arg2intvarargs(x, ce[0]);
+	vec<int> w;
+	arg2intargs(w, ce[1]);
+	const int index_offset = ce[3]->getInt();
+	circuit_cost(x, w, getIntVar(ce[2]), index_offset);
+}
+
 void p_subcircuit(const ConExpr& ce, AST::Node* /*ann*/) {
 	vec<IntVar*> x;
 	arg2intvarargs(x, ce[0]);
@@ -1450,7 +1501,7 @@ void p_mst_new(const ConExpr& ce, AST::Node* /*ann*/) {
 	vec<int> to;
 	arg2intargs(to, ce[3]);
 	vec<int> ws;
-	arg2intargs(to, ce[4]);
+	arg2intargs(ws, ce[4]);
 	vec<BoolView> vs;
 	arg2BoolVarArgs(vs, ce[5]);
 	vec<BoolView> es;
@@ -1927,11 +1978,13 @@ public:
 		registry().add("chuffed_table_int", &p_table_int);
 		registry().add("chuffed_regular", &p_regular);
 		registry().add("chuffed_cost_regular", &p_cost_regular);
+		registry().add("chuffed_grammar", &p_grammar);
 		registry().add("chuffed_disjunctive_strict", &p_disjunctive);
 		registry().add("chuffed_cumulative", &p_cumulative);
 		registry().add("chuffed_cumulative_vars", &p_cumulative2);
 		registry().add("chuffed_cumulative_cal", &p_cumulative_cal);
 		registry().add("chuffed_circuit", &p_circuit);
+		registry().add("chuffed_circuit_cost", &p_circuit_cost);
 		registry().add("chuffed_subcircuit", &p_subcircuit);
 		registry().add("chuffed_array_int_minimum", &p_minimum);
 		registry().add("chuffed_array_int_maximum", &p_maximum);
@@ -401,9 +401,6 @@ public:
 };
 
 struct Node {
-	// for Edmonds-Karp var nodes, BFS queue link, to var node, <0 end
-	// for Edmonds-Karp val nodes, back link in augmenting path, to var
-	// (isn't needed for var nodes as only possible back link is match)
 	// for Tarjan, stack link, <0 end, <sz var, otherwise sz+val
 	int next;
 
@@ -417,10 +414,20 @@ struct Node {
 	int scc;  // root of SCC, <0 stacked, <sz var, otherwise sz+val
 	bool leak;
 
-	// for Edmonds-Karp, protects BFS, for Tarjan, protects DFS
-	bool mark;
+	// for Tarjan, protects DFS, visited iff equal to the current visit stamp
+	int mark;
 };
 
+// Domain consistent alldiff, with the following incremental machinery:
+//
+// - The domain of each var is mirrored into a trailed bitset row, so that
+//   matching and SCC searches can skip already visited values a word at a time.
+// - The vars are partitioned into trailed blocks.  After each run every Hall
+//   set found by Tarjan becomes its own block, since no var outside it can
+//   take its values any more, and the remaining (leaking) vars form another
+//   block.  A wakeup only re-runs Hopcroft-Karp matching repair and Tarjan on
+//   the blocks whose rows actually changed, so fixed vars and untouched Hall
+//   sets are never looked at again in this subtree.
 template <int U = 0>
 class AllDiffDomain : public Propagator, public Checker {
 public:
@@ -432,24 +439,74 @@ public:
 	Node* var_nodes;
 	Node* val_nodes;
 
-	// Edmonds-Karp
-	int queue;
-	int* queue_tail;
+	// Bitset adjacency, row i holds the values still in the domain of x[i]
+	const int words;
+	uint64_t* adj;
+
+	// Partition of the vars into independent blocks, each block is a range of
+	// positions in order[], order[] is only permuted inside a block
+	int* order;
+	Tint* block_of;   // start position of the block of each var
+	Tint* block_end;  // end position of each block, indexed by start position
+	bool initialised{false};
+
+	// Intermediate state
+	vec<int> dirty;
+	vec<int> dirty_blocks;
+	int* block_stamp;
+	int prop_stamp{0};
+
+	// Hopcroft-Karp
+	int* dist;
+	uint64_t* seen;
+	vec<int> queue;
+	int free_len;
 
 	// Tarjan
 	int index;
 	int stack;  // top of stack, <0 end, <sz var, otherwise sz+val
+	int visit_stamp{0};
+	vec<int> scc_roots;
+	vec<int> new_order;
+	vec<int> splits;
 
 	// extension to Tarjan for Hall set detection
 	bool* scoreboard;
 
-	AllDiffDomain(vec<IntView<U> > _x, int _range) : sz(_x.size()), x(_x.release()), range(_range) {
+	AllDiffDomain(vec<IntView<U> > _x, int _range)
+			: sz(_x.size()), x(_x.release()), range(_range), words((_range + 63) / 64) {
 		var_nodes = new Node[sz + range];
 		val_nodes = var_nodes + sz;
 		for (int i = 0; i < sz + range; ++i) {
 			var_nodes[i].match.v = -1;
+			var_nodes[i].mark = 0;
+		}
+
+		// Rows start out full, the first propagation shrinks them to the domains
+		adj = new uint64_t[sz * words];
+		for (int i = 0; i < sz; ++i) {
+			for (int k = 0; k < words; ++k) {
+				adj[i * words + k] = ~static_cast<uint64_t>(0);
+			}
+			if ((range % 64) != 0) {
+				adj[i * words + words - 1] = (static_cast<uint64_t>(1) << (range % 64)) - 1;
+			}
+		}
+
+		order = new int[sz];
+		block_of = new Tint[sz];
+		block_end = new Tint[sz];
+		block_stamp = new int[sz];
+		for (int i = 0; i < sz; ++i) {
+			order[i] = i;
+			block_of[i].v = 0;
+			block_end[i].v = sz;
+			block_stamp[i] = 0;
 		}
 
+		dist = new int[sz];
+		seen = new uint64_t[words];
+
 		priority = 5;
 		for (int i = 0; i < sz; i++) {
 			x[i].attach(this, i, EVENT_C);
@@ -460,89 +517,228 @@ public:
 	}
 
 	void wakeup(int i, int /*c*/) override {
-		const int j = var_nodes[i].match;
-		if (j >= 0 && !x[i].indomain(j)) {
-			var_nodes[i].match = -1;
-			val_nodes[j].match = -1;
-		}
+		dirty.push(i);
 		pushInQueue();
 	}
 
-	bool propagate() override {
-		// fprintf(stderr, "AllDiffDomain::propagate()\n");
-		//  Edmonds-Karp, loop to find and augment a path
-		while (true) {
-			int var;
-			int val;
-
-			// visit source
-			queue_tail = &queue;
-			for (int i = 0; i < sz; ++i) {
-				if (var_nodes[i].match < 0) {
-					*queue_tail = i;
-					queue_tail = &var_nodes[i].next;
+	// Bring row i in line with the domain of x[i], return whether it changed
+	bool syncRow(int i) {
+		bool changed = false;
+		const int min = x[i].getMin();
+		const int max = x[i].getMax();
+		uint64_t* row = adj + i * words;
+		for (int k = 0; k < words; ++k) {
+			uint64_t w = row[k];
+			if (w == 0) {
+				continue;
+			}
+			const uint64_t old = w;
+			if (64 * k + 63 < min || 64 * k > max) {
+				w = 0;
+			} else {
+				for (uint64_t todo = w; todo != 0; todo &= todo - 1) {
+					const int b = lowestBit(todo);
+					if (!x[i].indomain(64 * k + b)) {
+						w &= ~(static_cast<uint64_t>(1) << b);
+					}
 				}
 			}
-			*queue_tail = -1;
-			for (int i = 0; i < range; ++i) {
-				val_nodes[i].mark = false;
+			if (w != old) {
+				trailChange(row[k], w);
+				changed = true;
 			}
+		}
+		return changed;
+	}
 
-			// visit vars, also subsume visit of vals
-			while (queue >= 0) {
-				queue_tail = &queue;
-				for (var = queue; var >= 0; var = var_nodes[var].next) {
-					for (typename IntView<U>::iterator i = x[var].begin(); i != x[var].end(); ++i) {
-						val = *i;
-						if (!val_nodes[val].mark) {
-							assert(val != var_nodes[var].match);
-							const int next_var = val_nodes[val].match;
-							if (next_var < 0) {
-								goto augment;
-							}
+	bool inRow(int i, int val) const {
+		return ((adj[i * words + (val >> 6)] >> (val & 63)) & 1) != 0;
+	}
 
-							val_nodes[val].mark = true;
-							val_nodes[val].next = var;
-							*queue_tail = next_var;
-							queue_tail = &var_nodes[next_var].next;
-						}
-					}
+	void markBlock(int start) {
+		if (block_stamp[start] != prop_stamp) {
+			block_stamp[start] = prop_stamp;
+			dirty_blocks.push(start);
+		}
+	}
+
+	bool propagate() override {
+		// fprintf(stderr, "AllDiffDomain::propagate()\n");
+		++prop_stamp;
+		if (!initialised) {
+			initialised = true;
+			for (int i = 0; i < sz; ++i) {
+				syncRow(i);
+			}
+			if (sz > 0) {
+				markBlock(0);
+			}
+		} else {
+			for (int i = 0; i < dirty.size(); ++i) {
+				const int var = dirty[i];
+				if (!syncRow(var)) {
+					continue;
+				}
+				const int j = var_nodes[var].match;
+				if (j >= 0 && !inRow(var, j)) {
+					var_nodes[var].match = -1;
+					val_nodes[j].match = -1;
 				}
-				*queue_tail = -1;
+				markBlock(block_of[var]);
+			}
+		}
+
+		for (int i = 0; i < dirty_blocks.size(); ++i) {
+			const int start = dirty_blocks[i];
+			const int end = block_end[start];
+			if (end - start == 1 && x[order[start]].isFixed() && var_nodes[order[start]].match >= 0) {
+				continue;  // entailed
+			}
+			match(start, end);
+			if (!scc(start, end)) {
+				return false;
 			}
+		}
 
-			// no more augmenting paths
-			break;
+		return true;
+	}
 
-		augment:
-			// found an augmenting path
-			while (true) {
-				const int parent_val = var_nodes[var].match;
-				val_nodes[val].match = var;
-				var_nodes[var].match = val;
-				if (parent_val < 0) {
-					break;
+	void clearPropState() override {
+		in_queue = false;
+		dirty.clear();
+		dirty_blocks.clear();
+	}
+
+	// Hopcroft-Karp, repair the matching of the vars in a block.  Blocks are
+	// closed, so augmenting paths never leave the block.
+	void match(int start, int end) {
+		while (layer(start, end)) {
+			for (int p = start; p < end; ++p) {
+				const int var = order[p];
+				if (var_nodes[var].match < 0) {
+					augment(var);
 				}
-				val = parent_val;
-				var = val_nodes[val].next;
 			}
 		}
 		// fprintf(stderr, "match");
 		// for (int i = 0; i < sz; ++i)
 		//  fprintf(stderr, " %d", var_nodes[i].match);
 		// fprintf(stderr, "\n");
+	}
+
+	// BFS from the unmatched vars, computes the layers of the alternating paths
+	// and returns whether some free value can be reached
+	bool layer(int start, int end) {
+		queue.clear();
+		for (int p = start; p < end; ++p) {
+			const int var = order[p];
+			if (var_nodes[var].match < 0) {
+				dist[var] = 0;
+				queue.push(var);
+			} else {
+				dist[var] = INT_MAX;
+			}
+		}
+		if (queue.size() == 0) {
+			return false;
+		}
+		memset(seen, 0, words * sizeof(uint64_t));
+		free_len = INT_MAX;
+		for (int q = 0; q < queue.size(); ++q) {
+			const int var = queue[q];
+			if (dist[var] >= free_len) {
+				break;
+			}
+			const uint64_t* row = adj + var * words;
+			for (int k = 0; k < words; ++k) {
+				for (uint64_t w = row[k] & ~seen[k]; w != 0; w &= w - 1) {
+					const int val = 64 * k + lowestBit(w);
+					seen[k] |= static_cast<uint64_t>(1) << (val & 63);
+					const int next_var = val_nodes[val].match;
+					if (next_var < 0) {
+						free_len = dist[var];
+					} else if (dist[next_var] == INT_MAX) {
+						dist[next_var] = dist[var] + 1;
+						queue.push(next_var);
+					}
+				}
+			}
+		}
+		return free_len != INT_MAX;
+	}
+
+	// DFS along the layers, augments along a shortest path if one is found
+	bool augment(int var) {
+		const uint64_t* row = adj + var * words;
+		for (int k = 0; k < words; ++k) {
+			for (uint64_t w = row[k]; w != 0; w &= w - 1) {
+				const int val = 64 * k + lowestBit(w);
+				const int next_var = val_nodes[val].match;
+				if (next_var < 0 ? dist[var] == free_len
+												 : dist[next_var] == dist[var] + 1 && augment(next_var)) {
+					var_nodes[var].match = val;
+					val_nodes[val].match = var;
+					return true;
+				}
+			}
+		}
+		dist[var] = INT_MAX;
+		return false;
+	}
 
+	// Tarjan over a block, prunes edges between SCCs and splits the block so
+	// that each Hall set found gets a block of its own
+	bool scc(int start, int end) {
 		index = 0;
 		stack = -1;
-		for (int i = 0; i < sz + range; ++i) {
-			var_nodes[i].mark = false;
-		}
-		for (int i = 0; i < sz; ++i) {
-			if (!var_nodes[i].mark && !tarjan(i)) {
+		++visit_stamp;
+		scc_roots.clear();
+		for (int p = start; p < end; ++p) {
+			const int var = order[p];
+			if (var_nodes[var].mark != visit_stamp && !tarjan(var)) {
 				return false;
 			}
 		}
 
+		// Hall sets first, one block each, then all leaking vars in one block
+		new_order.clear();
+		splits.clear();
+		for (int i = 0; i < scc_roots.size(); ++i) {
+			const int root = scc_roots[i];
+			if (var_nodes[root].leak) {
+				continue;
+			}
+			for (int j = root; j >= 0; j = var_nodes[j].next) {
+				if (j < sz) {
+					new_order.push(j);
+				}
+			}
+			splits.push(start + new_order.size());
+		}
+		for (int p = start; p < end; ++p) {
+			if (var_nodes[order[p]].leak) {
+				new_order.push(order[p]);
+			}
+		}
+		if (splits.size() == 0 || splits.last() != end) {
+			splits.push(end);
+		}
+		assert(new_order.size() == end - start);
+
+		int block = start;
+		for (int i = 0; i < splits.size(); ++i) {
+			if (block_end[block] != splits[i]) {
+				block_end[block] = splits[i];
+			}
+			for (int p = block; p < splits[i]; ++p) {
+				const int var = new_order[p - start];
+				order[p] = var;
+				if (block_of[var] != block) {
+					block_of[var] = block;
+				}
+			}
+			block = splits[i];
+		}
 		return true;
 	}
 
@@ -587,11 +783,16 @@ public:
 			}
 			memset(scoreboard + min_val, 0, max_val + 1 - min_val);
 		}
-		return x[node].remVal(i, r);
+		if (!x[node].remVal(i, r)) {
+			return false;
+		}
+		uint64_t& w = adj[node * words + (i >> 6)];
+		trailChange(w, w & ~(static_cast<uint64_t>(1) << (i & 63)));
+		return true;
 	}
 
 	bool tarjan(int node) {
-		var_nodes[node].mark = true;
+		var_nodes[node].mark = visit_stamp;
 
 		const int index_save = index++;
 		var_nodes[node].index = index_save;
@@ -602,18 +803,22 @@ public:
 
 		var_nodes[node].leak = false;
 		if (node < sz) {
-			// visiting var node
-			for (typename IntView<U>::iterator i = x[node].begin(); i != x[node].end();) {
-				const int val = *i++;
-				if (!val_nodes[val].mark && !tarjan(sz + val)) {
-					return false;
-				}
-				if (val_nodes[val].scc < 0) {
-					var_nodes[node].index = std::min(var_nodes[node].index, val_nodes[val].index);
-				} else if (!val_nodes[val].leak && !prune(node, val)) {
-					return false;
+			// visiting var node, iterate over a copy of each word as pruning
+			// clears bits of the row
+			const uint64_t* row = adj + node * words;
+			for (int k = 0; k < words; ++k) {
+				for (uint64_t w = row[k]; w != 0; w &= w - 1) {
+					const int val = 64 * k + lowestBit(w);
+					if (val_nodes[val].mark != visit_stamp && !tarjan(sz + val)) {
+						return false;
+					}
+					if (val_nodes[val].scc < 0) {
+						var_nodes[node].index = std::min(var_nodes[node].index, val_nodes[val].index);
+					} else if (!val_nodes[val].leak && !prune(node, val)) {
+						return false;
+					}
+					var_nodes[node].leak |= val_nodes[val].leak;
 				}
-				var_nodes[node].leak |= val_nodes[val].leak;
 			}
 		} else {
 			// visiting val node
@@ -621,7 +826,7 @@ public:
 			if (var < 0) {
 				var_nodes[node].leak = true;  // unassigned value
 			} else {
-				if (!var_nodes[var].mark && !tarjan(var)) {
+				if (var_nodes[var].mark != visit_stamp && !tarjan(var)) {
 					return false;
 				}
 				if (var_nodes[var].scc < 0) {
@@ -636,10 +841,11 @@ public:
 			const int scc = stack;
 			stack = var_nodes[node].next;
 			var_nodes[node].next = -1;
+			scc_roots.push(scc);
 
 			// fprintf(stderr, "leak %d\n", leak);
 			for (int i = scc; i >= 0; i = var_nodes[i].next) {
-				assert(var_nodes[i].mark);
+				assert(var_nodes[i].mark == visit_stamp);
 				var_nodes[i].leak = (leak != 0);  // propagate through SCC
 				var_nodes[i].scc = scc;           // propagate through SCC
 																					// if (i < sz)
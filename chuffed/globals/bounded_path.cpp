@@ -49,29 +49,20 @@
 
 void BoundedPathPropagator::constructGraph(vec<vec<edge_id> >& _in, vec<vec<edge_id> >& _out,
 																					 vec<vec<int> >& /*en*/) {
-	adj = std::vector<std::vector<int> >(_in.size(), std::vector<int>());
+	std::vector<std::vector<int> > _adj(_in.size(), std::vector<int>());
 	for (int i = 0; i < _in.size(); i++) {
 		for (int j = 0; j < _in[i].size(); j++) {
-			adj[i].push_back(_in[i][j]);
+			_adj[i].push_back(_in[i][j]);
 		}
 		for (int j = 0; j < _out[i].size(); j++) {
-			adj[i].push_back(_out[i][j]);
+			_adj[i].push_back(_out[i][j]);
 		}
 	}
+	adj = CSRLists(_adj);
 
-	in = std::vector<std::vector<int> >(nbNodes(), std::vector<int>());
-	for (int i = 0; i < _in.size(); i++) {
-		for (int j = 0; j < _in[i].size(); j++) {
-			in[i].push_back(_in[i][j]);
-		}
-	}
-
-	ou = std::vector<std::vector<int> >(nbNodes(), std::vector<int>());
-	for (int i = 0; i < _out.size(); i++) {
-		for (int j = 0; j < _out[i].size(); j++) {
-			ou[i].push_back(_out[i][j]);
-		}
-	}
+	in = CSRLists(_in);
+	ou = CSRLists(_out);
+	graph = CSRGraph(endnodes, in, ou);
 
 	nodes2edge = std::vector<std::vector<int> >(nbNodes());
 	for (int i = 0; i < nbNodes(); i++) {
@@ -207,34 +198,23 @@ BoundedPathPropagator::BoundedPathPropagator(int _s, int _d, vec<BoolView>& _vs,
 	constructGraph(_in, _out, _en);
 	constructWeights(_ws, _w);
 
-	std::vector<std::vector<int> > en(nbEdges(), std::vector<int>());
-	for (int i = 0; i < _en.size(); i++) {
-		for (int j = 0; j < _en[i].size(); j++) {
-			en[i].push_back(_en[i][j]);
-		}
-	}
-
 	std::vector<int> weights(nbEdges(), -1);
 	for (int i = 0; i < nbEdges(); i++) {
 		weights[i] = ws[i];
 	}
-	kosaraju = new FilteredKosarajuSCC(this, nbNodes(), ou, in, en);
+	kosaraju = new FilteredKosarajuSCC(this, graph);
 
-	forward_sp = new FilteredDijkstra(this, source, en, in, ou, weights);
-	explain_sp = new ExplainerDijkstra(this, source, en, in, ou, weights);
-	mandatory_explainer_sp = new ExplainerDijkstraMandatory(this, source, dest, en, in, ou, weights);
+	forward_sp = new FilteredDijkstra(this, source, graph, weights);
+	explain_sp = new ExplainerDijkstra(this, source, graph, weights);
+	mandatory_explainer_sp = new ExplainerDijkstraMandatory(this, source, dest, graph, weights);
 	mandatory_explainer_sp->init();
 
-	for (int i = 0; i < nbEdges(); i++) {
-		const int tmp = en[i][0];
-		en[i][0] = en[i][1];
-		en[i][1] = tmp;
-	}
-	backward_sp = new FilteredDijkstra(this, dest, en, ou, in, weights);
-	backward_sp_tmp = new FilteredDijkstra(this, dest, en, ou, in, weights);
-	mandatory_sp = new FilteredDijkstraMandatory(this, dest, source, en, ou, in, weights);
+	const CSRGraph rgraph = graph.reversed();
+	backward_sp = new FilteredDijkstra(this, dest, rgraph, weights);
+	backward_sp_tmp = new FilteredDijkstra(this, dest, rgraph, weights);
+	mandatory_sp = new FilteredDijkstraMandatory(this, dest, source, rgraph, weights);
 	mandatory_sp->init();
-	initial_mandatory_sp = new FilteredDijkstraMandatory(this, dest, source, en, ou, in, weights);
+	initial_mandatory_sp = new FilteredDijkstraMandatory(this, dest, source, rgraph, weights);
 	initial_mandatory_sp->init();
 
 	rootLevelPropagation();
@@ -263,36 +243,25 @@ BoundedPathPropagator::BoundedPathPropagator(int _s, int _d, vec<BoolView>& _vs,
 	constructGraph(_in, _out, _en);
 	constructWeights(_wst, _w);
 
-	std::vector<std::vector<int> > en(nbEdges(), std::vector<int>());
-	for (int i = 0; i < _en.size(); i++) {
-		for (int j = 0; j < _en[i].size(); j++) {
-			en[i].push_back(_en[i][j]);
-		}
-	}
-
 	std::vector<std::vector<int> > weights(nbEdges(), std::vector<int>());
 	for (int i = 0; i < nbEdges(); i++) {
 		for (int j = 0; j < _wst[i].size(); j++) {
 			weights[i].push_back(_wst[i][j]);
 		}
 	}
-	kosaraju = new FilteredKosarajuSCC(this, nbNodes(), ou, in, en);
+	kosaraju = new FilteredKosarajuSCC(this, graph);
 
-	forward_sp = new FilteredDijkstra(this, source, en, in, ou, weights);
-	explain_sp = new ExplainerDijkstra(this, source, en, in, ou, weights);
-	mandatory_explainer_sp = new ExplainerDijkstraMandatory(this, source, dest, en, in, ou, weights);
+	forward_sp = new FilteredDijkstra(this, source, graph, weights);
+	explain_sp = new ExplainerDijkstra(this, source, graph, weights);
+	mandatory_explainer_sp = new ExplainerDijkstraMandatory(this, source, dest, graph, weights);
 	mandatory_explainer_sp->init();
 
-	for (int i = 0; i < nbEdges(); i++) {
-		const int tmp = en[i][0];
-		en[i][0] = en[i][1];
-		en[i][1] = tmp;
-	}
-	backward_sp = new FilteredDijkstra(this, dest, en, ou, in, weights);
-	backward_sp_tmp = new FilteredDijkstra(this, dest, en, ou, in, weights);
-	mandatory_sp = new FilteredDijkstraMandatory(this, dest, source, en, ou, in, weights);
+	const CSRGraph rgraph = graph.reversed();
+	backward_sp = new FilteredDijkstra(this, dest, rgraph, weights);
+	backward_sp_tmp = new FilteredDijkstra(this, dest, rgraph, weights);
+	mandatory_sp = new FilteredDijkstraMandatory(this, dest, source, rgraph, weights);
 	mandatory_sp->init();
-	initial_mandatory_sp = new FilteredDijkstraMandatory(this, dest, source, en, ou, in, weights);
+	initial_mandatory_sp = new FilteredDijkstraMandatory(this, dest, source, rgraph, weights);
 	initial_mandatory_sp->init();
 	rootLevelPropagation();
 	constructBasicExplanations();
@@ -698,7 +667,7 @@ bool BoundedPathPropagator::propagate() {
 bool BoundedPathPropagator::propagate_dijkstra() {
 	Clause* r = nullptr;
 
-	backward_sp->run();
+	backward_sp->update();
 
 	if (backward_sp->distTo(source) > w->getMax()) {
 		if (so.lazy) {
@@ -722,7 +691,7 @@ bool BoundedPathPropagator::propagate_dijkstra() {
 		// The path propagator must run before!
 	}
 	// return true;
-	forward_sp->run();
+	forward_sp->update();
 
 	int max_d = 0;     // Distance to furthest in-node
 	int arg_max = -1;  // Furthest in-node
@@ -738,10 +707,10 @@ bool BoundedPathPropagator::propagate_dijkstra() {
 #endif
 		if (recompute) {
 			if (prev_node != -1 && !forward_sp->is_leaf(prev_node)) {
-				forward_sp->run();
+				forward_sp->update();
 			}
 			if (prev_node != -1 && !backward_sp->is_leaf(prev_node)) {
-				backward_sp->run();
+				backward_sp->update();
 			}
 			recompute = false;
 		}
@@ -24,9 +24,7 @@ class BoundedPathPropagator : public GraphPropagator {
 		BoundedPathPropagator* pp;
 
 	public:
-		FilteredKosarajuSCC(BoundedPathPropagator* _pp, int v, std::vector<std::vector<int> > outgoing,
-												std::vector<std::vector<int> > ingoing, std::vector<std::vector<int> > ends)
-				: KosarajuSCC(v, std::move(outgoing), std::move(ingoing), std::move(ends)), pp(_pp) {}
+		FilteredKosarajuSCC(BoundedPathPropagator* _pp, const CSRGraph& g) : KosarajuSCC(g), pp(_pp) {}
 		bool ignore_edge(int e) override {
 			if (pp->getEdgeVar(e).isFixed() && pp->getEdgeVar(e).isFalse()) {
 				return true;
@@ -50,14 +48,11 @@ class BoundedPathPropagator : public GraphPropagator {
 		BoundedPathPropagator* p;
 
 	public:
-		FilteredDijkstra(BoundedPathPropagator* _btp, int _s, const std::vector<std::vector<int> >& _en,
-										 const std::vector<std::vector<int> >& _in,
-										 const std::vector<std::vector<int> >& _ou, std::vector<int>& _ws)
-				: Dijkstra(_s, _en, _in, _ou, _ws), p(_btp) {}
-		FilteredDijkstra(BoundedPathPropagator* _btp, int _s, const std::vector<std::vector<int> >& _en,
-										 const std::vector<std::vector<int> >& _in,
-										 const std::vector<std::vector<int> >& _ou, std::vector<std::vector<int> >& _ws)
-				: Dijkstra(_s, _en, _in, _ou, _ws), p(_btp) {}
+		FilteredDijkstra(BoundedPathPropagator* _btp, int _s, const CSRGraph& g, std::vector<int>& _ws)
+				: Dijkstra(_s, g, _ws), p(_btp) {}
+		FilteredDijkstra(BoundedPathPropagator* _btp, int _s, const CSRGraph& g,
+										 std::vector<std::vector<int> >& _ws)
+				: Dijkstra(_s, g, _ws), p(_btp) {}
 		bool ignore_edge(int e) override {
 			if (p->getEdgeVar(e).isFixed() && p->getEdgeVar(e).isFalse()) {
 				return true;
@@ -91,16 +86,11 @@ class BoundedPathPropagator : public GraphPropagator {
 
 	public:
 		ExplainerDijkstra(BoundedPathPropagator* _btp, int _s,
-											const std::vector<std::vector<int> >& _en,
-											const std::vector<std::vector<int> >& _in,
-											const std::vector<std::vector<int> >& _ou, std::vector<int>& _ws)
-				: FilteredDijkstra(_btp, _s, _en, _in, _ou, _ws), back(nullptr), explaining(-1) {}
+											const CSRGraph& g, std::vector<int>& _ws)
+				: FilteredDijkstra(_btp, _s, g, _ws), back(nullptr), explaining(-1) {}
 		ExplainerDijkstra(BoundedPathPropagator* _btp, int _s,
-											const std::vector<std::vector<int> >& _en,
-											const std::vector<std::vector<int> >& _in,
-											const std::vector<std::vector<int> >& _ou,
-											std::vector<std::vector<int> >& _ws)
-				: FilteredDijkstra(_btp, _s, _en, _in, _ou, _ws), back(nullptr), explaining(-1) {}
+											const CSRGraph& g, std::vector<std::vector<int> >& _ws)
+				: FilteredDijkstra(_btp, _s, g, _ws), back(nullptr), explaining(-1) {}
 		bool debug;
 		void reset(int limit, FilteredDijkstra* _back, int ex = -1) {
 			explanation.clear();
@@ -176,16 +166,11 @@ class BoundedPathPropagator : public GraphPropagator {
 
 	public:
 		FilteredDijkstraMandatory(BoundedPathPropagator* _btp, int _s, int _d,
-															const std::vector<std::vector<int> >& _en,
-															const std::vector<std::vector<int> >& _in,
-															const std::vector<std::vector<int> >& _ou, std::vector<int>& _ws)
-				: DijkstraMandatory(_s, _d, _en, _in, _ou, _ws), p(_btp) {}
+															const CSRGraph& g, std::vector<int>& _ws)
+				: DijkstraMandatory(_s, _d, g, _ws), p(_btp) {}
 		FilteredDijkstraMandatory(BoundedPathPropagator* _btp, int _s, int _d,
-															const std::vector<std::vector<int> >& _en,
-															const std::vector<std::vector<int> >& _in,
-															const std::vector<std::vector<int> >& _ou,
-															std::vector<std::vector<int> >& _ws)
-				: DijkstraMandatory(_s, _d, _en, _in, _ou, _ws), p(_btp) {}
+															const CSRGraph& g, std::vector<std::vector<int> >& _ws)
+				: DijkstraMandatory(_s, _d, g, _ws), p(_btp) {}
 
 		bool ignore_node(int n) override {
 			if (p->getNodeVar(n).isFixed() && p->getNodeVar(n).isFalse()) {
@@ -242,16 +227,11 @@ class BoundedPathPropagator : public GraphPropagator {
 
 	public:
 		ExplainerDijkstraMandatory(BoundedPathPropagator* _btp, int _s, int _d,
-															 const std::vector<std::vector<int> >& _en,
-															 const std::vector<std::vector<int> >& _in,
-															 const std::vector<std::vector<int> >& _ou, std::vector<int>& _ws)
-				: FilteredDijkstraMandatory(_btp, _s, _d, _en, _in, _ou, _ws), back(nullptr) {}
+															 const CSRGraph& g, std::vector<int>& _ws)
+				: FilteredDijkstraMandatory(_btp, _s, _d, g, _ws), back(nullptr) {}
 		ExplainerDijkstraMandatory(BoundedPathPropagator* _btp, int _s, int _d,
-															 const std::vector<std::vector<int> >& _en,
-															 const std::vector<std::vector<int> >& _in,
-															 const std::vector<std::vector<int> >& _ou,
-															 std::vector<std::vector<int> >& _ws)
-				: FilteredDijkstraMandatory(_btp, _s, _d, _en, _in, _ou, _ws), back(nullptr) {}
+															 const CSRGraph& g, std::vector<std::vector<int> >& _ws)
+				: FilteredDijkstraMandatory(_btp, _s, _d, g, _ws), back(nullptr) {}
 
 		void reset(int limit, FilteredDijkstraMandatory* _back, double time_lim = 1.0) {
 			explanation.clear();
@@ -416,8 +396,9 @@ protected:
 
 	std::set<int> rem_edge;
 
-	std::vector<std::vector<edge_id> > in;
-	std::vector<std::vector<edge_id> > ou;
+	CSRLists in;
+	CSRLists ou;
+	CSRGraph graph;
 	vec<int> ws;
 	vec<vec<int> > wst;
 
@@ -462,10 +443,7 @@ protected:
 			vis[curr] = true;
 			count++;
 
-			std::vector<int> in_or_out = ou[curr];
-			if (reverse) {
-				in_or_out = in[curr];
-			}
+			const CSRLists::Range in_or_out = reverse ? in[curr] : ou[curr];
 
 			for (const int e : in_or_out) {
 				int other;
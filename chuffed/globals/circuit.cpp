@@ -12,6 +12,7 @@
 #include "chuffed/vars/modelling.h"
 #include "chuffed/vars/vars.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 #include <cstdlib>
@@ -36,6 +37,8 @@ public:
 	IntView<U>* const x;  // successor variables
 
 	// Persistent state
+	Tint firstFree;  // no var before it is unfixed (root selection 1)
+	Tint sccStamp;   // sccRuns when the last scc pass pruned nothing
 
 	// Intermediate state
 	vec<int> new_fixed;
@@ -59,9 +62,23 @@ public:
 
 	int* index;
 	int* lowlink;
+	int* order;  // order[i] is the node with index i (i > 0)
 
 	int nodesSeen;
 
+	// The last scc pass, kept so that the next one can be skipped when
+	// nothing it relied on was removed since
+	int sccRuns{0};
+	int sccRoot{-1};
+	vec<int> subStart;  // index of the first node of each subtree of the root
+	int* subtree;       // subtree of each node
+	int* tparent;       // parent in the dfs tree, -1 for the root
+	int* nkids;         // number of dfs tree children
+	int* lowLocal;      // lowest index reached by a non-tree edge
+	int* nback;         // number of back edges counted for the subtree
+	int* dsize;         // domain size
+	int* chainPos;      // position in chainStarts, -1 once removed
+
 	// for prevent algorithm
 	int* end;
 	int* lengthChain;
@@ -74,7 +91,9 @@ public:
 
 				generaliseScc(so.sccoptions == 2 || so.sccoptions == 4),
 				size(_x.size()),
-				x(_x.release()) {
+				x(_x.release()),
+				firstFree(0),
+				sccStamp(-1) {
 		priority = 5;
 		new_fixed.reserve(size);
 		prev.reserve(size);
@@ -82,6 +101,14 @@ public:
 		later.reserve(size);
 		index = (int*)malloc(size * sizeof(int));
 		lowlink = (int*)malloc(size * sizeof(int));
+		order = (int*)malloc(size * sizeof(int));
+		subtree = (int*)malloc(size * sizeof(int));
+		tparent = (int*)malloc(size * sizeof(int));
+		nkids = (int*)malloc(size * sizeof(int));
+		lowLocal = (int*)malloc(size * sizeof(int));
+		nback = (int*)malloc(size * sizeof(int));
+		dsize = (int*)malloc(size * sizeof(int));
+		chainPos = (int*)malloc(size * sizeof(int));
 		end = (int*)malloc(size * sizeof(int));
 		lengthChain = (int*)malloc(size * sizeof(int));
 
@@ -232,11 +259,38 @@ public:
 		propQueue.push(newprop);
 	}
 
+	// Appends the nodes with an index in [lo, hi] to out, in increasing order
+	void collectIndices(int lo, int hi, vec<int>& out) {
+		const int first = out.size();
+		for (int i = lo; i <= hi; i++) {
+			out.push(order[i]);
+		}
+		std::sort(static_cast<int*>(out) + first, static_cast<int*>(out) + out.size());
+	}
+
+	// Fills prev with subtree k-1 and earlier with the subtrees before it, in
+	// the order they were explored
+	void collectPrevEarlier(int k) {
+		prev.clear();
+		earlier.clear();
+		if (k > 0) {
+			collectIndices(subStart[k - 1], subStart[k] - 1, prev);
+		}
+		for (int j = 0; j + 1 < k; j++) {
+			collectIndices(subStart[j], subStart[j + 1] - 1, earlier);
+		}
+	}
+
 	bool exploreSubtree(int thisNode, int startPrevSubtree, int endPrevSubtree, int* backfrom,
 											int* backto, int* numback) {
 		// fprintf(stderr,"exploring subtree\n");
+		order[nodesSeen] = thisNode;
 		index[thisNode] = nodesSeen++;
 		lowlink[thisNode] = index[thisNode];
+		subtree[thisNode] = subStart.size() - 1;
+		lowLocal[thisNode] = index[thisNode];
+		nkids[thisNode] = 0;
+		nback[thisNode] = 0;
 		bool isFirstChild = true;
 		int child;
 		for (typename IntView<U>::iterator i = x[thisNode].begin(); i != x[thisNode].end(); ++i) {
@@ -244,6 +298,8 @@ public:
 			// If we haven't visited the child yet, do so now
 			if (index[child] == -1) {
 				// fprintf(stderr,"new child %d\n", child);
+				tparent[child] = thisNode;
+				nkids[thisNode]++;
 				if (!exploreSubtree(child, startPrevSubtree, endPrevSubtree, backfrom, backto, numback)) {
 					return false;  // fail if there was an scc contained within this child
 				}
@@ -316,6 +372,7 @@ public:
 					// then it will be pruned by alldiff later, so just ignore it
 					if (index[child] != 0 || child == root) {
 						(*numback)++;
+						nback[thisNode]++;
 						*backfrom = thisNode;
 						*backto = child;
 					}
@@ -331,6 +388,13 @@ public:
 						// The reason is that no node in an earlier subtree can
 						// reach the prev or later subtrees, and no node
 						// in the prev subtree can reach later subtrees.
+						collectPrevEarlier(subStart.size() - 1);
+						later.clear();
+						for (int i = 0; i < size; i++) {
+							if (index[i] < 0 || index[i] >= subStart.last()) {
+								later.push(i);
+							}
+						}
 						vec<int> prevAndLater;
 						prevAndLater.reserve(prev.size() + later.size());
 						for (int i = 0; i < prev.size(); i++) {
@@ -354,6 +418,9 @@ public:
 				if (index[child] < lowlink[thisNode]) {
 					lowlink[thisNode] = index[child];
 				}
+				if (index[child] < lowLocal[thisNode]) {
+					lowLocal[thisNode] = index[child];
+				}
 			}
 			// fprintf(stderr,"lowpoint is %d\n", lowlink[thisNode]);
 		}
@@ -404,10 +471,20 @@ public:
 		vec<int> chainStarts;  // indices which no var is fixed to
 		for (int i = 0; i < size; i++) {
 			chainStarts.push(i);
+			chainPos[i] = i;
 		}
 		for (int i = 0; i < size; i++) {
 			if (x[i].isFixed()) {
-				chainStarts.remove(x[i].getVal());
+				// Same as chainStarts.remove(), without the search
+				const int v = x[i].getVal();
+				const int j = chainPos[v];
+				if (j != -1) {
+					const int l = chainStarts.last();
+					chainStarts[j] = l;
+					chainPos[l] = j;
+					chainStarts.pop();
+					chainPos[v] = -1;
+				}
 			}
 		}
 
@@ -417,10 +494,12 @@ public:
 			return -1;
 		}
 
-		// now for each chain find the length and the end variable
+		// now for each chain find the length and the end variable, for the
+		// selections that use them
 		vec<int> chainLengths;
 		vec<int> chainEnds;
-		for (int i = 0; i < chainStarts.size(); i++) {
+		const bool useChains = so.rootSelection >= 2 && so.rootSelection <= 6;
+		for (int i = 0; useChains && i < chainStarts.size(); i++) {
 			int length = 1;
 			int currIndex = chainStarts[i];
 			while (x[currIndex].isFixed()) {
@@ -436,13 +515,20 @@ public:
 		int chosenChain;
 		switch (so.rootSelection) {
 			case 1:  // first non-fixed
-				for (int i = 0; i < size; i++) {
-					if (!x[i].isFixed()) {
-						root = i;
-						break;
-					}
+			{
+				// Vars only get fixed below this point in the search, so the
+				// scan can resume where it stopped last time
+				int i = firstFree;
+				while (i < size && x[i].isFixed()) {
+					i++;
 				}
-				break;
+				if (i < size) {
+					root = i;
+				}
+				if (i != firstFree) {
+					firstFree = i;
+				}
+			} break;
 			case 2:  // random non-fixed
 			{
 				// has to be one of the chain ends
@@ -531,17 +617,19 @@ public:
 
 		if (so.lazy) {
 			thisSubtree.reserve(size);
-			prev.clear();
-			earlier.clear();
-			later.clear();
 		}
 
+		sccRuns++;
+		subStart.clear();
 		for (int i = 0; i < size; i++) {
 			index[i] = -1;  // unvisited
 		}
 
 		index[root] = 0;  // first node visited
 		lowlink[root] = 0;
+		order[0] = root;
+		tparent[root] = -1;
+		nkids[root] = 0;
 		nodesSeen = 1;  // only seen root node
 		if (so.rootSelection == 5 || so.rootSelection == 6) {
 			preRoot.clear();
@@ -552,6 +640,8 @@ public:
 				index[rootEnd] = 0;
 				nodesSeen++;
 				lowlink[rootEnd] = 0;
+				tparent[rootEnd] = -1;
+				nkids[rootEnd] = 0;
 			}
 		}
 		// fprintf(stderr, "rootEnd %d\n", rootEnd);
@@ -568,20 +658,24 @@ public:
 			if (index[child] == -1)  // if haven't explored this yet
 			{
 				numback = 0;
+				subStart.push(nodesSeen);
+				tparent[child] = rootEnd;
+				nkids[rootEnd]++;
 				if (!exploreSubtree(child, startSubtree, endSubtree, &backfrom, &backto, &numback)) {
 					// fprintf(stderr, "failed in subtree\n");
 					return false;  // fail if we found a scc within the child
 				}
 
-				// Find the nodes in the subtree we just explored and the ones still to be explored
-				if (so.lazy) {
+				// Find the nodes in the subtree we just explored and the ones still to be
+				// explored, only when they go in an explanation
+				if (so.lazy && (numback == 0 || (fixReq && numback == 1))) {
 					thisSubtree.clear();
+					collectIndices(subStart.last(), nodesSeen - 1, thisSubtree);
+					collectPrevEarlier(subStart.size() - 1);
 					later.clear();
 					for (int i = 0; i < size; i++) {
 						if (index[i] < 0) {
 							later.push(i);
-						} else if (index[i] > endSubtree) {
-							thisSubtree.push(i);
 						}
 					}
 				}
@@ -747,18 +841,6 @@ public:
 					addPropagation(true, backfrom, backto, r);
 				}
 
-				// When a new subtree has been explored, update the prev, earlier and later vectors (only
-				// necessary if explaining)
-				if (so.lazy) {
-					for (int i = 0; i < prev.size(); i++) {
-						earlier.push(prev[i]);
-					}
-					prev.clear();
-					for (int i = 0; i < thisSubtree.size(); i++) {
-						prev.push(thisSubtree[i]);
-					}
-				}
-
 				// Set the new subtree boundaries
 				startSubtree = endSubtree + 1;
 				endSubtree = nodesSeen - 1;
@@ -836,23 +918,82 @@ public:
 		}
 
 		// Perform the propagations
+		bool pruned = false;
 		for (int i = 0; i < propQueue.size(); i++) {
 			PROP const p = propQueue[i];
 			// fprintf(stderr, "propagating\n");
 			if (p.fix) {
 				if (x[p.var].setValNotR(p.val)) {
+					pruned = true;
 					if (!x[p.var].setVal(p.val, p.reason)) {
 						return false;
 					}
 				}
 			} else {
 				if (x[p.var].remValNotR(p.val)) {
+					pruned = true;
 					if (!x[p.var].remVal(p.val, p.reason)) {
 						return false;
 					}
 				}
 			}
 		}
+
+		// A pass that pruned nothing ran on the current graph, so it can stand
+		// in for the next ones as long as they would find the same tree
+		if (!pruned && so.rootSelection != 5 && so.rootSelection != 6) {
+			for (int i = 0; i < size; i++) {
+				dsize[i] = x[i].size();
+			}
+			sccRoot = root;
+			sccStamp = sccRuns;
+		}
+		return true;
+	}
+
+	// Whether an scc pass from root would find what the last one did. Values
+	// only get removed, so the pass visits the nodes in the same order as long
+	// as the tree edges are still there; it then finds the same lowlinks and
+	// back edges if the non-tree edges of the nodes whose domain changed still
+	// give the same lowest index and number of back edges. Only the domains
+	// that changed since the last pass are looked at.
+	bool sccUnchanged(int r) {
+		if (sccStamp != sccRuns || r != sccRoot) {
+			return false;
+		}
+		for (int v = 0; v < size; v++) {
+			if (x[v].size() == dsize[v]) {
+				continue;
+			}
+			int kids = 0;
+			int low = index[v];
+			int back = 0;
+			int lo = 0;
+			int hi = 0;
+			if (v != r && subtree[v] > 0) {
+				lo = subStart[subtree[v] - 1];
+				hi = subStart[subtree[v]] - 1;
+			}
+			for (typename IntView<U>::iterator i = x[v].begin(); i != x[v].end(); ++i) {
+				const int c = *i;
+				if (tparent[c] == v) {
+					kids++;
+				} else if (v != r) {
+					if (index[c] < low) {
+						low = index[c];
+					}
+					if (index[c] >= lo && index[c] <= hi && (index[c] != 0 || c == r)) {
+						back++;
+					}
+				}
+			}
+			if (kids != nkids[v]) {
+				return false;
+			}
+			if (v != r && (low != lowLocal[v] || back != nback[v])) {
+				return false;
+			}
+		}
 		return true;
 	}
 
@@ -887,6 +1028,9 @@ public:
 					}
 					return true;
 				}
+				if (sccUnchanged(root)) {
+					return true;
+				}
 				if (!circuitSCC(root)) {
 					return false;
 				}
@@ -0,0 +1,420 @@
+#include "chuffed/core/engine.h"
+#include "chuffed/core/options.h"
+#include "chuffed/core/propagator.h"
+#include "chuffed/core/sat-types.h"
+#include "chuffed/core/sat.h"
+#include "chuffed/globals/globals.h"
+#include "chuffed/primitives/primitives.h"
+#include "chuffed/support/csr_graph.h"
+#include "chuffed/support/lifted_forest.h"
+#include "chuffed/support/union_find.h"
+#include "chuffed/support/vec.h"
+#include "chuffed/vars/int-var.h"
+#include "chuffed/vars/int-view.h"
+#include "chuffed/vars/modelling.h"
+#include "chuffed/vars/vars.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// x[i] is the successor of i in a circuit of weight at most cost, where arc
+// i -> j weighs w[i * n + j].
+//
+// Held-Karp lower bound: a circuit, seen as an undirected graph, is a 1-tree
+// (a spanning tree of the nodes other than 0, plus two edges at node 0), so
+// its weight is at least that of a minimum 1-tree. With multipliers pi on the
+// nodes, every node having degree 2 in a circuit, the weight of a circuit is
+// also its weight with arc i -> j weighing w + pi[i] + pi[j], minus 2 sum(pi).
+// The multipliers are improved by subgradient steps, pushing them up on nodes
+// of degree more than 2 in the 1-tree and down on leaves.
+//
+// Edges of fixed arcs are always taken in the 1-tree. Arcs that cannot be in a
+// 1-tree within the cost bound are removed (reduced cost filtering), and the
+// explanations only mention the removed arcs that would have made the 1-tree
+// lighter.
+
+template <int U = 0>
+class CircuitCost : public Propagator {
+	static const int ROOT_ITERATIONS = 100;
+	static const int ITERATIONS = 10;
+
+	const int n;
+	IntView<U>* const x;
+	IntVar* const cost;
+	const std::vector<int> w;
+
+	// Undirected edges {i, j}, i < j, of the arcs in the initial domains
+	CSRLists ends;
+	std::vector<int> edge_of;  // edge of arc i -> j, at i * n + j, or -1
+	std::vector<int> at_zero;  // edges at node 0
+
+	// Lagrangian multipliers. Any value gives a valid bound, so they are kept
+	// from one propagation to the next without trailing.
+	std::vector<int64_t> pi;
+	bool first_run{true};
+
+	// The last 1-tree
+	std::vector<char> present;  // some arc of the edge is in its domain
+	std::vector<char> forced;   // some arc of the edge is fixed
+	std::vector<int64_t> ew;    // weight with the multipliers
+	std::vector<int64_t> fw;    // same, with forced edges as light as possible
+	std::vector<bool> in_tree;
+	std::vector<int> deg;
+	std::vector<int> sorted;
+	std::vector<int> no_key;
+	LiftedForest<int64_t> forest;
+	int64_t special_free;  // heaviest non forced edge at node 0, or none
+
+	static const int64_t NONE = std::numeric_limits<int64_t>::min();
+
+	int64_t arcWeight(int i, int j) const { return w[i * n + j] + pi[i] + pi[j]; }
+
+	// Computes a minimum 1-tree for the current multipliers and returns its
+	// weight, or NONE if there is no 1-tree containing the forced edges
+	int64_t oneTree() {
+		const int nb_edges = ends.size();
+		for (int e = 0; e < nb_edges; e++) {
+			present[e] = 0;
+			forced[e] = 0;
+			in_tree[e] = false;
+		}
+		for (int i = 0; i < n; i++) {
+			deg[i] = 0;
+			for (typename IntView<U>::iterator it = x[i].begin(); it != x[i].end(); ++it) {
+				const int j = *it;
+				const int e = edge_of[i * n + j];
+				if (e == -1) {
+					continue;
+				}
+				const int64_t wa = arcWeight(i, j);
+				if (x[i].isFixed()) {
+					ew[e] = (forced[e] != 0) ? std::min(ew[e], wa) : wa;
+					forced[e] = 1;
+				} else if (forced[e] == 0 && (present[e] == 0 || wa < ew[e])) {
+					ew[e] = wa;
+				}
+				present[e] = 1;
+			}
+		}
+
+		int64_t total = 0;
+		UF<int> uf(n);
+		int nb_in = 0;
+		sorted.clear();
+		for (int e = 0; e < nb_edges; e++) {
+			if (present[e] == 0 || ends[e][0] == 0) {
+				continue;
+			}
+			if (forced[e] != 0) {
+				if (!uf.unite(ends[e][0], ends[e][1])) {
+					return NONE;  // Subtour
+				}
+				in_tree[e] = true;
+				nb_in++;
+				total += ew[e];
+			} else {
+				sorted.push_back(e);
+			}
+		}
+		std::sort(sorted.begin(), sorted.end(), [this](int e1, int e2) { return ew[e1] < ew[e2]; });
+		for (int k = 0; k < static_cast<int>(sorted.size()) && nb_in < n - 2; k++) {
+			const int e = sorted[k];
+			if (uf.unite(ends[e][0], ends[e][1])) {
+				in_tree[e] = true;
+				nb_in++;
+				total += ew[e];
+			}
+		}
+		if (nb_in < n - 2) {
+			return NONE;  // The nodes other than 0 are not connected
+		}
+
+		// The two edges at node 0, forced ones first
+		int nb_special = 0;
+		for (const int e : at_zero) {
+			if (present[e] != 0 && forced[e] != 0) {
+				in_tree[e] = true;
+				nb_special++;
+				total += ew[e];
+			}
+		}
+		special_free = NONE;
+		while (nb_special < 2) {
+			int best = -1;
+			for (const int e : at_zero) {
+				if (present[e] != 0 && !in_tree[e] && (best == -1 || ew[e] < ew[best])) {
+					best = e;
+				}
+			}
+			if (best == -1) {
+				return NONE;
+			}
+			in_tree[best] = true;
+			nb_special++;
+			total += ew[best];
+			special_free = std::max(special_free, ew[best]);
+		}
+		if (nb_special > 2) {
+			return NONE;
+		}
+
+		for (int e = 0; e < nb_edges; e++) {
+			if (in_tree[e]) {
+				deg[ends[e][0]]++;
+				deg[ends[e][1]]++;
+			}
+		}
+		for (int i = 0; i < n; i++) {
+			total -= 2 * pi[i];
+		}
+		return total;
+	}
+
+	// Weight below which a new edge {i, j} would make the last 1-tree lighter
+	// (NONE if nothing it could replace)
+	int64_t threshold(int i, int j) const {
+		if (i == 0 || j == 0) {
+			return special_free;
+		}
+		int max_e;
+		int max_key;
+		forest.pathQuery(i, j, max_e, max_key);
+		if (max_e == -1 || forced[max_e] != 0) {
+			return NONE;
+		}
+		return ew[max_e];
+	}
+
+	// Explanation of the last 1-tree weight: the fixed arcs, and the removed
+	// arcs that would have made it lighter, or lighter than limit
+	void explainTree(vec<Lit>& ps, int64_t limit) {
+		for (int i = 0; i < n; i++) {
+			if (x[i].isFixed()) {
+				const int j = x[i].getVal();
+				if (edge_of[i * n + j] != -1) {
+					ps.push(x[i].getLit(j, LR_NE));
+				}
+			}
+		}
+		for (int i = 0; i < n; i++) {
+			for (int j = 0; j < n; j++) {
+				const int e = edge_of[i * n + j];
+				if (e == -1 || x[i].indomain(j) || forced[e] != 0) {
+					continue;
+				}
+				const int64_t t = std::max(in_tree[e] ? ew[e] : threshold(i, j), limit);
+				if (t != NONE && arcWeight(i, j) < t) {
+					ps.push(x[i].getLit(j, LR_EQ));
+				}
+			}
+		}
+	}
+
+public:
+	CircuitCost(vec<IntView<U> >& _x, const std::vector<int>& _w, IntVar* _cost)
+			: n(_x.size()),
+				x(_x.release()),
+				cost(_cost),
+				w(_w),
+				edge_of(n * n, -1),
+				pi(n, 0),
+				deg(n),
+				forest(n),
+				special_free(NONE) {
+		priority = 5;
+		std::vector<std::vector<int> > en;
+		std::vector<int> pair_edge(n * n, -1);
+		for (int i = 0; i < n; i++) {
+			for (typename IntView<U>::iterator it = x[i].begin(); it != x[i].end(); ++it) {
+				const int j = *it;
+				if (j < 0 || j >= n || j == i) {
+					continue;
+				}
+				const int lo = std::min(i, j);
+				const int hi = std::max(i, j);
+				if (pair_edge[lo * n + hi] == -1) {
+					pair_edge[lo * n + hi] = static_cast<int>(en.size());
+					en.push_back({lo, hi});
+					if (lo == 0) {
+						at_zero.push_back(pair_edge[lo * n + hi]);
+					}
+				}
+				edge_of[i * n + j] = pair_edge[lo * n + hi];
+			}
+		}
+		ends = CSRLists(en);
+		present.resize(en.size());
+		forced.resize(en.size());
+		ew.resize(en.size());
+		fw.resize(en.size());
+		in_tree.resize(en.size());
+		no_key.assign(en.size(), -1);
+
+		for (int i = 0; i < n; i++) {
+			x[i].attach(this, i, EVENT_C);
+		}
+		cost->attach(this, n, EVENT_U);
+	}
+
+	void wakeup(int /*i*/, int /*c*/) override { pushInQueue(); }
+
+	bool propagate() override {
+		// Subgradient optimisation of the multipliers
+		const int nb_iterations = first_run ? ROOT_ITERATIONS : ITERATIONS;
+		first_run = false;
+		std::vector<int64_t> best_pi(pi);
+		int64_t best = NONE;
+		double lambda = 2;
+		for (int it = 0; it < nb_iterations; it++) {
+			const int64_t lb = oneTree();
+			if (lb == NONE) {
+				return true;  // Left to the circuit propagator
+			}
+			if (lb > best) {
+				best = lb;
+				best_pi = pi;
+			} else {
+				lambda /= 2;
+			}
+			if (best > cost->getMax()) {
+				break;
+			}
+			int64_t norm = 0;
+			for (int i = 0; i < n; i++) {
+				norm += (deg[i] - 2) * (deg[i] - 2);
+			}
+			if (norm == 0) {
+				break;  // The 1-tree is a circuit
+			}
+			// Gap to the upper bound, kept small while there is none
+			const int64_t gap = std::min<int64_t>(cost->getMax() - lb, std::abs(lb) / 10 + n);
+			const int64_t step = std::max<int64_t>(1, static_cast<int64_t>(lambda * gap / norm));
+			for (int i = 1; i < n; i++) {
+				pi[i] += step * (deg[i] - 2);
+			}
+		}
+		pi = best_pi;
+		const int64_t lb = oneTree();
+		assert(lb == best);
+
+		for (int e = 0; e < ends.size(); e++) {
+			fw[e] = (forced[e] != 0) ? NONE : ew[e];
+		}
+		std::vector<bool> forest_edges(in_tree);
+		for (const int e : at_zero) {
+			forest_edges[e] = false;
+		}
+		forest.build(ends, forest_edges, fw, no_key);
+
+		if (lb > cost->getMin()) {
+			Clause* r = nullptr;
+			if (so.lazy) {
+				vec<Lit> ps;
+				ps.push();
+				explainTree(ps, NONE);
+				r = Reason_new(ps);
+			}
+			if (!cost->setMin(lb, r)) {
+				return false;
+			}
+		}
+
+		// Reduced cost filtering: the lightest 1-tree using arc i -> j
+		vec<int> rem_from;
+		vec<int> rem_to;
+		int64_t limit = NONE;
+		const int64_t ub = cost->getMax();
+		for (int i = 0; i < n; i++) {
+			if (x[i].isFixed()) {
+				continue;
+			}
+			for (typename IntView<U>::iterator it = x[i].begin(); it != x[i].end(); ++it) {
+				const int j = *it;
+				const int e = edge_of[i * n + j];
+				if (e == -1 || forced[e] != 0) {
+					continue;
+				}
+				const int64_t wa = arcWeight(i, j);
+				const int64_t t = in_tree[e] ? ew[e] : threshold(i, j);
+				if (t == NONE) {
+					continue;
+				}
+				if (lb + wa - t > ub) {
+					rem_from.push(i);
+					rem_to.push(j);
+					limit = std::max(limit, wa);
+				}
+			}
+		}
+		if (rem_from.size() == 0) {
+			return true;
+		}
+		vec<Lit> ps;
+		if (so.lazy) {
+			ps.push();
+			explainTree(ps, limit);
+			ps.push(cost->getMaxLit());
+		}
+		for (int k = 0; k < rem_from.size(); k++) {
+			Clause* r = nullptr;
+			if (so.lazy) {
+				r = Reason_new(ps);
+			}
+			if (!x[rem_from[k]].remVal(rem_to[k], r)) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+void circuit_cost(vec<IntVar*>& _x, vec<int>& w, IntVar* cost, int offset) {
+	const int n = _x.size();
+	assert(w.size() == n * n);
+
+	// The circuit, and the cost as the sum of the weights of the arcs
+	circuit(_x, offset);
+	vec<IntVar*> ws;
+	for (int i = 0; i < n; i++) {
+		vec<int> row;
+		for (int j = 0; j < n; j++) {
+			row.push(w[i * n + j]);
+		}
+		int lo = row[0];
+		int hi = row[0];
+		for (int j = 1; j < n; j++) {
+			lo = std::min(lo, row[j]);
+			hi = std::max(hi, row[j]);
+		}
+		IntVar* wi;
+		createVar(wi, lo, hi);
+		array_int_element(_x[i], row, wi, offset);
+		ws.push(wi);
+	}
+	int_linear(ws, IRT_EQ, cost);
+
+	// Below three nodes there is a single circuit
+	if (n < 3) {
+		return;
+	}
+	std::vector<int> weights;
+	for (int i = 0; i < w.size(); i++) {
+		weights.push_back(w[i]);
+	}
+	if (offset == 0) {
+		vec<IntView<> > x;
+		for (int i = 0; i < n; i++) {
+			x.push(IntView<>(_x[i]));
+		}
+		new CircuitCost<0>(x, weights, cost);
+	} else {
+		vec<IntView<4> > x;
+		for (int i = 0; i < n; i++) {
+			x.push(IntView<4>(_x[i], 1, -offset));
+		}
+		new CircuitCost<4>(x, weights, cost);
+	}
+}
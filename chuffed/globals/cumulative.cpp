@@ -5,6 +5,7 @@
 #include "chuffed/core/sat.h"
 #include "chuffed/primitives/primitives.h"
 #include "chuffed/support/misc.h"
+#include "chuffed/support/theta_lambda_tree.h"
 #include "chuffed/support/vec.h"
 #include "chuffed/vars/bool-view.h"
 #include "chuffed/vars/int-var.h"
@@ -18,7 +19,6 @@
 #include <iostream>
 #include <list>
 #include <queue>
-#include <set>
 #include <string>
 
 // Time Decomposition of the cumulative constraint
@@ -108,24 +108,16 @@ class CumulativeProp : public Propagator {
 	};
 
 	// Resource profile of the resource
+	// NOTE: The tasks contributing to a profile part are not stored in the part,
+	// see get_part_tasks().
 	struct ProfilePart {
 		CUMU_INT begin;
 		CUMU_INT end;
 		CUMU_INT level;
-		std::set<CUMU_INT> tasks;
-		ProfilePart(CUMU_INT b, CUMU_INT e, CUMU_INT l, CUMU_INT t) : begin(b), end(e), level(l) {
-			tasks.insert(t);
-		};
+		ProfilePart(CUMU_INT b, CUMU_INT e, CUMU_INT l) : begin(b), end(e), level(l) {}
 		ProfilePart() : begin(0), end(0), level(0) {}
 	};
 
-	enum ProfileChange { PROFINC, PROFDEC };
-	struct ProfileChangePt {
-		CUMU_INT time;
-		ProfileChange change;
-		ProfileChangePt(CUMU_INT t, ProfileChange c) : time(t), change(c) {}
-	};
-
 	Tint last_unfixed;
 
 public:
@@ -143,6 +135,9 @@ public:
 	CUMU_BOOL tt_filt;
 	CUMU_BOOL ttef_check;
 	CUMU_BOOL ttef_filt;
+	// Minimal number of unfixed tasks for using the Theta-Lambda tree version of
+	// the TTEF propagator instead of the quadratic one
+	int ttef_tree_min;
 
 	ExplDeg ttef_expl_deg;
 
@@ -164,9 +159,32 @@ public:
 	int* tt_after_lct;
 	int* new_est;
 	int* new_lct;
+	int* ttef_pos;  // Leaf of the task in ttef_tree
+	ThetaLambdaTree ttef_tree;
 	int tt_profile_size;
 	struct ProfilePart* tt_profile;
 
+	// Time-table structures, allocated once so that building the profile does
+	// not allocate any memory
+	int* lst_order;  // All tasks, kept sorted by lst across propagations
+	int* ect_order;  // All tasks, kept sorted by ect across propagations
+	int* comp_task;  // Tasks with a compulsory part in the current profile
+	int comp_task_size;
+	int tt_stamp;
+	int* cp_stamp;  // Equal to tt_stamp iff the task is in comp_task
+	int* cp_index;  // Position of the task in comp_task
+	int* cp_begin;  // Compulsory part [cp_begin, cp_end) when the profile was built
+	int* cp_end;
+	int* cp_first;  // Range of profile parts covered by the compulsory part
+	int* cp_last;
+	// Tasks of each profile part in increasing order (part i owns the index
+	// range [part_task_start[i], part_task_start[i + 1]) of part_tasks),
+	// only built when an explanation is requested
+	int* part_task_start;
+	int* part_task_fill;
+	vec<int> part_tasks;
+	int part_tasks_built;  // Number of compulsory parts in part_tasks, -1 if not built yet
+
 	// Inline functions
 	struct SortEstAsc {
 		CumulativeProp* p;
@@ -193,6 +211,7 @@ public:
 				tt_filt(true),
 				ttef_check(false),
 				ttef_filt(false),
+				ttef_tree_min(64),
 
 				bound_update(false),
 				sort_est_asc(this),
@@ -213,6 +232,11 @@ public:
 				ttef_filt = true;
 			} else if (it == "ttef_filt_off") {
 				ttef_filt = false;
+			}
+			if (it == "ttef_tree_on") {
+				ttef_tree_min = 0;
+			} else if (it == "ttef_tree_off") {
+				ttef_tree_min = INT_MAX;
 			} else if (it.find("__name__") == 0) {
 				name = it.substr(8);
 			}
@@ -223,12 +247,32 @@ public:
 		// Allocation of the memory
 		tt_profile = new ProfilePart[2 * start.size()];
 		tt_profile_size = 0;
+		lst_order = new int[start.size()];
+		ect_order = new int[start.size()];
+		comp_task = new int[start.size()];
+		comp_task_size = 0;
+		tt_stamp = 0;
+		cp_stamp = new int[start.size()];
+		cp_index = new int[start.size()];
+		cp_begin = new int[start.size()];
+		cp_end = new int[start.size()];
+		cp_first = new int[start.size()];
+		cp_last = new int[start.size()];
+		part_task_start = new int[2 * start.size() + 1];
+		part_task_fill = new int[2 * start.size() + 1];
+		part_tasks_built = -1;
+		for (int i = 0; i < start.size(); i++) {
+			lst_order[i] = i;
+			ect_order[i] = i;
+			cp_stamp[i] = 0;
+		}
 		// XXX Check for successful memory allocation
 		if (ttef_check || ttef_filt) {
 			task_id_est = (int*)malloc(start.size() * sizeof(int));
 			task_id_lct = (int*)malloc(start.size() * sizeof(int));
 			tt_after_est = (int*)malloc(start.size() * sizeof(int));
 			tt_after_lct = (int*)malloc(start.size() * sizeof(int));
+			ttef_pos = (int*)malloc(start.size() * sizeof(int));
 			if (ttef_filt) {
 				new_est = (int*)malloc(start.size() * sizeof(int));
 				new_lct = (int*)malloc(start.size() * sizeof(int));
@@ -241,6 +285,7 @@ public:
 			task_id_est = nullptr;
 			task_id_lct = nullptr;
 			tt_after_est = nullptr;
+			ttef_pos = nullptr;
 		}
 
 		// Priority of the propagator
@@ -378,7 +423,12 @@ public:
 				//	return false;
 				//}
 				// TODO TTEF start time filtering algorithm
-				if (ttef_filt) {
+				if (last_unfixed + 1 >= ttef_tree_min) {
+					if (!ttef_tree_propagation()) {
+						// Inconsistency was detected
+						return false;
+					}
+				} else if (ttef_filt) {
 					if (!ttef_bounds_propagation(get_free_dur_right_shift, get_free_dur_left_shift)) {
 						// Inconsistency was detected
 						return false;
@@ -435,40 +485,26 @@ public:
 	// and propagator
 	CUMU_BOOL
 	time_table_propagation(CUMU_ARR_INT& task) {
-		std::list<ProfileChangePt> changes;
-		std::list<CUMU_INT> comp_task;
-		// int size_profile = 0;
-
 #if CUMUVERB > 10
 		fprintf(stderr, "\tCompulsory Parts ...\n");
 #endif
-		get_compulsory_parts2(changes, comp_task, task, 0, task.size());
+		get_compulsory_parts2(task, 0, task.size());
 		// Proceed if there are compulsory parts
-		if (!changes.empty()) {
-#if CUMUVERB > 1
-			fprintf(stderr, "\tSorting (size %d)...\n", (int)changes.size());
-#endif
-			// Sorting the start and end points of all the profile
-			changes.sort(compare_ProfileChangePt);
+		if (comp_task_size > 0) {
 #if CUMUVERB > 1
-			fprintf(stderr, "\tSorting (size %d)...\n", (int)changes.size());
+			fprintf(stderr, "\tProfile Parts ...\n");
 #endif
-			// Counting the number of different profiles
-			tt_profile_size = count_profile(changes);
+			// Creating the different profile parts
+			create_profile();
 #if CUMUVERB > 1
 			fprintf(stderr, "\t#profile parts = %d\n", tt_profile_size);
 #endif
-#if CUMUVERB > 1
-			fprintf(stderr, "\tProfile Parts ...\n");
-#endif
-			// Creating the different profile parts
-			create_profile(changes);
 			int i_max_usage = 0;
 #if CUMUVERB > 1
 			fprintf(stderr, "\tFilling of Profile Parts ...\n");
 #endif
 			// Filling the profile parts with tasks
-			if (!fill_in_profile_parts(tt_profile, tt_profile_size, comp_task, i_max_usage)) {
+			if (!fill_in_profile_parts(tt_profile, tt_profile_size, i_max_usage)) {
 				return false;
 			}
 #if CUMUVERB > 10
@@ -495,48 +531,113 @@ public:
 		return true;
 	}
 
-	void get_compulsory_parts2(std::list<ProfileChangePt>& changes, std::list<CUMU_INT>& comp_task,
-														 CUMU_ARR_INT& task, CUMU_INT i_start, CUMU_INT i_end);
+	void get_compulsory_parts2(CUMU_ARR_INT& task, CUMU_INT i_start, CUMU_INT i_end);
+
+	// Sorts 'order' by 'key' with an insertion sort.  The orders are kept from
+	// the previous propagation, so they are nearly sorted and this is ~O(n).
+	template <class Key>
+	void insertion_sort(int* order, int size, Key key) {
+		for (int i = 1; i < size; i++) {
+			const int t = order[i];
+			const CUMU_INT k = key(t);
+			int j = i;
+			for (; j > 0 && key(order[j - 1]) > k; j--) {
+				order[j] = order[j - 1];
+			}
+			order[j] = t;
+		}
+	}
 
 	// Sets for each profile part its begin and end time in chronological order
-	// Runtime complexity: O(n)
+	// by merging the starts (lst) and ends (ect) of the compulsory parts, ends
+	// before starts at the same time point
+	// Runtime complexity: O(n) plus the cost of restoring the sort orders
 	//
-	void create_profile(std::list<ProfileChangePt>& changes) const {
-		auto iter = changes.begin();
-		int cur_profile = 0;
-		int cur_time = iter->time;
-		ProfileChange cur_change = iter->change;
-		int no_starts = 1;
-		for (; iter != changes.end(); iter++) {
-			if (iter->time > cur_time && no_starts > 1) {
+	void create_profile() {
+		const int n = start.size();
+		insertion_sort(lst_order, n, [this](int i) { return lst(i); });
+		insertion_sort(ect_order, n, [this](int i) { return ect(i); });
+		int il = 0;
+		int ie = 0;
+		int active = 0;
+		int cur_time = 0;
+		tt_profile_size = 0;
+		while (true) {
+			while (il < n && cp_stamp[lst_order[il]] != tt_stamp) {
+				il++;
+			}
+			while (ie < n && cp_stamp[ect_order[ie]] != tt_stamp) {
+				ie++;
+			}
+			if (ie >= n) {
+				break;
+			}
+			const bool is_start = il < n && cp_begin[lst_order[il]] < cp_end[ect_order[ie]];
+			const int time = is_start ? cp_begin[lst_order[il++]] : cp_end[ect_order[ie++]];
+			if (active > 0 && time > cur_time) {
 #if CUMUVERB > 20
-				fprintf(stderr, "Set times for profile part %d = [%d, %d)\n", cur_profile, cur_time,
-								iter->time);
-				fprintf(stderr, "\t%p; %p; %d\n", tt_profile, this, start.size());
+				fprintf(stderr, "Set times for profile part %d = [%d, %d)\n", tt_profile_size, cur_time,
+								time);
 #endif
-				set_times_for_profile(cur_profile, cur_time, iter->time);
-				cur_profile++;
+				set_times_for_profile(tt_profile_size++, cur_time, time);
 			}
-			no_starts += (iter->change == PROFINC ? 1 : -1);
-			cur_change = iter->change;
-			cur_time = iter->time;
+			active += (is_start ? 1 : -1);
+			cur_time = time;
 		}
+		part_tasks_built = -1;
 	}
 
 	inline void set_times_for_profile(int i, CUMU_INT begin, CUMU_INT end) const {
 		tt_profile[i].begin = begin;
 		tt_profile[i].end = end;
 		tt_profile[i].level = 0;
-		// fprintf(stderr, "blxxx %d\n", (int) tt_profile[i].tasks.size());
-		tt_profile[i].tasks.clear();
+	}
+
+	// Builds the task lists of the profile parts from the first 'ncomp' tasks
+	// in comp_task
+	// Runtime complexity: O(n + sum of the lengths of the task lists)
+	//
+	void build_part_tasks(int ncomp) {
+		for (int p = 0; p <= tt_profile_size; p++) {
+			part_task_fill[p] = 0;
+		}
+		for (int k = 0; k < ncomp; k++) {
+			part_task_fill[cp_first[comp_task[k]]]++;
+			part_task_fill[cp_last[comp_task[k]] + 1]--;
+		}
+		int covering = 0;
+		part_task_start[0] = 0;
+		for (int p = 0; p < tt_profile_size; p++) {
+			covering += part_task_fill[p];
+			part_task_start[p + 1] = part_task_start[p] + covering;
+			part_task_fill[p] = part_task_start[p];
+		}
+		part_tasks.clear();
+		part_tasks.growTo(part_task_start[tt_profile_size]);
+		// Tasks are visited in increasing order, which keeps the lists sorted
+		for (int t = 0; t < start.size(); t++) {
+			if (cp_stamp[t] == tt_stamp && cp_index[t] < ncomp) {
+				for (int p = cp_first[t]; p <= cp_last[t]; p++) {
+					part_tasks[part_task_fill[p]++] = t;
+				}
+			}
+		}
+		part_tasks_built = ncomp;
+	}
+
+	// Tasks with a compulsory part in the profile part i, in increasing order
+	void get_part_tasks(int i, int*& first, int*& last) {
+		if (part_tasks_built < 0) {
+			build_part_tasks(comp_task_size);
+		}
+		first = (int*)part_tasks + part_task_start[i];
+		last = (int*)part_tasks + part_task_start[i + 1];
 	}
 
 	// Filling the profile parts with compulsory parts and checking for a resource
 	// overload
 	CUMU_BOOL
-	fill_in_profile_parts(ProfilePart* profile, int size, std::list<CUMU_INT> comp_task,
-												int& i_max_usage) {
-		std::list<CUMU_INT>::iterator iter;
+	fill_in_profile_parts(ProfilePart* profile, int size, int& i_max_usage) {
 		int i = 0;
 		CUMU_INT lst_i;
 		CUMU_INT ect_i;
@@ -544,27 +645,29 @@ public:
 #if CUMUVERB > 2
 		fprintf(stderr, "\t\tstart filling profiles (size %d)\n", size);
 #endif
-		for (iter = comp_task.begin(); iter != comp_task.end(); iter++) {
+		for (int k = 0; k < comp_task_size; k++) {
+			const int t = comp_task[k];
 #if CUMUVERB > 2
-			fprintf(stderr, "\t\tcomp part = %d\n", *iter);
+			fprintf(stderr, "\t\tcomp part = %d\n", t);
 #endif
-			lst_i = lst(*iter);
-			ect_i = ect(*iter);
+			lst_i = cp_begin[t];
+			ect_i = cp_end[t];
 #if CUMUVERB > 2
 			fprintf(stderr, "\t\tFinding first profile part\n");
 #endif
 			// Find first profile
 			i = find_first_profile(profile, 0, size - 1, lst_i);
+			cp_first[t] = i;
 #if CUMUVERB > 2
-			fprintf(stderr, "\t\tAdding comp parts of level %d\n", min_usage(*iter));
+			fprintf(stderr, "\t\tAdding comp parts of level %d\n", min_usage(t));
 #endif
 			// Add compulsory part to the profile
 			while (i < size && profile[i].begin < ect_i) {
 #if CUMUVERB > 2
 				fprintf(stderr, "\t\t\tAdding comp parts in profile part %d\n", i);
 #endif
-				profile[i].level += min_usage(*iter);
-				profile[i].tasks.insert(*iter);
+				profile[i].level += min_usage(t);
+				cp_last[t] = i;
 				// Checking if the profile part i is the part with the maximal level
 				//
 				if (profile[i].level > profile[i_max_usage].level) {
@@ -590,8 +693,10 @@ public:
 						// Pointwise explanation
 						begin1 = profile[i].begin + ((profile[i].end - profile[i].begin) / 2);
 						end1 = begin1 + 1;
+						// Only the compulsory parts added so far are part of the overload
+						build_part_tasks(k + 1);
 						// Generation of the explanation
-						analyse_limit_and_tasks(expl, profile[i].tasks, lift_usage, begin1, end1);
+						analyse_limit_and_tasks(expl, i, lift_usage, begin1, end1);
 					}
 					// Submitting of the conflict explanation
 					submit_conflict_explanation(expl);
@@ -625,55 +730,6 @@ public:
 		return low;
 	}
 
-	// Counting the number of profiles
-	//
-	static int count_profile(std::list<ProfileChangePt>& changes) {
-		auto iter = changes.begin();
-		int cur_time = iter->time;
-		int next_time;
-		ProfileChange cur_change = iter->change;
-		int no_starts = (iter->change == PROFINC ? 1 : 0);
-		int no_profile = no_starts;
-		iter++;
-
-#if CUMUVERB > 2
-		fprintf(stderr, "\t\t\ttime = %d; change = %d; no_starts = %d; no_profile = %d;\n", cur_time,
-						cur_change, no_starts, no_profile);
-#endif
-		for (; iter != changes.end(); iter++) {
-			if (iter->change == PROFINC) {
-				if (cur_time < iter->time || cur_change == PROFDEC) {
-					no_profile++;
-				}
-				no_starts++;
-			} else {
-				// ASSUMPTION
-				// - iter->change = PROFDEC
-				no_starts--;
-				next_time = iter->time;
-				iter++;
-				if (iter != changes.end() && no_starts > 0 && iter->time > next_time) {
-					no_profile++;
-				}
-				iter--;
-			}
-			cur_time = iter->time;
-			cur_change = iter->change;
-#if CUMUVERB > 2
-			fprintf(stderr, "\t\t\ttime = %d; change = %d; no_starts = %d; no_profile = %d;\n", cur_time,
-							cur_change, no_starts, no_profile);
-#endif
-		}
-		return no_profile;
-	}
-
-	static bool compare_ProfileChangePt(ProfileChangePt& pt1, ProfileChangePt& pt2) {
-		if (pt1.time == pt2.time && pt1.change == PROFDEC && pt2.change == PROFINC) {
-			return true;
-		}
-		return pt1.time < pt2.time;
-	}
-
 	// Time-table filtering on the lower bound of the resource limit variable
 	// Complexity:
 	CUMU_BOOL
@@ -701,10 +757,9 @@ public:
 	//
 	// Explanation is created for the time interval [begin, end), i.e., excluding end.
 	//
-	void analyse_limit_and_tasks(vec<Lit>& expl, std::set<CUMU_INT>& tasks, CUMU_INT lift_usage,
-															 CUMU_INT begin, CUMU_INT end);
-	void analyse_tasks(vec<Lit>& expl, std::set<CUMU_INT>& tasks, CUMU_INT lift_usage, CUMU_INT begin,
-										 CUMU_INT end);
+	void analyse_limit_and_tasks(vec<Lit>& expl, int part, CUMU_INT lift_usage, CUMU_INT begin,
+															 CUMU_INT end);
+	void analyse_tasks(vec<Lit>& expl, int part, CUMU_INT lift_usage, CUMU_INT begin, CUMU_INT end);
 	static void submit_conflict_explanation(vec<Lit>& expl);
 	static Clause* get_reason_for_update(vec<Lit>& expl);
 
@@ -751,6 +806,14 @@ public:
 													int begin, int end, int fb_id, std::list<TaskDur>& tasks_tw,
 													std::list<TaskDur>& tasks_cp);
 
+	// TTEF Propagator using a Theta-Lambda tree, runtime O(n log n)
+	bool ttef_tree_propagation();
+	bool ttef_tree_propagation_lb(std::queue<TTEFUpdate>* update_queue);
+	bool ttef_tree_propagation_ub(std::queue<TTEFUpdate>& update_queue);
+	void ttef_tree_overload(int shift_in(const int, const int, const int, const int, const int,
+																			 const int, const int),
+													int begin, int end);
+
 	// TTEF Generation of explanations
 	//
 	void ttef_analyse_limit_and_tasks(int begin, int end, std::list<TaskDur>& tasks_tw,
@@ -785,13 +848,13 @@ public:
  * Functions related to the Time-Table Consistency Check and Propagation
  ****/
 
-void CumulativeProp::get_compulsory_parts2(std::list<ProfileChangePt>& changes,
-																					 std::list<CUMU_INT>& comp_task, CUMU_ARR_INT& task,
-																					 CUMU_INT i_start, CUMU_INT i_end) {
+void CumulativeProp::get_compulsory_parts2(CUMU_ARR_INT& task, CUMU_INT i_start, CUMU_INT i_end) {
 	CUMU_INT i;
 #if CUMUVERB > 2
 	fprintf(stderr, "\tstart get_compulsory_part from %d to %d\n", i_start, i_end);
 #endif
+	tt_stamp++;
+	comp_task_size = 0;
 	for (i = i_start; i < i_end; i++) {
 #if CUMUVERB > 2
 		fprintf(stderr, "\t\ti = %d; task[i] = %d\n", i, task[i]);
@@ -803,10 +866,11 @@ void CumulativeProp::get_compulsory_parts2(std::list<ProfileChangePt>& changes,
 							ect(task[i]));
 #endif
 			// Add task to the list
-			comp_task.push_back(task[i]);
-			// Add time points to change lists
-			changes.emplace_back(lst(task[i]), PROFINC);
-			changes.emplace_back(ect(task[i]), PROFDEC);
+			cp_stamp[task[i]] = tt_stamp;
+			cp_index[task[i]] = comp_task_size;
+			cp_begin[task[i]] = lst(task[i]);
+			cp_end[task[i]] = ect(task[i]);
+			comp_task[comp_task_size++] = task[i];
 		}
 	}
 #if CUMUVERB > 2
@@ -830,7 +894,7 @@ CumulativeProp::filter_limit(ProfilePart* profile, int& i) {
 			const int expl_end = expl_begin + 1;
 			vec<Lit> expl;
 			// Get the negated literals for the tasks in the profile
-			analyse_tasks(expl, profile[i].tasks, 0, expl_begin, expl_end);
+			analyse_tasks(expl, i, 0, expl_begin, expl_end);
 			// Transform literals to a clause
 			reason = get_reason_for_update(expl);
 		}
@@ -952,7 +1016,7 @@ CumulativeProp::time_table_filtering_lb(ProfilePart profile[], int low, int high
 					expl.push(getNegGeqLit(usage[task], min_usage(task)));
 				}
 				// Get the negated literals for the tasks in the profile and the resource limit
-				analyse_limit_and_tasks(expl, profile[i].tasks, lift_usage, expl_begin, expl_end);
+				analyse_limit_and_tasks(expl, i, lift_usage, expl_begin, expl_end);
 #if CUMUVERB > 1
 				fprintf(stderr, " -> start[%d] => %d\n", task, expl_end);
 #endif
@@ -1026,7 +1090,7 @@ CumulativeProp::time_table_filtering_ub(ProfilePart profile[], int low, int high
 					expl.push(getNegGeqLit(usage[task], min_usage(task)));
 				}
 				// Get the negated literals for the tasks in the profile and the resource limit
-				analyse_limit_and_tasks(expl, profile[i].tasks, lift_usage, expl_begin, expl_end);
+				analyse_limit_and_tasks(expl, i, lift_usage, expl_begin, expl_end);
 				// Transform literals to a clause
 				reason = get_reason_for_update(expl);
 			}
@@ -1105,7 +1169,7 @@ CumulativeProp::tt_optional_task_propagation() {
 					}
 
 					// Get the negated literals for the tasks in the profile and the resource limit
-					analyse_limit_and_tasks(expl, tt_profile[index].tasks, lift_usage, expl_begin, expl_end);
+					analyse_limit_and_tasks(expl, index, lift_usage, expl_begin, expl_end);
 					// Transform literals to a clause
 					reason = get_reason_for_update(expl);
 				}
@@ -1199,8 +1263,8 @@ int CumulativeProp::find_first_profile_for_ub(ProfilePart profile[], int low, in
  * their explanations                                                   *
  ************************************************************************/
 
-void CumulativeProp::analyse_limit_and_tasks(vec<Lit>& expl, std::set<CUMU_INT>& tasks,
-																						 CUMU_INT lift_usage, CUMU_INT begin, CUMU_INT end) {
+void CumulativeProp::analyse_limit_and_tasks(vec<Lit>& expl, int part, CUMU_INT lift_usage,
+																						 CUMU_INT begin, CUMU_INT end) {
 	CUMU_INT const diff_limit = max_limit0() - max_limit();
 	if (diff_limit > 0) {
 		// Lifting of limit variable if possible
@@ -1216,13 +1280,15 @@ void CumulativeProp::analyse_limit_and_tasks(vec<Lit>& expl, std::set<CUMU_INT>&
 			expl.push(getNegLeqLit(limit, max_limit() + lift_usage));
 		}
 	}
-	analyse_tasks(expl, tasks, lift_usage, begin, end);
+	analyse_tasks(expl, part, lift_usage, begin, end);
 }
 
-void CumulativeProp::analyse_tasks(vec<Lit>& expl, std::set<CUMU_INT>& tasks, CUMU_INT lift_usage,
-																	 CUMU_INT begin, CUMU_INT end) {
-	std::set<CUMU_INT>::iterator iter;
-	for (iter = tasks.begin(); iter != tasks.end(); iter++) {
+void CumulativeProp::analyse_tasks(vec<Lit>& expl, int part, CUMU_INT lift_usage, CUMU_INT begin,
+																	 CUMU_INT end) {
+	int* first;
+	int* last;
+	get_part_tasks(part, first, last);
+	for (int* iter = first; iter != last; iter++) {
 #if CUMUVERB > 10
 		fprintf(stderr, "\ns[%d] in [%d..%d]\n", *iter, start[*iter]->getMin(), start[*iter]->getMax());
 #endif
@@ -1317,9 +1383,132 @@ void cumulative(vec<IntVar*>& s, vec<int>& d, vec<int>& r, int limit) {
 	cumulative(s, d, r, limit, opt);
 }
 
+// Cumulative constraint with fixed durations, resource usages and capacity
+// whose posting is deferred to cumulative_init(), so that constraints over
+// identical start times and durations can be merged
+struct CumuPending {
+	vec<IntVar*> s;
+	vec<int> d;
+	vec<int> r;
+	int limit;
+	std::list<std::string> opt;
+	bool posted{false};
+};
+
+static vec<CumuPending*> cumu_pending;
+
+static void cumulative_post(vec<IntVar*>& s, vec<int>& d, vec<int>& r, int limit,
+														const std::list<std::string>& opt);
+
+// Whether the constraint can be handled by the multi-resource propagator,
+// which only implements time-tabling and energetic reasoning
+static bool cumulative_mergeable(const std::list<std::string>& opt) {
+	for (const auto& it : opt) {
+		if (it == "tt_filt_off" || it == "ttef_check_on" || it == "ttef_filt_on") {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Options without the name of the constraint
+static std::list<std::string> cumulative_options(const std::list<std::string>& opt) {
+	std::list<std::string> res;
+	for (const auto& it : opt) {
+		if (it.find("__name__") != 0) {
+			res.push_back(it);
+		}
+	}
+	return res;
+}
+
 void cumulative(vec<IntVar*>& s, vec<int>& d, vec<int>& r, int limit,
 								const std::list<std::string>& opt) {
 	rassert(s.size() == d.size() && s.size() == r.size());
+	if (so.cumu_global && so.cumu_merge && cumulative_mergeable(opt)) {
+		auto* c = new CumuPending();
+		s.copyTo(c->s);
+		d.copyTo(c->d);
+		r.copyTo(c->r);
+		c->limit = limit;
+		c->opt = opt;
+		cumu_pending.push(c);
+		return;
+	}
+	cumulative_post(s, d, r, limit, opt);
+}
+
+// Posts the deferred cumulative constraints.  Constraints over identical start
+// times and durations (and with the same options) share one multi-resource
+// propagator, the others use the global cumulative propagator.
+void cumulative_init() {
+	for (int i = 0; i < cumu_pending.size(); i++) {
+		CumuPending& c = *cumu_pending[i];
+		if (c.posted) {
+			continue;
+		}
+		const std::list<std::string> c_opt = cumulative_options(c.opt);
+		vec<CumuPending*> group;
+		group.push(&c);
+		for (int j = i + 1; j < cumu_pending.size(); j++) {
+			CumuPending& o = *cumu_pending[j];
+			if (o.posted || o.s.size() != c.s.size() || cumulative_options(o.opt) != c_opt) {
+				continue;
+			}
+			bool same = true;
+			for (int k = 0; same && k < c.s.size(); k++) {
+				same = (o.s[k] == c.s[k] && o.d[k] == c.d[k]);
+			}
+			if (same) {
+				group.push(&o);
+			}
+		}
+		const bool er_check =
+				std::find(c_opt.begin(), c_opt.end(), std::string("er_check_on")) != c_opt.end();
+		if (group.size() == 1 && !er_check) {
+			cumulative_post(c.s, c.d, c.r, c.limit, c.opt);
+			c.posted = true;
+			continue;
+		}
+		std::list<std::string> opt = c_opt;
+		vec<vec<int> > usage;
+		vec<int> limits;
+		for (int g = 0; g < group.size(); g++) {
+			group[g]->posted = true;
+			for (const auto& it : group[g]->opt) {
+				if (it.find("__name__") == 0) {
+					opt.push_back(it);
+				}
+			}
+			// Skipping resources that can never be overloaded
+			int r_sum = 0;
+			for (int k = 0; k < c.s.size(); k++) {
+				if (c.d[k] > 0 && group[g]->r[k] > 0) {
+					if (group[g]->r[k] > group[g]->limit) {
+						TL_FAIL();
+					}
+					r_sum += group[g]->r[k];
+				}
+			}
+			if (r_sum <= group[g]->limit) {
+				continue;
+			}
+			usage.push();
+			group[g]->r.copyTo(usage.last());
+			limits.push(group[g]->limit);
+		}
+		if (limits.size() > 0) {
+			cumulative_multi(c.s, c.d, usage, limits, opt);
+		}
+	}
+	for (int i = 0; i < cumu_pending.size(); i++) {
+		delete cumu_pending[i];
+	}
+	cumu_pending.clear();
+}
+
+static void cumulative_post(vec<IntVar*>& s, vec<int>& d, vec<int>& r, int limit,
+														const std::list<std::string>& opt) {
 	// ASSUMPTION
 	// - s, d, and r contain the same number of elements
 
@@ -2115,6 +2304,212 @@ bool CumulativeProp::ttef_update_bounds(int shift_in(const int, const int, const
 	return true;
 }
 
+/********************************************
+ * TTEF propagator using a Theta-Lambda tree
+ *******************************************/
+
+// The quadratic TTEF propagator above considers all time intervals [begin, end)
+// between an est and an lct of unfixed tasks.  Here, the intervals with the
+// same end are handled at once by a Theta-Lambda tree whose leaves are the
+// unfixed tasks in order of their est's.  A leaf at the est 'begin' has the
+// value C * begin + tt_after(begin) and, for a task lying in [begin, end), its
+// free energy as energy.  Thus [begin, end) is overloaded iff the envelope
+// exceeds C * end + tt_after(end).
+// The energy of tasks partially lying in an interval is not considered (the
+// quadratic propagator uses it), and tasks are only considered for filtering
+// with the first interval for which they are detected as gray leaf.  The
+// explanations are the same as for the quadratic propagator.
+//	Assumptions:
+//	- ttef_initialise_parameters was executed
+bool CumulativeProp::ttef_tree_propagation() {
+	if (!ttef_filt) {
+		return ttef_tree_propagation_lb(nullptr);
+	}
+	std::queue<TTEFUpdate> update1;
+	std::queue<TTEFUpdate> update2;
+	if (!ttef_tree_propagation_lb(&update1)) {
+		return false;
+	}
+	if (!ttef_tree_propagation_ub(update2)) {
+		return false;
+	}
+	if (!ttef_update_bounds(get_free_dur_right_shift, update1)) {
+		return false;
+	}
+	return ttef_update_bounds(get_free_dur_left_shift, update2);
+}
+
+// Consistency check and filtering of the lower bounds (if 'update_queue' is
+// not NULL) by sweeping over the lct's in non-decreasing order
+bool CumulativeProp::ttef_tree_propagation_lb(std::queue<TTEFUpdate>* update_queue) {
+	const int64_t cap = max_limit();
+	int est_idx = 0;
+	ttef_tree.reset(last_unfixed + 1);
+	for (int kk = 0; kk <= last_unfixed; kk++) {
+		ttef_pos[task_id_est[kk]] = kk;
+	}
+	for (int ii = 0; ii <= last_unfixed; ii++) {
+		const int i = task_id_lct[ii];
+		if (min_energy(i) == 0) {
+			continue;
+		}
+		const int end = lct(i);
+		// Adding the tasks starting before 'end' as begin or gray leaves
+		for (; est_idx <= last_unfixed && est(task_id_est[est_idx]) < end; est_idx++) {
+			const int j = task_id_est[est_idx];
+			if (min_energy(j) == 0) {
+				continue;
+			}
+			const int64_t value = cap * est(j) + tt_after_est[est_idx];
+			if (update_queue != nullptr && free_energy(j) > 0) {
+				ttef_tree.setGray(est_idx, value, free_energy(j));
+			} else {
+				ttef_tree.setBegin(est_idx, value);
+			}
+		}
+		// Task i lies in all time intervals ending at 'end'
+		const int pos = ttef_pos[i];
+		ttef_tree.setTheta(pos, cap * est(i) + tt_after_est[pos], free_energy(i));
+		// Checking whether there are further tasks with the same lct
+		int next = ii + 1;
+		while (next <= last_unfixed && min_energy(task_id_lct[next]) == 0) {
+			next++;
+		}
+		if (next <= last_unfixed && lct(task_id_lct[next]) == end) {
+			continue;
+		}
+		const int64_t en_end = cap * end + tt_after_lct[ii];
+		// Check for resource overload
+		if (ttef_tree.env() > en_end) {
+			ttef_tree_overload(get_free_dur_right_shift, est(task_id_est[ttef_tree.envLeaf()]), end);
+			return false;
+		}
+		if (update_queue == nullptr) {
+			continue;
+		}
+		// Check for start time updates
+		while (ttef_tree.envGray() > en_end) {
+			int leaf_begin;
+			int leaf_gray;
+			ttef_tree.envGrayLeaves(leaf_begin, leaf_gray);
+			const int j = task_id_est[leaf_gray];
+			const int begin = est(task_id_est[leaf_begin]);
+			// Energy available in [begin, end) without task j
+			const int en_avail = (int)(en_end - (ttef_tree.envGray() - free_energy(j)));
+			const int en_req_start = std::min(free_energy(j), min_usage(j) * (end - est(j)));
+			if (en_avail < en_req_start) {
+				const int dur_mand = std::max(0, std::min(end, ect(j)) - lst(j));
+				// XXX Is min_usage correct?
+				const int dur_avail = (en_avail + min_usage(j) * dur_mand) / min_usage(j);
+				const int start_new = end - dur_avail;
+				if (start_new > new_est[j]) {
+					// Push possible update into the queue
+					update_queue->emplace(j, start_new, begin, end, 1);
+					new_est[j] = start_new;
+				}
+			}
+			ttef_tree.setBegin(leaf_gray, cap * est(j) + tt_after_est[leaf_gray]);
+		}
+	}
+	return true;
+}
+
+// Filtering of the upper bounds by sweeping over the est's in non-increasing
+// order, i.e., the lower bound filtering on the mirrored time line
+bool CumulativeProp::ttef_tree_propagation_ub(std::queue<TTEFUpdate>& update_queue) {
+	const int64_t cap = max_limit();
+	int lct_idx = last_unfixed;
+	ttef_tree.reset(last_unfixed + 1);
+	for (int kk = 0; kk <= last_unfixed; kk++) {
+		ttef_pos[task_id_lct[kk]] = last_unfixed - kk;
+	}
+	for (int ii = last_unfixed; ii >= 0; ii--) {
+		const int i = task_id_est[ii];
+		if (min_energy(i) == 0) {
+			continue;
+		}
+		const int begin = est(i);
+		// Adding the tasks ending after 'begin' as begin or gray leaves
+		for (; lct_idx >= 0 && lct(task_id_lct[lct_idx]) > begin; lct_idx--) {
+			const int j = task_id_lct[lct_idx];
+			if (min_energy(j) == 0) {
+				continue;
+			}
+			const int64_t value = -cap * lct(j) - tt_after_lct[lct_idx];
+			if (free_energy(j) > 0) {
+				ttef_tree.setGray(last_unfixed - lct_idx, value, free_energy(j));
+			} else {
+				ttef_tree.setBegin(last_unfixed - lct_idx, value);
+			}
+		}
+		// Task i lies in all time intervals beginning at 'begin'
+		const int pos = ttef_pos[i];
+		ttef_tree.setTheta(pos, -cap * lct(i) - tt_after_lct[last_unfixed - pos], free_energy(i));
+		// Checking whether there are further tasks with the same est
+		int next = ii - 1;
+		while (next >= 0 && min_energy(task_id_est[next]) == 0) {
+			next--;
+		}
+		if (next >= 0 && est(task_id_est[next]) == begin) {
+			continue;
+		}
+		const int64_t en_begin = -cap * begin - tt_after_est[ii];
+		// Check for resource overload
+		if (ttef_tree.env() > en_begin) {
+			const int end = lct(task_id_lct[last_unfixed - ttef_tree.envLeaf()]);
+			ttef_tree_overload(get_free_dur_left_shift, begin, end);
+			return false;
+		}
+		// Check for end time updates
+		while (ttef_tree.envGray() > en_begin) {
+			int leaf_end;
+			int leaf_gray;
+			ttef_tree.envGrayLeaves(leaf_end, leaf_gray);
+			const int j = task_id_lct[last_unfixed - leaf_gray];
+			const int end = lct(task_id_lct[last_unfixed - leaf_end]);
+			// Energy available in [begin, end) without task j
+			const int en_avail = (int)(en_begin - (ttef_tree.envGray() - free_energy(j)));
+			const int en_req_end = std::min(free_energy(j), min_usage(j) * (lct(j) - begin));
+			if (en_avail < en_req_end) {
+				const int dur_mand = std::max(0, ect(j) - std::max(begin, lst(j)));
+				// XXX Is min_usage correct?
+				const int dur_avail = (en_avail + min_usage(j) * dur_mand) / min_usage(j);
+				const int end_new = begin + dur_avail;
+				if (end_new < new_lct[j]) {
+					// Push possible update into the queue
+					update_queue.emplace(j, end_new, begin, end, 0);
+					new_lct[j] = end_new;
+				}
+			}
+			ttef_tree.setBegin(leaf_gray, -cap * lct(j) - tt_after_lct[last_unfixed - leaf_gray]);
+		}
+	}
+	return true;
+}
+
+// Explains and submits a resource overload in the time interval [begin, end)
+void CumulativeProp::ttef_tree_overload(int shift_in(const int, const int, const int, const int,
+																										 const int, const int, const int),
+																				int begin, int end) {
+	vec<Lit> expl;
+	// Increment the inconsistency counter
+	nb_ttef_incons++;
+	if (so.lazy) {
+		std::list<TaskDur> tasks_tw;
+		std::list<TaskDur> tasks_cp;
+		// Retrieve tasks involved
+		const int en_req = ttef_retrieve_tasks(shift_in, begin, end, -1, tasks_tw, tasks_cp);
+		// Calculate the lifting
+		int en_lift = en_req - 1 - max_limit() * (end - begin);
+		assert(en_lift >= 0);
+		// Explaining the overload
+		ttef_analyse_limit_and_tasks(begin, end, tasks_tw, tasks_cp, en_lift, expl);
+		assert(expl.size() > 0);
+	}
+	// Submitting of the conflict explanation
+	submit_conflict_explanation(expl);
+}
+
 int CumulativeProp::ttef_retrieve_tasks(int shift_in(const int, const int, const int, const int,
 																										 const int, const int, const int),
 																				int begin, int end, int fb_id, std::list<TaskDur>& tasks_tw,
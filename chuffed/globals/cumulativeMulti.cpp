@@ -0,0 +1,467 @@
+#include "chuffed/core/engine.h"
+#include "chuffed/core/options.h"
+#include "chuffed/core/propagator.h"
+#include "chuffed/core/sat-types.h"
+#include "chuffed/core/sat.h"
+#include "chuffed/support/misc.h"
+#include "chuffed/support/vec.h"
+#include "chuffed/vars/int-var.h"
+#include "chuffed/vars/vars.h"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstdio>
+#include <iostream>
+#include <list>
+#include <string>
+
+// Cumulative propagator for several resources used by the same tasks, i.e.,
+// for cumulative constraints over identical start times and durations with
+// fixed resource usages and capacities.
+//
+// The task windows, the fixed tasks and the sort orders used for building the
+// resource profiles are shared between all resources.  Each resource has its
+// own time-table consistency check and start time filtering, and optionally an
+// energetic reasoning consistency check.  Explanations are built eagerly.
+class CumulativeMultiProp : public Propagator {
+	Tint last_unfixed;
+
+public:
+	std::string name;  // Names of the cumulative constraints for printing statistics
+
+	// Constant Data
+	vec<IntVar*> start;     // Start time variables of the tasks
+	vec<int> dur;           // Durations of the tasks
+	vec<vec<int> > usage;   // Resource usages of the tasks, per resource
+	vec<int> limit;         // Resource capacities
+
+	// Options
+	bool er_check;  // Energetic reasoning consistency check
+
+	// Counters
+	long nb_tt_incons{0};  // Number of timetabling inconsistencies
+	long nb_tt_filt{0};    // Number of timetabling propagations
+	long nb_er_incons{0};  // Number of energetic reasoning inconsistencies
+
+	// Structures
+	vec<int> task_id;  // Unfixed tasks on the left-hand side and fixed tasks on the right-hand side
+	int* est_c;        // Bounds at the start of propagate()
+	int* lst_c;
+	int* lst_order;  // All tasks, kept sorted by lst across propagations
+	int* ect_order;  // All tasks, kept sorted by ect across propagations
+	int* est_order;  // All tasks, kept sorted by est across propagations
+	// Profile of the current resource: disjoint parts [prof_begin, prof_end) in
+	// chronological order
+	int* prof_begin;
+	int* prof_end;
+	int* prof_level;
+	int prof_size;
+	int prof_max;  // Maximal level of the profile
+	int* cp_task;  // Tasks of the current resource with a compulsory part
+	int cp_size;
+	// Energetic reasoning: tasks with a positive minimal intersection with
+	// [t1, ...), ordered by the end of their ramp
+	int* er_task;
+	int* er_end;
+
+	CumulativeMultiProp(vec<IntVar*>& _start, vec<int>& _dur, vec<vec<int> >& _usage,
+											vec<int>& _limit, const std::list<std::string>& opt)
+			: start(_start), dur(_dur), limit(_limit), er_check(false) {
+		for (int r = 0; r < _usage.size(); r++) {
+			usage.push();
+			_usage[r].copyTo(usage.last());
+		}
+		for (const auto& it : opt) {
+			if (it == "er_check_on") {
+				er_check = true;
+			} else if (it == "er_check_off") {
+				er_check = false;
+			} else if (it.find("__name__") == 0) {
+				name += (name.empty() ? "" : ", ") + it.substr(8);
+			}
+		}
+		const int n = start.size();
+		est_c = new int[n];
+		lst_c = new int[n];
+		lst_order = new int[n];
+		ect_order = new int[n];
+		est_order = new int[n];
+		prof_begin = new int[2 * n];
+		prof_end = new int[2 * n];
+		prof_level = new int[2 * n];
+		prof_size = 0;
+		cp_task = new int[n];
+		cp_size = 0;
+		er_task = new int[n];
+		er_end = new int[n];
+		for (int i = 0; i < n; i++) {
+			lst_order[i] = ect_order[i] = est_order[i] = i;
+			task_id.push(i);
+		}
+		last_unfixed = n - 1;
+
+		// Priority of the propagator
+		priority = 3;
+
+		// Attach to var events
+		for (int i = 0; i < n; i++) {
+			start[i]->attach(this, i, EVENT_LU);
+		}
+	}
+
+	// Statistics
+	void printStats() override {
+		fprintf(stderr, "%% Multi-resource cumulative propagator statistics");
+		if (!name.empty()) {
+			std::cerr << " for " << name;
+		}
+		fprintf(stderr, ":\n");
+		fprintf(stderr, "%%\t#resources: %d\n", limit.size());
+		fprintf(stderr, "%%\t#TT incons.: %ld\n", nb_tt_incons);
+		fprintf(stderr, "%%\t#TT prop.: %ld\n", nb_tt_filt);
+		if (er_check) {
+			fprintf(stderr, "%%\t#ER incons.: %ld\n", nb_er_incons);
+		}
+	}
+
+	// Task windows at the start of propagate()
+	int est(int i) const { return est_c[i]; }
+	int lst(int i) const { return lst_c[i]; }
+	int ect(int i) const { return est_c[i] + dur[i]; }
+	int lct(int i) const { return lst_c[i] + dur[i]; }
+
+	// Whether task i has a compulsory part on resource r
+	bool has_comp_part(int r, int i) const { return usage[r][i] > 0 && lst(i) < ect(i); }
+
+	// Sorts 'order' by 'key' with an insertion sort.  The orders are kept from
+	// the previous propagation, so they are nearly sorted.
+	template <class Key>
+	static void insertion_sort(int* order, int size, Key key) {
+		for (int i = 1; i < size; i++) {
+			const int t = order[i];
+			const int k = key(t);
+			int j = i;
+			for (; j > 0 && key(order[j - 1]) > k; j--) {
+				order[j] = order[j - 1];
+			}
+			order[j] = t;
+		}
+	}
+
+	bool propagate() override {
+		const int n = start.size();
+		// Moving fixed tasks to the right-hand side
+		int new_unfixed = last_unfixed;
+		for (int ii = new_unfixed; ii >= 0; ii--) {
+			const int i = task_id[ii];
+			if (start[i]->isFixed() || dur[i] <= 0) {
+				task_id[ii] = task_id[new_unfixed];
+				task_id[new_unfixed] = i;
+				new_unfixed--;
+			}
+		}
+		last_unfixed = new_unfixed;
+
+		// Shared task windows and orders
+		for (int i = 0; i < n; i++) {
+			est_c[i] = start[i]->getMin();
+			lst_c[i] = start[i]->getMax();
+		}
+		insertion_sort(lst_order, n, [this](int i) { return lst(i); });
+		insertion_sort(ect_order, n, [this](int i) { return ect(i); });
+		if (er_check) {
+			insertion_sort(est_order, n, [this](int i) { return est(i); });
+		}
+
+		for (int r = 0; r < limit.size(); r++) {
+			create_profile(r);
+			if (!time_table_check(r) || !time_table_filtering(r)) {
+				return false;
+			}
+			if (er_check && last_unfixed >= 0 && !energetic_check(r)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Builds the profile of resource r by merging the starts (lst) and ends
+	// (ect) of the compulsory parts, ends before starts at the same time point
+	// Runtime complexity: O(n)
+	//
+	void create_profile(int r) {
+		const int n = start.size();
+		const vec<int>& u = usage[r];
+		int il = 0;
+		int ie = 0;
+		int level = 0;
+		int cur_time = 0;
+		prof_size = 0;
+		prof_max = 0;
+		cp_size = 0;
+		while (true) {
+			while (il < n && !has_comp_part(r, lst_order[il])) {
+				il++;
+			}
+			while (ie < n && !has_comp_part(r, ect_order[ie])) {
+				ie++;
+			}
+			if (ie >= n) {
+				break;
+			}
+			const bool is_start = il < n && lst(lst_order[il]) < ect(ect_order[ie]);
+			const int i = is_start ? lst_order[il++] : ect_order[ie++];
+			const int time = is_start ? lst(i) : ect(i);
+			if (level > 0 && time > cur_time) {
+				prof_begin[prof_size] = cur_time;
+				prof_end[prof_size] = time;
+				prof_level[prof_size] = level;
+				prof_max = std::max(prof_max, level);
+				prof_size++;
+			}
+			if (is_start) {
+				cp_task[cp_size++] = i;
+				level += u[i];
+			} else {
+				level -= u[i];
+			}
+			cur_time = time;
+		}
+	}
+
+	// Negated literals of [[s_i >= val]] and [[s_i <= val]], if not implied by
+	// the initial domain
+	void push_geq(vec<Lit>& ps, int i, int val) {
+		IntVar* v = start[i];
+		if (val > v->getMin0()) {
+			ps.push(INT_VAR_LL == v->getType() ? v->getMinLit() : v->getLit(val - 1, LR_LE));
+		}
+	}
+
+	void push_leq(vec<Lit>& ps, int i, int val) {
+		IntVar* v = start[i];
+		if (val < v->getMax0()) {
+			ps.push(INT_VAR_LL == v->getType() ? v->getMaxLit() : v->getLit(val + 1, LR_GE));
+		}
+	}
+
+	// Explains that tasks other than 'excl' use at least 'need' units of
+	// resource r during [begin, end], which is inside profile part p
+	void explain_part(vec<Lit>& ps, int r, int p, int begin, int end, int excl, int need) {
+		for (int k = 0; k < cp_size && need > 0; k++) {
+			const int t = cp_task[k];
+			if (t == excl || lst(t) > prof_begin[p] || ect(t) < prof_end[p]) {
+				continue;
+			}
+			push_leq(ps, t, begin);
+			push_geq(ps, t, end - dur[t] + 1);
+			need -= usage[r][t];
+		}
+		assert(need <= 0);
+	}
+
+	// Time-table consistency check
+	bool time_table_check(int r) {
+		for (int p = 0; p < prof_size; p++) {
+			if (prof_level[p] > limit[r]) {
+				nb_tt_incons++;
+				Clause* reason = nullptr;
+				if (so.lazy) {
+					// Point-wise explanation at the begin of the profile part
+					vec<Lit> ps;
+					explain_part(ps, r, p, prof_begin[p], prof_begin[p], -1, limit[r] + 1);
+					reason = Reason_new(ps.size());
+					for (int k = 0; k < ps.size(); k++) {
+						(*reason)[k] = ps[k];
+					}
+				}
+				sat.confl = reason;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Whether task i does not fit next to the profile part p of resource r
+	bool is_conflicting(int r, int p, int i) const {
+		if (prof_level[p] + usage[r][i] <= limit[r]) {
+			return false;
+		}
+		// The own compulsory part of i covers the part, which is not overloaded
+		return !(lst(i) <= prof_begin[p] && ect(i) >= prof_end[p] && lst(i) < ect(i));
+	}
+
+	// Time-table filtering of the start times of the unfixed tasks
+	// Runtime complexity: O(n log n) plus the number of profile parts passed
+	//
+	bool time_table_filtering(int r) {
+		if (prof_size == 0) {
+			return true;
+		}
+		for (int ii = 0; ii <= last_unfixed; ii++) {
+			const int i = task_id[ii];
+			if (usage[r][i] <= 0 || usage[r][i] + prof_max <= limit[r]) {
+				continue;
+			}
+			const int d = dur[i];
+			// Lower bound: first part ending after est
+			int b = start[i]->getMin();
+			int p = std::upper_bound(prof_end, prof_end + prof_size, b) - prof_end;
+			for (; p < prof_size && prof_begin[p] < b + d; p++) {
+				if (!is_conflicting(r, p, i)) {
+					continue;
+				}
+				// i overlaps [a, prof_end[p]) for all s_i in [a - d + 1, prof_end[p] - 1]
+				const int a = std::min(prof_end[p] - 1, b + d - 1);
+				Clause* reason = nullptr;
+				if (so.lazy) {
+					vec<Lit> ps(1);
+					push_geq(ps, i, a - d + 1);
+					explain_part(ps, r, p, a, prof_end[p] - 1, i, limit[r] - usage[r][i] + 1);
+					reason = Reason_new(ps);
+				}
+				b = prof_end[p];
+				nb_tt_filt++;
+				if (start[i]->setMinNotR(b) && !start[i]->setMin(b, reason)) {
+					return false;
+				}
+			}
+			// Upper bound: last part beginning before lct
+			b = start[i]->getMax();
+			p = std::lower_bound(prof_begin, prof_begin + prof_size, b + d) - prof_begin - 1;
+			for (; p >= 0 && prof_end[p] > b; p--) {
+				if (!is_conflicting(r, p, i)) {
+					continue;
+				}
+				// i overlaps [prof_begin[p], a] for all s_i in [prof_begin[p] - d + 1, a]
+				const int a = std::max(prof_begin[p], b);
+				Clause* reason = nullptr;
+				if (so.lazy) {
+					vec<Lit> ps(1);
+					push_leq(ps, i, a);
+					explain_part(ps, r, p, prof_begin[p], a, i, limit[r] - usage[r][i] + 1);
+					reason = Reason_new(ps);
+				}
+				b = prof_begin[p] - d;
+				nb_tt_filt++;
+				if (start[i]->setMaxNotR(b) && !start[i]->setMax(b, reason)) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// Minimal intersection of task i with [t1, t2)
+	int min_intersection(int i, int t1, int t2) const {
+		const int mi = std::min(std::min(t2 - t1, dur[i]), std::min(ect(i) - t1, t2 - lst(i)));
+		return std::max(0, mi);
+	}
+
+	// Energetic reasoning consistency check on the promising intervals [t1, t2)
+	// where t1 is the est of an unfixed task.  For a fixed t1, the minimal
+	// intersection of a task with [t1, t2) is a ramp in t2 starting at
+	// max(t1, lst) and the overload can only be maximal at the end of a ramp.
+	// Runtime complexity: O(n^2 log n)
+	//
+	bool energetic_check(int r) {
+		const int n = start.size();
+		const vec<int>& u = usage[r];
+		const long long cap = limit[r];
+		int last_t1 = INT_MIN;
+		for (int jj = 0; jj < n; jj++) {
+			const int j = est_order[jj];
+			const int t1 = est(j);
+			if (t1 == last_t1 || u[j] <= 0 || dur[j] <= 0 || start[j]->isFixed()) {
+				continue;
+			}
+			last_t1 = t1;
+			// Ramps of the tasks with a positive minimal intersection
+			int m = 0;
+			long long e_max = 0;
+			for (int k = 0; k < n; k++) {
+				const int len = std::min(dur[k], ect(k) - t1);
+				if (u[k] <= 0 || len <= 0) {
+					continue;
+				}
+				er_task[m] = k;
+				er_end[k] = std::max(t1, lst(k)) + len;
+				e_max += (long long)u[k] * len;
+				m++;
+			}
+			if (m == 0) {
+				continue;
+			}
+			std::sort(er_task, er_task + m, [this](int a, int b) { return er_end[a] < er_end[b]; });
+			if (e_max <= cap * (er_end[er_task[0]] - t1)) {
+				// Not even the whole energy overloads the shortest interval
+				continue;
+			}
+			// Sweep over the ramp starts (in lst order) and ends
+			long long energy = 0;
+			long long slope = 0;
+			int time = t1;
+			int is = 0;
+			for (int ie = 0; ie < m; ie++) {
+				const int t2 = er_end[er_task[ie]];
+				for (; is < n; is++) {
+					const int k = lst_order[is];
+					const int ramp = std::max(t1, lst(k));
+					if (ramp >= t2) {
+						break;
+					}
+					const int len = std::min(dur[k], ect(k) - t1);
+					if (u[k] <= 0 || len <= 0) {
+						continue;
+					}
+					energy += slope * (ramp - time);
+					time = ramp;
+					slope += u[k];
+				}
+				energy += slope * (t2 - time);
+				time = t2;
+				slope -= u[er_task[ie]];
+				if (energy > cap * (t2 - t1)) {
+					nb_er_incons++;
+					if (so.lazy) {
+						energetic_explanation(r, t1, t2, energy - cap * (t2 - t1) - 1, m);
+					} else {
+						sat.confl = nullptr;
+					}
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// Explanation of an overload of [t1, t2), lifted by reducing the minimal
+	// intersections of the tasks within the slack
+	void energetic_explanation(int r, int t1, int t2, long long slack, int m) {
+		vec<Lit> ps;
+		for (int ii = 0; ii < m; ii++) {
+			const int k = er_task[ii];
+			int mi = min_intersection(k, t1, t2);
+			const long long reduce = std::min((long long)mi, slack / usage[r][k]);
+			slack -= reduce * usage[r][k];
+			mi -= (int)reduce;
+			if (mi <= 0) {
+				continue;
+			}
+			push_geq(ps, k, t1 + mi - dur[k]);
+			push_leq(ps, k, t2 - mi);
+		}
+		Clause* reason = Reason_new(ps.size());
+		for (int k = 0; k < ps.size(); k++) {
+			(*reason)[k] = ps[k];
+		}
+		sat.confl = reason;
+	}
+};
+
+void cumulative_multi(vec<IntVar*>& s, vec<int>& d, vec<vec<int> >& r, vec<int>& limit,
+											const std::list<std::string>& opt) {
+	rassert(r.size() == limit.size());
+	new CumulativeMultiProp(s, d, r, limit, opt);
+}
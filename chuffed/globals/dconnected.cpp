@@ -20,36 +20,8 @@
 
 #define DEBUG 0
 
-FilteredLT::FilteredLT(GraphPropagator* _p, int _r, std::vector<std::vector<int> > _en,
-											 std::vector<std::vector<int> > _in, std::vector<std::vector<int> > _ou)
-		: LengauerTarjan(_r, std::move(_en), std::move(_in), std::move(_ou)), p(_p) {}
-
-int FilteredLT::get_visited_innodes() const {
-	// visited_innodes = 0;
-	// for (int i = 0; i < p->nbNodes(); i++) {
-	//     if (p->getNodeVar(i).isFixed() && p->getNodeVar(i).isTrue())
-	//         if (visited_dfs(i))
-	//             visited_innodes++;
-	// }
-	return visited_innodes;
-}
-
-void FilteredLT::init() {
-	visited_innodes = 0;
-	LengauerTarjan::init();
-}
-
-void FilteredLT::DFS(int r) {
-	if (DEBUG) {
-		std::cout << "DFS Visiting " << r << " " << p->getNodeVar(r).isFixed()
-							<< ((p->getNodeVar(r).isFixed()) ? static_cast<int>(p->getNodeVar(r).isTrue()) : -1)
-							<< '\n';
-	}
-	if (p->getNodeVar(r).isFixed() && p->getNodeVar(r).isTrue()) {
-		visited_innodes++;
-	}
-	LengauerTarjan::DFS(r);
-}
+FilteredLT::FilteredLT(GraphPropagator* _p, int _r, const CSRGraph& g)
+		: LengauerTarjan(_r, g), p(_p) {}
 
 bool FilteredLT::ignore_node(int u) {
 	if (p->getNodeVar(u).isFixed() && p->getNodeVar(u).isFalse()) {
@@ -302,44 +274,30 @@ DReachabilityPropagator::DReachabilityPropagator(int _r, vec<BoolView>& _vs, vec
 																								 vec<vec<edge_id> >& _in, vec<vec<edge_id> >& _out,
 																								 vec<vec<int> >& _en)
 		: GraphPropagator(_vs, _es, _en), root(_r), in_nodes_tsize(0) {
-	adj = std::vector<std::vector<int> >(_in.size(), std::vector<int>());
+	std::vector<std::vector<int> > _adj(_in.size(), std::vector<int>());
 	for (int i = 0; i < _in.size(); i++) {
 		for (int j = 0; j < _in[i].size(); j++) {
-			adj[i].push_back(_in[i][j]);
+			_adj[i].push_back(_in[i][j]);
 		}
 		for (int j = 0; j < _out[i].size(); j++) {
-			adj[i].push_back(_out[i][j]);
+			_adj[i].push_back(_out[i][j]);
 		}
 	}
+	adj = CSRLists(_adj);
 
-	for (int i = 0; i < _in.size(); i++) {
-		if (DEBUG) {
+	in = CSRLists(_in);
+	ou = CSRLists(_out);
+	if (DEBUG) {
+		for (int i = 0; i < nbNodes(); i++) {
 			std::cout << "Incident to " << i << ": ";
-		}
-		in.emplace_back();
-		for (int j = 0; j < _in[i].size(); j++) {
-			in[i].push_back(_in[i][j]);
-			if (DEBUG) {
-				std::cout << _in[i][j] << ", ";
+			for (const int e : in[i]) {
+				std::cout << e << ", ";
 			}
-		}
-		if (DEBUG) {
 			std::cout << '\n';
-		}
-	}
-
-	for (int i = 0; i < _out.size(); i++) {
-		ou.emplace_back();
-		if (DEBUG) {
 			std::cout << "Outgoing from " << i << ": ";
-		}
-		for (int j = 0; j < _out[i].size(); j++) {
-			ou[i].push_back(_out[i][j]);
-			if (DEBUG) {
-				std::cout << _out[i][j] << ", ";
+			for (const int e : ou[i]) {
+				std::cout << e << ", ";
 			}
-		}
-		if (DEBUG) {
 			std::cout << '\n';
 		}
 	}
@@ -357,28 +315,7 @@ DReachabilityPropagator::DReachabilityPropagator(int _r, vec<BoolView>& _vs, vec
 	memset(last_state_n, UNK, sizeof(Tint) * nbNodes());
 	memset(last_state_e, UNK, sizeof(Tint) * nbEdges());
 
-	std::vector<std::vector<int> > en(nbEdges(), std::vector<int>());
-	for (int i = 0; i < _en.size(); i++) {
-		for (int j = 0; j < _en[i].size(); j++) {
-			en[i].push_back(_en[i][j]);
-		}
-	}
-
-	std::vector<std::vector<int> > in(nbNodes(), std::vector<int>());
-	for (int i = 0; i < _in.size(); i++) {
-		for (int j = 0; j < _in[i].size(); j++) {
-			in[i].push_back(_in[i][j]);
-		}
-	}
-
-	std::vector<std::vector<int> > ou(nbNodes(), std::vector<int>());
-	for (int i = 0; i < _out.size(); i++) {
-		for (int j = 0; j < _out[i].size(); j++) {
-			ou[i].push_back(_out[i][j]);
-		}
-	}
-
-	lt = new FilteredLT(this, get_root_idx(), en, in, ou);
+	lt = new FilteredLT(this, get_root_idx(), CSRGraph(endnodes, in, ou));
 
 	for (int i = 0; i < nbNodes(); i++) {
 		getNodeVar(i).attach(this, i, EVENT_LU);
@@ -604,9 +541,15 @@ bool DReachabilityPropagator::propagateRemNode(int node) {
 bool DReachabilityPropagator::_propagateReachability(bool local) {
 	update_innodes();
 	// cout <<"PROPAGATE REACHABILITY"<<endl;
-	lt->init();
-	lt->LengauerTarjan::DFS();
-	const int reached = lt->get_visited_innodes();
+	// Dominators are kept across calls and only repaired where removals
+	// made a difference
+	lt->update();
+	int reached = 0;
+	for (const int i : in_nodes_list) {
+		if (lt->visited_dfs(i)) {
+			reached++;
+		}
+	}
 	if (DEBUG) {
 		std::cout << "Reached " << reached << " in_nodes_tsize " << in_nodes_tsize
 							<< " in_nodes.size() " << in_nodes_list.size() << '\n';
@@ -662,12 +605,14 @@ bool DReachabilityPropagator::_propagateReachability(bool local) {
 		}
 	}  //*/
 
-	lt->find_doms();
 	// for (int i = 0; i < nbNodes(); i++)
 	//     cerr <<"("<<i <<","<< lt->dominator(i)<<") ";
 	// cerr<<endl;
 
-	for (const int u : in_nodes_list) {
+	// The loop below may add innodes, only look at the ones known so far
+	const int nb_in_nodes = in_nodes_list.size();
+	for (int k = 0; k < nb_in_nodes; k++) {
+		const int u = in_nodes_list[k];
 		assert(getNodeVar(u).isFixed());
 		assert(getNodeVar(u).isTrue());
 		if (DEBUG) {
@@ -14,16 +14,9 @@
 
 class FilteredLT : public LengauerTarjan {
 	GraphPropagator* p;
-	int visited_innodes{0};
-
-protected:
-	void DFS(int r) override;
 
 public:
-	FilteredLT(GraphPropagator* _p, int _r, std::vector<std::vector<int> > _en,
-						 std::vector<std::vector<int> > _in, std::vector<std::vector<int> > _ou);
-	int get_visited_innodes() const;
-	void init() override;
+	FilteredLT(GraphPropagator* _p, int _r, const CSRGraph& g);
 	bool ignore_node(int u) override;
 	bool ignore_edge(int e) override;
 };
@@ -53,8 +46,8 @@ protected:
 	std::set<int> new_edge;
 	std::set<int> rem_edge;
 
-	std::vector<std::vector<edge_id> > in;
-	std::vector<std::vector<edge_id> > ou;
+	CSRLists in;
+	CSRLists ou;
 
 	int get_some_innode_not(int other_than);
 	int get_root_idx() const;
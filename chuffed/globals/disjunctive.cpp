@@ -5,6 +5,7 @@
 #include "chuffed/core/sat.h"
 #include "chuffed/primitives/primitives.h"
 #include "chuffed/support/heap.h"
+#include "chuffed/support/theta_lambda_tree.h"
 #include "chuffed/support/vec.h"
 #include "chuffed/vars/bool-view.h"
 #include "chuffed/vars/int-var.h"
@@ -616,4 +617,451 @@ public:
 	}
 };
 
-void disjunctive(vec<IntVar*>& x, vec<int>& dur) { new DisjunctiveEF(x, dur); }
+// Unary resource propagator based on Theta-Lambda trees (Vilim):
+// - overload checking and edge finding, in O(n log n),
+// - detectable precedences, in O(n log n),
+// - not-first/not-last, in O(n log n) plus the scan for the tightest bound.
+// Every rule is run on the tasks and on their mirror image (time negated),
+// which turns lower bound into upper bound updates and not-last into
+// not-first.  All rules work on the bounds at the start of propagate(), the
+// best updates are applied at the end, with eagerly built explanations.
+// Tasks must have positive durations.
+class DisjunctiveTheta : public Propagator {
+	// Bound update, in the original time line
+	struct Update {
+		int task;
+		bool is_lb;
+		int bound;
+		Clause* reason;
+		Update(int t, bool l, int b, Clause* r) : task(t), is_lb(l), bound(b), reason(r) {}
+	};
+
+public:
+	// constant data
+	vec<IntVar*> x;  // start times
+	vec<int> dur;    // durations of tasks
+
+	// Persistent non-trailed state, kept sorted across propagations
+	int* ests;  // task no. sorted according to est in ascending order
+	int* lcts;  // task no. sorted according to lct in ascending order
+	int* lsts;  // task no. sorted according to lst in ascending order
+	int* ects;  // task no. sorted according to ect in ascending order
+
+	// Intermediate state
+	bool mirror;      // Whether the rules work on the mirror image
+	int* est_c;       // Bounds at the start of propagate()
+	int* lct_c;
+	int* ord_est;     // Task orders of the current time line
+	int* ord_lct;
+	int* ord_lst;
+	int* ord_ect;
+	int* pos;         // Leaf of the task in tree
+	bool* in_theta;
+	ThetaLambdaTree tree;
+	int* new_min;     // Best pending bounds
+	int* new_max;
+	vec<Update> updates;
+	int expl_stamp;
+	int* expl_mark;  // Explanation: tasks whose bounds are needed,
+	int* expl_lb;    // with their bounds in the current time line
+	int* expl_ub;
+	vec<int> expl_tasks;
+
+	// Statistics
+	long nb_overload{0};
+	long nb_ef{0};
+	long nb_dp{0};
+	long nb_nfnl{0};
+
+	DisjunctiveTheta(vec<IntVar*>& _x, vec<int>& _dur) : x(_x), dur(_dur), mirror(false) {
+		priority = 3;
+		const int n = x.size();
+		ests = new int[n];
+		lcts = new int[n];
+		lsts = new int[n];
+		ects = new int[n];
+		est_c = new int[n];
+		lct_c = new int[n];
+		ord_est = new int[n];
+		ord_lct = new int[n];
+		ord_lst = new int[n];
+		ord_ect = new int[n];
+		pos = new int[n];
+		in_theta = new bool[n];
+		new_min = new int[n];
+		new_max = new int[n];
+		expl_stamp = 0;
+		expl_mark = new int[n];
+		expl_lb = new int[n];
+		expl_ub = new int[n];
+		for (int i = 0; i < n; i++) {
+			ests[i] = lcts[i] = lsts[i] = ects[i] = i;
+			expl_mark[i] = 0;
+		}
+		for (int i = 0; i < n; i++) {
+			x[i]->attach(this, i, EVENT_LU);
+		}
+	}
+
+	void printStats() override {
+		fprintf(stderr, "%% Disjunctive propagator statistics:\n");
+		fprintf(stderr, "%%\t#Overload incons.: %ld\n", nb_overload);
+		fprintf(stderr, "%%\t#EF prop.: %ld\n", nb_ef);
+		fprintf(stderr, "%%\t#DP prop.: %ld\n", nb_dp);
+		fprintf(stderr, "%%\t#NF/NL prop.: %ld\n", nb_nfnl);
+	}
+
+	// Bounds in the current time line
+	int est(int i) const { return mirror ? -lct_c[i] : est_c[i]; }
+	int lct(int i) const { return mirror ? -est_c[i] : lct_c[i]; }
+	int lst(int i) const { return lct(i) - dur[i]; }
+	int ect(int i) const { return est(i) + dur[i]; }
+
+	template <class Key>
+	static void insertionSort(int* order, int size, Key key) {
+		for (int i = 1; i < size; i++) {
+			const int t = order[i];
+			const int k = key(t);
+			int j = i;
+			for (; j > 0 && key(order[j - 1]) > k; j--) {
+				order[j] = order[j - 1];
+			}
+			order[j] = t;
+		}
+	}
+
+	// Sets up the task orders of the current time line
+	void setTimeLine(bool m) {
+		const int n = x.size();
+		mirror = m;
+		for (int k = 0; k < n; k++) {
+			// est' = -lct, lct' = -est, lst' = -ect, ect' = -lst
+			ord_est[k] = m ? lcts[n - 1 - k] : ests[k];
+			ord_lct[k] = m ? ests[n - 1 - k] : lcts[k];
+			ord_lst[k] = m ? ects[n - 1 - k] : lsts[k];
+			ord_ect[k] = m ? lsts[n - 1 - k] : ects[k];
+		}
+		for (int k = 0; k < n; k++) {
+			pos[ord_est[k]] = k;
+		}
+	}
+
+	// Total duration of the tasks in Theta at the leaves from 'leaf' on, i.e.,
+	// of the set responsible for an envelope starting at 'leaf'
+	int thetaDur(int leaf) {
+		int p = 0;
+		for (int k = leaf; k < x.size(); k++) {
+			if (in_theta[ord_est[k]]) {
+				p += dur[ord_est[k]];
+			}
+		}
+		return p;
+	}
+
+	// Adds the tasks in Theta at the leaves from 'leaf' on to the explanation,
+	// with s'_k >= lb and s'_k <= ub (- dur_k if 'minus_dur')
+	void thetaNeed(int leaf, int lb, int ub, bool minus_dur) {
+		for (int k = leaf; k < x.size(); k++) {
+			const int i = ord_est[k];
+			if (in_theta[i]) {
+				explNeed(i, lb, minus_dur ? ub - dur[i] : ub);
+			}
+		}
+	}
+
+	// Explanations are collected as bounds on the start times in the current
+	// time line and converted into literals by explFinish
+	void explStart() {
+		expl_stamp++;
+		expl_tasks.clear();
+	}
+
+	void explNeed(int i, int lb, int ub) {
+		if (expl_mark[i] != expl_stamp) {
+			expl_mark[i] = expl_stamp;
+			expl_lb[i] = lb;
+			expl_ub[i] = ub;
+			expl_tasks.push(i);
+		} else {
+			expl_lb[i] = std::max(expl_lb[i], lb);
+			expl_ub[i] = std::min(expl_ub[i], ub);
+		}
+	}
+
+	static Lit getNegGeqLit(IntVar* v, int val) {
+		return (INT_VAR_LL == v->getType() ? v->getMinLit() : v->getLit(val - 1, LR_LE));
+	}
+
+	static Lit getNegLeqLit(IntVar* v, int val) {
+		return (INT_VAR_LL == v->getType() ? v->getMaxLit() : v->getLit(val + 1, LR_GE));
+	}
+
+	// Pushes the negated literal of [[s_i >= lb]] in the original time line
+	void pushGeq(vec<Lit>& ps, int i, int lb) {
+		if (lb > x[i]->getMin0()) {
+			ps.push(getNegGeqLit(x[i], lb));
+		}
+	}
+
+	void pushLeq(vec<Lit>& ps, int i, int ub) {
+		if (ub < x[i]->getMax0()) {
+			ps.push(getNegLeqLit(x[i], ub));
+		}
+	}
+
+	// s'_i = -(s_i + dur_i) in the mirror image
+	void explFinish(vec<Lit>& ps) {
+		for (int k = 0; k < expl_tasks.size(); k++) {
+			const int i = expl_tasks[k];
+			if (expl_lb[i] > INT_MIN) {
+				if (mirror) {
+					pushLeq(ps, i, -expl_lb[i] - dur[i]);
+				} else {
+					pushGeq(ps, i, expl_lb[i]);
+				}
+			}
+			if (expl_ub[i] < INT_MAX) {
+				if (mirror) {
+					pushGeq(ps, i, -expl_ub[i] - dur[i]);
+				} else {
+					pushLeq(ps, i, expl_ub[i]);
+				}
+			}
+		}
+	}
+
+	Clause* explReason() {
+		if (!so.lazy) {
+			return nullptr;
+		}
+		vec<Lit> ps(1);
+		explFinish(ps);
+		return Reason_new(ps);
+	}
+
+	// Whether [[s'_i >= b]] in the current time line improves the pending bounds
+	bool improvesEst(int i, int b) const {
+		return mirror ? -b - dur[i] < new_max[i] : b > new_min[i];
+	}
+
+	bool improvesLst(int i, int b) const {
+		return mirror ? -b - dur[i] > new_min[i] : b < new_max[i];
+	}
+
+	// Records [[s'_i >= b]] in the current time line with the collected explanation
+	void updateEst(int i, int b) {
+		assert(improvesEst(i, b));
+		if (mirror) {
+			new_max[i] = -b - dur[i];
+			updates.push(Update(i, false, new_max[i], explReason()));
+		} else {
+			new_min[i] = b;
+			updates.push(Update(i, true, b, explReason()));
+		}
+	}
+
+	// Records [[s'_i <= b]] in the current time line with the collected explanation
+	void updateLst(int i, int b) {
+		assert(improvesLst(i, b));
+		if (mirror) {
+			new_min[i] = -b - dur[i];
+			updates.push(Update(i, true, new_min[i], explReason()));
+		} else {
+			new_max[i] = b;
+			updates.push(Update(i, false, b, explReason()));
+		}
+	}
+
+	// Overload checking and edge finding on the lower bounds.  The tasks are
+	// removed from Theta in non-increasing order of lct; a gray task causing an
+	// overload of Theta has to be scheduled after all tasks in Theta.
+	bool edgeFinding() {
+		const int n = x.size();
+		tree.reset(n);
+		for (int i = 0; i < n; i++) {
+			tree.setTheta(pos[i], est(i), dur[i]);
+			in_theta[i] = true;
+		}
+		for (int q = n - 1; q >= 0; q--) {
+			const int j = ord_lct[q];
+			const int end = lct(j);
+			if (tree.env() > end) {
+				// Overload of Theta
+				nb_overload++;
+				Clause* r = nullptr;
+				if (so.lazy) {
+					explStart();
+					const int leaf = tree.envLeaf();
+					const int begin = est(ord_est[leaf]);
+					// Lifting: the tasks cannot all lie in [begin, begin + p - 1)
+					thetaNeed(leaf, begin, begin + thetaDur(leaf) - 1, true);
+					vec<Lit> ps;
+					explFinish(ps);
+					r = Reason_new(ps.size());
+					for (int k = 0; k < ps.size(); k++) {
+						(*r)[k] = ps[k];
+					}
+				}
+				sat.confl = r;
+				return false;
+			}
+			while (tree.envGray() > end) {
+				int leaf_begin;
+				int leaf_gray;
+				tree.envGrayLeaves(leaf_begin, leaf_gray);
+				const int i = ord_est[leaf_gray];
+				if (tree.env() > est(i) && improvesEst(i, (int)tree.env())) {
+					nb_ef++;
+					explStart();
+					if (so.lazy) {
+						// i cannot end before begin + p1 + dur_i - 1, hence all tasks of
+						// Theta starting before that time have to precede i
+						const int begin = est(ord_est[leaf_begin]);
+						const int ub = begin + thetaDur(leaf_begin) + dur[i] - 1;
+						thetaNeed(leaf_begin, begin, ub, true);
+						explNeed(i, begin, INT_MAX);
+						const int leaf = tree.envLeaf();
+						thetaNeed(leaf, est(ord_est[leaf]), ub, false);
+					}
+					updateEst(i, (int)tree.env());
+				}
+				tree.clear(leaf_gray);
+			}
+			tree.setLambda(pos[j], est(j), dur[j]);
+			in_theta[j] = false;
+		}
+		return true;
+	}
+
+	// Detectable precedences on the lower bounds: all tasks j with
+	// lst_j < ect_i have to precede i
+	void detectablePrecedences() {
+		const int n = x.size();
+		tree.reset(n);
+		for (int i = 0; i < n; i++) {
+			in_theta[i] = false;
+		}
+		int jq = 0;
+		for (int ii = 0; ii < n; ii++) {
+			const int i = ord_ect[ii];
+			for (; jq < n && lst(ord_lst[jq]) < ect(i); jq++) {
+				const int j = ord_lst[jq];
+				tree.setTheta(pos[j], est(j), dur[j]);
+				in_theta[j] = true;
+			}
+			const bool i_in = in_theta[i];
+			if (i_in) {
+				tree.clear(pos[i]);
+				in_theta[i] = false;
+			}
+			if (tree.env() > est(i) && improvesEst(i, (int)tree.env())) {
+				nb_dp++;
+				explStart();
+				if (so.lazy) {
+					const int leaf = tree.envLeaf();
+					thetaNeed(leaf, est(ord_est[leaf]), ect(i) - 1, false);
+					explNeed(i, est(i), INT_MAX);
+				}
+				updateEst(i, (int)tree.env());
+			}
+			if (i_in) {
+				tree.setTheta(pos[i], est(i), dur[i]);
+				in_theta[i] = true;
+			}
+		}
+	}
+
+	// Not-last on the upper bounds: if the tasks j with lst_j < lct_i cannot
+	// all end before lst_i, then i has to end before the latest of their lst's
+	void notLast() {
+		const int n = x.size();
+		tree.reset(n);
+		for (int i = 0; i < n; i++) {
+			in_theta[i] = false;
+		}
+		int jq = 0;
+		for (int ii = 0; ii < n; ii++) {
+			const int i = ord_lct[ii];
+			for (; jq < n && lst(ord_lst[jq]) < lct(i); jq++) {
+				const int j = ord_lst[jq];
+				tree.setTheta(pos[j], est(j), dur[j]);
+				in_theta[j] = true;
+			}
+			assert(in_theta[i]);
+			tree.clear(pos[i]);
+			in_theta[i] = false;
+			if (tree.env() > lst(i)) {
+				const int leaf = tree.envLeaf();
+				int ub = INT_MIN;
+				for (int k = leaf; k < n; k++) {
+					const int t = ord_est[k];
+					if (in_theta[t]) {
+						ub = std::max(ub, lst(t));
+					}
+				}
+				if (improvesLst(i, ub - dur[i])) {
+					nb_nfnl++;
+					explStart();
+					if (so.lazy) {
+						const int begin = est(ord_est[leaf]);
+						thetaNeed(leaf, begin, ub, false);
+						explNeed(i, INT_MIN, begin + thetaDur(leaf) - 1);
+					}
+					updateLst(i, ub - dur[i]);
+				}
+			}
+			tree.setTheta(pos[i], est(i), dur[i]);
+			in_theta[i] = true;
+		}
+	}
+
+	bool propagate() override {
+		const int n = x.size();
+		for (int i = 0; i < n; i++) {
+			est_c[i] = new_min[i] = x[i]->getMin();
+			new_max[i] = x[i]->getMax();
+			lct_c[i] = new_max[i] + dur[i];
+		}
+		insertionSort(ests, n, [this](int i) { return est_c[i]; });
+		insertionSort(lcts, n, [this](int i) { return lct_c[i]; });
+		insertionSort(lsts, n, [this](int i) { return lct_c[i] - dur[i]; });
+		insertionSort(ects, n, [this](int i) { return est_c[i] + dur[i]; });
+		updates.clear();
+
+		for (int m = 0; m < 2; m++) {
+			setTimeLine(m != 0);
+			if (!edgeFinding()) {
+				return false;
+			}
+			detectablePrecedences();
+			notLast();
+		}
+
+		for (int k = 0; k < updates.size(); k++) {
+			const Update& u = updates[k];
+			if (u.is_lb) {
+				if (x[u.task]->setMinNotR(u.bound) && !x[u.task]->setMin(u.bound, u.reason)) {
+					return false;
+				}
+			} else {
+				if (x[u.task]->setMaxNotR(u.bound) && !x[u.task]->setMax(u.bound, u.reason)) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+};
+
+void disjunctive(vec<IntVar*>& x, vec<int>& dur) {
+	bool positive = true;
+	for (int i = 0; i < dur.size(); i++) {
+		positive = positive && dur[i] > 0;
+	}
+	// Tasks with zero duration are not supported by DisjunctiveTheta
+	if (so.disj_theta && positive && x.size() > 1) {
+		new DisjunctiveTheta(x, dur);
+	} else {
+		new DisjunctiveEF(x, dur);
+	}
+}
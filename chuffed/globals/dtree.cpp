@@ -981,20 +981,7 @@ void DTreeParenthoodPropagator::clearPropState() {
 
 PathDeg1::PathDeg1(vec<BoolView>& _vs, vec<BoolView>& _es, vec<vec<edge_id> >& _in,
 									 vec<vec<edge_id> >& _out, vec<vec<int> >& _en)
-		: GraphPropagator(_vs, _es, _en) {
-	for (int i = 0; i < _in.size(); i++) {
-		in.emplace_back();
-		for (int j = 0; j < _in[i].size(); j++) {
-			in[i].push_back(_in[i][j]);
-		}
-	}
-
-	for (int i = 0; i < _out.size(); i++) {
-		ou.emplace_back();
-		for (int j = 0; j < _out[i].size(); j++) {
-			ou[i].push_back(_out[i][j]);
-		}
-	}
+		: GraphPropagator(_vs, _es, _en), in(_in), ou(_out) {
 
 	for (int j = 0; j < nbEdges(); j++) {
 		getEdgeVar(j).attach(this, j, EVENT_LU);
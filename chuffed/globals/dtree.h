@@ -75,8 +75,8 @@ public:
 };
 
 class PathDeg1 : public GraphPropagator {
-	std::vector<std::vector<int> > in;
-	std::vector<std::vector<int> > ou;
+	CSRLists in;
+	CSRLists ou;
 
 	std::vector<int> new_edges;
 
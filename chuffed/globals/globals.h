@@ -6,6 +6,10 @@
 
 #include <list>
 
+namespace CFG {
+class CFG;
+}
+
 //-----
 // Directives
 
@@ -33,6 +37,10 @@ void inverse(vec<IntVar*>& x, vec<IntVar*>& y, int o1 = 0, int o2 = 0, ConLevel
 void circuit(vec<IntVar*>& x, int offset = 0);
 void path(vec<IntVar*>& x);
 
+// circuit_cost.c
+
+void circuit_cost(vec<IntVar*>& x, vec<int>& w, IntVar* cost, int offset = 0);
+
 // subcircuit.c
 
 void subcircuit(vec<IntVar*>& x, int offset = 0);
@@ -61,6 +69,10 @@ void table(vec<IntVar*>& x, vec<vec<int> >& t);
 
 void regular(vec<IntVar*>& x, int q, int s, vec<vec<int> >& d, int q0, vec<int>& f);
 
+// grammar.c
+
+void grammar(vec<IntVar*>& x, CFG::CFG& g);
+
 // disjunctive.c
 
 void disjunctive(vec<IntVar*>& x, vec<int>& d);
@@ -78,6 +90,12 @@ void cumulative_cal(vec<IntVar*>& s, vec<IntVar*>& d, vec<IntVar*>& r, IntVar* l
 void cumulative_cal(vec<IntVar*>& s, vec<IntVar*>& d, vec<IntVar*>& r, IntVar* limit,
 										vec<vec<int> >& cal, vec<int>& taskCal, int rho, int resCal,
 										const std::list<std::string>& opt);
+void cumulative_init();
+
+// cumulativeMulti.c
+
+void cumulative_multi(vec<IntVar*>& s, vec<int>& d, vec<vec<int> >& r, vec<int>& limit,
+											const std::list<std::string>& opt);
 
 // lex.c
 
@@ -0,0 +1,413 @@
+#include "chuffed/core/engine.h"
+#include "chuffed/core/options.h"
+#include "chuffed/core/propagator.h"
+#include "chuffed/core/sat-types.h"
+#include "chuffed/core/sat.h"
+#include "chuffed/globals/globals.h"
+#include "chuffed/mdd/CFG.h"
+#include "chuffed/primitives/primitives.h"
+#include "chuffed/support/misc.h"
+#include "chuffed/support/vec.h"
+#include "chuffed/vars/int-var.h"
+#include "chuffed/vars/vars.h"
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+// x is a word of the language of a context-free grammar.
+//
+// The CYK table is kept as an AND/OR graph, built once from the initial
+// domains. An OR node is a symbol deriving x[start..end): a nonterminal, or a
+// terminal t at a single position (a leaf, for the literal x[start] = t). An
+// AND node is a production used at a split point; its children are the
+// symbols of the right hand side. Only the nodes of some derivation of the
+// whole word are kept.
+//
+// An OR node is supported from below by its live AND nodes (a leaf by its
+// value), and from above by the live AND nodes using it (the root by the
+// constraint). Both counts are trailed; the node dies when one of them drops
+// to zero, killing the AND nodes around it. A leaf dying from above removes its
+// value. Each AND node records the OR node that killed it, and explanations
+// follow these causes back to removed values, only when they are asked for.
+//
+// Like CYKParser, this assumes there are no empty productions. Cyclic unit
+// productions are rejected.
+
+class Grammar : public Propagator {
+	const int n;
+	vec<IntVar*> x;
+
+	// OR nodes
+	vec<int> and_begin;  // the AND nodes of a production of the node
+	vec<int> and_end;
+	vec<int> par_start;  // the AND nodes using the node
+	vec<int> par_list;
+	vec<int> leaf_var;  // -1 if not a leaf
+	vec<int> leaf_val;
+	vec<int> below;
+	vec<int> above;
+	int root;
+
+	// AND nodes
+	vec<int> and_parent;
+	vec<int> left;
+	vec<int> right;  // -1 for a unit production
+	vec<int> cause;  // the OR node which killed it, or -1
+
+	// The leaves of each position
+	vec<int> leaf_start;
+	vec<int> leaves;
+
+	// Intermediate state
+	vec<int> changed;
+	vec<char> is_changed;
+	vec<int> kill_queue;
+	vec<int> inferred;
+
+	// Explanations
+	vec<int> seen;
+	int seen_stamp{0};
+	vec<int> expl_stack;
+
+	bool alive(int o) const { return below[o] > 0 && above[o] > 0; }
+
+	void killAnd(int a, int o) {
+		trailChange(cause[a], o);
+		const int p = and_parent[a];
+		if (p != o && alive(p)) {
+			trailChange(below[p], below[p] - 1);
+			if (below[p] == 0) {
+				kill_queue.push(p);
+			}
+		}
+		const int cs[2] = {left[a], right[a]};
+		for (const int c : cs) {
+			if (c == -1 || c == o || !alive(c)) {
+				continue;
+			}
+			trailChange(above[c], above[c] - 1);
+			if (above[c] == 0) {
+				kill_queue.push(c);
+				if (leaf_var[c] != -1) {
+					inferred.push(c);
+				}
+			}
+		}
+	}
+
+	void processKills() {
+		for (int k = 0; k < kill_queue.size(); k++) {
+			const int o = kill_queue[k];
+			for (int a = and_begin[o]; a < and_end[o]; a++) {
+				if (cause[a] == -1) {
+					killAnd(a, o);
+				}
+			}
+			for (int i = par_start[o]; i < par_start[o + 1]; i++) {
+				if (cause[par_list[i]] == -1) {
+					killAnd(par_list[i], o);
+				}
+			}
+		}
+		kill_queue.clear();
+	}
+
+	// Collects the removed values which killed o. A node dead from below lost
+	// all its AND nodes, one dead from above all its parents, and in both cases
+	// they died before it.
+	void explainNode(int o, vec<Lit>& ps) {
+		seen_stamp++;
+		expl_stack.clear();
+		expl_stack.push(o);
+		while (expl_stack.size() > 0) {
+			const int k = expl_stack.last();
+			expl_stack.pop();
+			if (seen[k] == seen_stamp) {
+				continue;
+			}
+			seen[k] = seen_stamp;
+			assert(!alive(k));
+			if (below[k] == 0) {
+				if (leaf_var[k] != -1) {
+					ps.push(x[leaf_var[k]]->getLit(leaf_val[k], LR_EQ));
+					continue;
+				}
+				for (int a = and_begin[k]; a < and_end[k]; a++) {
+					expl_stack.push(cause[a]);
+				}
+			} else {
+				for (int i = par_start[k]; i < par_start[k + 1]; i++) {
+					expl_stack.push(cause[par_list[i]]);
+				}
+			}
+		}
+	}
+
+public:
+	Grammar(vec<IntVar*>& _x, CFG::CFG& g) : n(_x.size()), x(_x) {
+		priority = 1;
+		g.normalize();
+		const int nv = g.prods.size();
+		const int alph = g.alphsz;
+
+		// Nonterminals, B before A for each unit production A -> B
+		vec<int> order;
+		vec<int> deps(nv, 0);
+		vec<vec<int> > users(nv);
+		for (int v = 0; v < nv; v++) {
+			for (const CFG::ProdInfo& pinf : g.prods[v]) {
+				const std::vector<CFG::RSym>& r = g.rules[pinf.rule];
+				if (r.empty()) {
+					CHUFFED_ERROR("Empty productions are not supported by grammar\n");
+				}
+				if (r.size() == 1 && CFG::isVar(r[0].sym)) {
+					deps[v]++;
+					users[CFG::symID(r[0].sym)].push(v);
+				}
+			}
+		}
+		for (int v = 0; v < nv; v++) {
+			if (deps[v] == 0) {
+				order.push(v);
+			}
+		}
+		for (int k = 0; k < order.size(); k++) {
+			vec<int>& us = users[order[k]];
+			for (int i = 0; i < us.size(); i++) {
+				if (--deps[us[i]] == 0) {
+					order.push(us[i]);
+				}
+			}
+		}
+		if (order.size() < nv) {
+			CHUFFED_ERROR("Cyclic unit productions are not supported by grammar\n");
+		}
+
+		// Bottom-up: the nonterminals deriving each span
+		auto item = [this](int v, int s, int l) { return ((v * n) + s) * n + l - 1; };
+		std::vector<char> der(static_cast<size_t>(nv) * n * n, 0);
+		auto sym_ok = [&](const CFG::RSym& rs, int s, int e) {
+			if (rs.cond != nullptr && !rs.cond->check(s, e)) {
+				return false;
+			}
+			if (CFG::isVar(rs.sym)) {
+				return der[item(CFG::symID(rs.sym), s, e - s)] != 0;
+			}
+			const int t = CFG::symID(rs.sym);
+			return e == s + 1 && t >= 0 && t < alph && x[s]->indomain(t);
+		};
+		auto rule_ok = [&](const std::vector<CFG::RSym>& r, int s, int e, int k) {
+			if (r.size() == 1) {
+				return sym_ok(r[0], s, e);
+			}
+			return sym_ok(r[0], s, k) && sym_ok(r[1], k, e);
+		};
+		for (int l = 1; l <= n; l++) {
+			for (int s = 0; s + l <= n; s++) {
+				const int e = s + l;
+				for (int i = 0; i < order.size(); i++) {
+					const int v = order[i];
+					for (const CFG::ProdInfo& pinf : g.prods[v]) {
+						if (pinf.cond != nullptr && !pinf.cond->check(s, e)) {
+							continue;
+						}
+						const std::vector<CFG::RSym>& r = g.rules[pinf.rule];
+						bool ok = false;
+						if (r.size() == 1) {
+							ok = rule_ok(r, s, e, e);
+						} else {
+							for (int k = s + 1; k < e && !ok; k++) {
+								ok = rule_ok(r, s, e, k);
+							}
+						}
+						if (ok) {
+							der[item(v, s, l)] = 1;
+							break;
+						}
+					}
+				}
+			}
+		}
+		if (n == 0 || der[item(g.start, 0, n)] == 0) {
+			TL_FAIL();
+		}
+
+		// Top-down: the nodes reachable from the root
+		std::vector<int> or_id(der.size(), -1);
+		std::vector<int> leaf_id(static_cast<size_t>(n) * alph, -1);
+		auto new_or = [this](int var, int val) {
+			const int o = below.size();
+			leaf_var.push(var);
+			leaf_val.push(val);
+			below.push(var == -1 ? 0 : 1);
+			above.push(0);
+			and_begin.push(0);
+			and_end.push(0);
+			return o;
+		};
+		auto child = [&](const CFG::RSym& rs, int s, int e) {
+			int* id;
+			if (CFG::isVar(rs.sym)) {
+				id = &or_id[item(CFG::symID(rs.sym), s, e - s)];
+			} else {
+				id = &leaf_id[s * alph + CFG::symID(rs.sym)];
+			}
+			if (*id == -1) {
+				*id = CFG::isVar(rs.sym) ? new_or(-1, 0) : new_or(s, CFG::symID(rs.sym));
+			}
+			above[*id]++;
+			return *id;
+		};
+		root = new_or(-1, 0);
+		or_id[item(g.start, 0, n)] = root;
+		above[root] = 1;
+		for (int l = n; l >= 1; l--) {
+			for (int s = 0; s + l <= n; s++) {
+				const int e = s + l;
+				for (int i = order.size() - 1; i >= 0; i--) {
+					const int v = order[i];
+					const int o = or_id[item(v, s, l)];
+					if (o == -1) {
+						continue;
+					}
+					and_begin[o] = and_parent.size();
+					for (const CFG::ProdInfo& pinf : g.prods[v]) {
+						if (pinf.cond != nullptr && !pinf.cond->check(s, e)) {
+							continue;
+						}
+						const std::vector<CFG::RSym>& r = g.rules[pinf.rule];
+						const int k_lo = r.size() == 1 ? e : s + 1;
+						const int k_hi = r.size() == 1 ? e : e - 1;
+						for (int k = k_lo; k <= k_hi; k++) {
+							if (!rule_ok(r, s, e, k)) {
+								continue;
+							}
+							and_parent.push(o);
+							left.push(child(r[0], s, k));
+							right.push(r.size() == 1 ? -1 : child(r[1], k, e));
+						}
+					}
+					and_end[o] = and_parent.size();
+					below[o] = and_end[o] - and_begin[o];
+					assert(below[o] > 0);
+				}
+			}
+		}
+		const int nor = below.size();
+		const int nand = and_parent.size();
+		cause.growTo(nand, -1);
+		seen.growTo(nor, 0);
+
+		par_start.growTo(nor + 1, 0);
+		for (int a = 0; a < nand; a++) {
+			par_start[left[a] + 1]++;
+			if (right[a] != -1) {
+				par_start[right[a] + 1]++;
+			}
+		}
+		for (int o = 0; o < nor; o++) {
+			par_start[o + 1] += par_start[o];
+		}
+		par_list.growTo(par_start[nor]);
+		vec<int> fill(nor, 0);
+		for (int a = 0; a < nand; a++) {
+			par_list[par_start[left[a]] + fill[left[a]]++] = a;
+			if (right[a] != -1) {
+				par_list[par_start[right[a]] + fill[right[a]]++] = a;
+			}
+		}
+
+		// The leaves of each position, and the values without one
+		leaf_start.growTo(n + 1, 0);
+		for (int s = 0; s < n; s++) {
+			leaf_start[s] = leaves.size();
+			int lo = alph;
+			int hi = -1;
+			for (int t = 0; t < alph; t++) {
+				if (leaf_id[s * alph + t] != -1) {
+					leaves.push(leaf_id[s * alph + t]);
+					lo = std::min(lo, t);
+					hi = std::max(hi, t);
+				}
+			}
+			assert(lo <= hi);
+			int_rel(x[s], IRT_GE, lo);
+			int_rel(x[s], IRT_LE, hi);
+			for (int t = lo + 1; t < hi; t++) {
+				if (leaf_id[s * alph + t] == -1 && x[s]->indomain(t)) {
+					int_rel(x[s], IRT_NE, t);
+				}
+			}
+		}
+		leaf_start[n] = leaves.size();
+
+		is_changed.growTo(n, 0);
+		for (int s = 0; s < n; s++) {
+			x[s]->specialiseToEL();
+			x[s]->attach(this, s, EVENT_C);
+		}
+	}
+
+	void wakeup(int i, int /*c*/) override {
+		if (is_changed[i] == 0) {
+			is_changed[i] = 1;
+			changed.push(i);
+		}
+		pushInQueue();
+	}
+
+	bool propagate() override {
+		for (int j = 0; j < changed.size(); j++) {
+			const int s = changed[j];
+			for (int i = leaf_start[s]; i < leaf_start[s + 1]; i++) {
+				const int o = leaves[i];
+				if (alive(o) && !x[s]->indomain(leaf_val[o])) {
+					trailChange(below[o], 0);
+					kill_queue.push(o);
+				}
+			}
+		}
+		processKills();
+
+		if (!alive(root)) {
+			if (so.lazy) {
+				vec<Lit> ps;
+				explainNode(root, ps);
+				sat.confl = Reason_new(ps);
+			}
+			inferred.clear();
+			return false;
+		}
+
+		for (int k = 0; k < inferred.size(); k++) {
+			const int o = inferred[k];
+			IntVar* v = x[leaf_var[o]];
+			if (v->remValNotR(leaf_val[o])) {
+				if (!v->remVal(leaf_val[o], Reason(prop_id, o))) {
+					inferred.clear();
+					return false;
+				}
+			}
+		}
+		inferred.clear();
+		return true;
+	}
+
+	Clause* explain(Lit /*p*/, int inf_id) override {
+		vec<Lit> ps;
+		ps.push();
+		explainNode(inf_id, ps);
+		return Reason_new(ps);
+	}
+
+	void clearPropState() override {
+		in_queue = false;
+		for (int j = 0; j < changed.size(); j++) {
+			is_changed[changed[j]] = 0;
+		}
+		changed.clear();
+	}
+};
+
+void grammar(vec<IntVar*>& x, CFG::CFG& g) { new Grammar(x, g); }
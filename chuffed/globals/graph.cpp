@@ -59,13 +59,7 @@ std::vector<Lit> GraphPropagator::fullExpl(bool fail) {
 }
 
 GraphPropagator::GraphPropagator(vec<BoolView>& _vs, vec<BoolView>& _es, vec<vec<int> >& _en)
-		: vs(_vs), es(_es) {
-	endnodes = std::vector<std::vector<int> >(_en.size(), std::vector<int>());
-	for (int i = 0; i < _en.size(); i++) {
-		for (int j = 0; j < _en[i].size(); j++) {  // when directed:
-			endnodes[i].push_back(_en[i][j]);        //[0] ---> [1]
-		}
-	}
+		: vs(_vs), es(_es), endnodes(_en) {  // when directed: [0] ---> [1]
 	if (DEBUG) {
 		for (int i = 0; i < nbEdges(); i++) {
 			std::cout << i << " " << _en[i][0] << " " << _en[i][1] << '\n';
@@ -2,6 +2,7 @@
 #define GRAPH_PROPAGATOR_H
 
 #include "chuffed/core/propagator.h"
+#include "chuffed/support/csr_graph.h"
 #include "chuffed/support/union_find.h"
 
 #include <map>
@@ -19,12 +20,12 @@ public:
 	vec<BoolView> es;
 
 	std::vector<std::vector<int> > nodes2edge;
-	std::vector<std::vector<node_id> > endnodes;
+	CSRLists endnodes;
 	virtual void fullExpl(vec<Lit>& ps);          // DEBUG
 	virtual void fullExpl(std::vector<Lit>& ps);  // DEBUG
 	virtual std::vector<Lit> fullExpl(bool fail);
 
-	std::vector<std::vector<edge_id> > adj;
+	CSRLists adj;
 
 	bool coherence_innodes(int edge);
 	bool coherence_outedges(int node);
@@ -82,7 +83,7 @@ public:
 
 	inline bool isSelfLoop(int e) { return getEndnode(e, 0) == getEndnode(e, 1); }
 
-	inline std::vector<int> getAdjacentEdges(int u) { return adj[u]; }
+	inline CSRLists::Range getAdjacentEdges(int u) { return adj[u]; }
 
 	std::string available_to_dot();
 	std::string all_to_dot();
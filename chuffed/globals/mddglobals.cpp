@@ -11,6 +11,7 @@
 #include "chuffed/vars/int-view.h"
 
 #include <cassert>
+#include <map>
 #include <vector>
 
 struct dfa_trans {
@@ -20,6 +21,7 @@ struct dfa_trans {
 };
 
 static void addMDDProp(vec<IntVar*>& x, MDDTable& tab, MDDNodeInt m, const MDDOpts& mopts);
+static void addMDDProp(vec<IntVar*>& x, MDDTemplate* templ, const MDDOpts& mopts);
 
 // MDDNodeInt fd_regular(MDDTable& tab, int n, int nstates, vec< vec<int> >& transition, int q0,
 // vec<int>& accepts, bool offset = true);
@@ -42,19 +44,25 @@ void addMDD(vec<IntVar*>& x, MDD m, const MDDOpts& mdd_opts) {
 	*/
 }
 
-static void addMDDProp(vec<IntVar*>& x, MDDTable& tab, MDDNodeInt m, const MDDOpts& mopts) {
-	vec<int> doms;
-	vec<IntView<> > w;
-
-	vec<intpair> bounds;
+static void getDoms(vec<IntVar*>& x, vec<int>& doms) {
 	for (int i = 0; i < x.size(); i++) {
-		bounds.push(intpair(x[i]->getMin(), x[i]->getMax()));
-		doms.push(x[i]->getMax() + 1);
 		// assert( x[i]->getMin() == 0 );
+		doms.push(x[i]->getMax() + 1);
 	}
+}
+
+static void addMDDProp(vec<IntVar*>& x, MDDTable& tab, MDDNodeInt m, const MDDOpts& mopts) {
+	vec<int> doms;
+	getDoms(x, doms);
 	//   m = tab.bound(m, bounds);
 	//   m = tab.expand(0, m);
 
+	addMDDProp(x, new MDDTemplate(tab, m, doms), mopts);
+}
+
+static void addMDDProp(vec<IntVar*>& x, MDDTemplate* templ, const MDDOpts& mopts) {
+	vec<IntView<> > w;
+
 	for (int i = 0; i < x.size(); i++) {
 		x[i]->specialiseToEL();
 	}
@@ -62,42 +70,74 @@ static void addMDDProp(vec<IntVar*>& x, MDDTable& tab, MDDNodeInt m, const MDDOp
 		w.push(IntView<>(x[i], 1, 0));
 	}
 
-	auto* templ = new MDDTemplate(tab, m, doms);
-
 	new MDDProp<0>(templ, w, mopts);
 }
 
+// Compiled templates, by a description of the constraint: its kind, the domain
+// sizes, and the DFA or the tuples. Models often post the same regular or table
+// constraint over many arrays of variables, which then share one template
+// instead of each building its own MDD. Templates are built once per model, so
+// the cache is never emptied.
+enum MDDTemplateKind { MDD_REGULAR, MDD_TABLE };
+
+static MDDTemplate*& cachedTemplate(const std::vector<int>& key) {
+	static std::map<std::vector<int>, MDDTemplate*> cache;
+	return cache[key];
+}
+
+static void pushKey(std::vector<int>& key, vec<int>& v) {
+	key.push_back(v.size());
+	for (int i = 0; i < v.size(); i++) {
+		key.push_back(v[i]);
+	}
+}
+
 // x: Vars | q: # states | s: alphabet size | d[state,symbol] -> state | q0: start state | f:
 // accepts States range from 1..q (0 is reserved as dead)
 //
 void mdd_regular(vec<IntVar*>& x, int q, int /*s*/, vec<vec<int> >& d, int q0, vec<int>& f,
 								 bool offset, const MDDOpts& mopts) {
-	MDDTable tab(x.size());
-	const MDDNodeInt m(fd_regular(tab, x.size(), q + 1, d, q0, f, offset));
-	addMDDProp(x, tab, m, mopts);
+	vec<int> doms;
+	getDoms(x, doms);
+
+	std::vector<int> key = {MDD_REGULAR, q, q0, static_cast<int>(offset)};
+	pushKey(key, doms);
+	pushKey(key, f);
+	for (int i = 0; i < q; i++) {
+		pushKey(key, d[i]);
+	}
+
+	MDDTemplate*& templ = cachedTemplate(key);
+	if (templ == nullptr) {
+		MDDTable tab(x.size());
+		const MDDNodeInt m(fd_regular(tab, x.size(), q + 1, d, q0, f, offset));
+		templ = new MDDTemplate(tab, m, doms);
+	}
+	addMDDProp(x, templ, mopts);
 }
 
 void mdd_table(vec<IntVar*>& x, vec<vec<int> >& t, const MDDOpts& mopts) {
 	vec<int> doms;
+	getDoms(x, doms);
 
-	int maxdom = 0;
-	for (int i = 0; i < x.size(); i++) {
-		// assert(x[i]->getMin() == 0);
-		doms.push(x[i]->getMax() + 1);
-
-		// Could also generate maxdom from tuples.
-		if ((x[i]->getMax() + 1) > maxdom) {
-			maxdom = x[i]->getMax() + 1;
-		}
+	std::vector<int> key = {MDD_TABLE};
+	pushKey(key, doms);
+	for (int i = 0; i < t.size(); i++) {
+		pushKey(key, t[i]);
 	}
-	MDDTable tab(x.size());
 
-	// Assumes a positive table.
-	const MDDNodeInt m(mdd_table(tab, x.size(), doms, t, true));
+	MDDTemplate*& templ = cachedTemplate(key);
+	if (templ == nullptr) {
+		MDDTable tab(x.size());
+
+		// Assumes a positive table.
+		const MDDNodeInt m(mdd_table(tab, x.size(), doms, t, true));
 
-	//   tab.print_mdd_tikz(m);
+		//   tab.print_mdd_tikz(m);
 
-	addMDDProp(x, tab, m, mopts);
+		templ = new MDDTemplate(tab, m, doms);
+	}
+	addMDDProp(x, templ, mopts);
 }
 
 // MDD mdd_table(MDDTable& mddtab, int arity, vec<int>& doms, vec< std::vector<unsigned int> >&
@@ -106,11 +146,7 @@ MDDNodeInt mdd_table(MDDTable& mddtab, int arity, vec<int>& doms, vec<vec<int> >
 										 bool is_pos) {
 	assert(doms.size() == arity);
 
-	MDDNodeInt table = MDDFALSE;
-
-	for (int i = 0; i < entries.size(); i++) {
-		table = mddtab.mdd_or(table, mddtab.tuple(entries[i]));
-	}
+	MDDNodeInt table = mddtab.tuples(entries);
 
 	if (!is_pos) {
 		std::vector<unsigned int> vdoms;
@@ -179,5 +215,9 @@ void wmdd_cost_regular(vec<IntVar*>& x, int q, int s, vec<vec<int> >& d, vec<vec
 
 	EVLayerGraph g;
 	const EVLayerGraph::NodeID root = wdfa_to_layergraph(g, x.size(), s, (WDFATrans*)T, q, q0, f);
+	if (root == EVLayerGraph::EVFalse) {
+		// No string of this length is accepted.
+		TL_FAIL();
+	}
 	evgraph_to_wmdd(x, cost, g, root, mopts);
 }
@@ -1580,7 +1580,7 @@ class LPLBSteinerTreePropagator : public SUPERTREEPROPCLASS {
 		int root;
 		UF<Tint> uf;
 		vector<set<int>> mergedAdj;
-		vector<vector<int>>& endnodes;
+		CSRLists endnodes;
 		vector<int> terminals;
 		vec<int> weights;
 
@@ -1650,7 +1650,7 @@ class LPLBSteinerTreePropagator : public SUPERTREEPROPCLASS {
 		vector<set<int>> cuts;
 
 	public:
-		DualAscent(int r, int n, vector<vector<int>>& adj, vector<vector<int>>& en, vector<int> ts,
+		DualAscent(int r, int n, const CSRLists& adj, const CSRLists& en, vector<int> ts,
 							 vec<int> ws)
 				: root(r), uf(n), endnodes(en), terminals(ts), weights(ws) {
 			for (unsigned int i = 0; i < adj.size(); i++) {
@@ -1717,14 +1717,14 @@ class LPLBSteinerTreePropagator : public SUPERTREEPROPCLASS {
 		std::vector<Edge> lemonEdges;
 		std::vector<int> terminals;
 		LengthMap* capacity;
-		vector<vector<int>>& endnodes;
+		CSRLists endnodes;
 		int rootNode;
 
 		vec<Tint> isTerminal;
 
 	public:
 		LemonFlow(int _nodeCount, int _edgeCount, bool nodes[], int root,
-							vector<vector<int>>& _endnodes)
+							const CSRLists& _endnodes)
 				: nodeCount(_nodeCount),
 					edgeCount(_edgeCount * 2),
 					lemonNodes(_nodeCount),
@@ -5,6 +5,7 @@
 #include "chuffed/core/sat-types.h"
 #include "chuffed/core/sat.h"
 #include "chuffed/globals/tree.h"
+#include "chuffed/support/lifted_forest.h"
 #include "chuffed/support/union_find.h"
 #include "chuffed/support/vec.h"
 #include "chuffed/vars/bool-view.h"
@@ -25,24 +26,16 @@ struct sorter {
 using iipair = std::pair<int, int>;
 using iiipair = std::pair<int, iipair>;
 /**
- * Returns the weight of an MST (pure MST)
+ * Returns the weights of a minimum and of a maximum spanning tree, given the
+ * edges sorted by increasing weight
  */
-std::pair<int, int> Kruskal_weight(std::vector<int>& weights, int n,
-																	 std::vector<std::vector<int> >& ends) {
-	std::vector<iipair> sorted;
-
-	for (unsigned int i = 0; i < weights.size(); i++) {
-		sorted.emplace_back(i, weights[i]);
-	}
-	std::sort(sorted.begin(), sorted.end(), sorter);
-
+std::pair<int, int> Kruskal_weight(const std::vector<iipair>& sorted, int n, const CSRLists& ends) {
 	// Minimum ST
-
-	unsigned int i = 0;
+	int i = 0;
 	int in = 0;
 	int cost = 0;
 	UF<int> uf(n);
-	while (i < sorted.size() && in < n - 1) {
+	while (i < static_cast<int>(sorted.size()) && in < n - 1) {
 		const int e = sorted[i].first;
 		const int w = sorted[i].second;
 		if (!uf.connected(ends[e][0], ends[e][1])) {
@@ -54,7 +47,7 @@ std::pair<int, int> Kruskal_weight(std::vector<int>& weights, int n,
 	}
 
 	// Maximum ST
-	unsigned int i2 = sorted.size() - 1;
+	int i2 = static_cast<int>(sorted.size()) - 1;
 	int in2 = 0;
 	int cost2 = 0;
 	UF<int> uf2(n);
@@ -74,7 +67,17 @@ std::pair<int, int> Kruskal_weight(std::vector<int>& weights, int n,
 }
 
 class MSTPropagator : public TreePropagator {
+	// Edges by increasing weight, and position of each edge in that order
 	std::vector<iipair> sorted;
+	std::vector<int> pos;
+
+	// The spanning forest of the last propagation. The key of an edge is its
+	// position in Kruskal's order (-1 for mandatory edges), so that path
+	// queries also give the latest non mandatory edge.
+	std::vector<bool> in_tree;
+	std::vector<int> key;
+	LiftedForest<int> forest;
+	std::vector<int> top;
 
 protected:
 public:
@@ -95,7 +98,7 @@ public:
 
 	MSTPropagator(vec<BoolView>& _vs, vec<BoolView>& _es, vec<vec<edge_id> >& _adj,
 								vec<vec<int> >& _en, IntVar* _w, vec<int>& _ws)
-			: TreePropagator(_vs, _es, _adj, _en), w(_w), sort_by_w(this) {
+			: TreePropagator(_vs, _es, _adj, _en), forest(nbNodes()), w(_w), sort_by_w(this) {
 		for (int i = 0; i < _ws.size(); i++) {
 			ws.push_back(_ws[i]);
 		}
@@ -104,12 +107,20 @@ public:
 			sorted.emplace_back(i, ws[i]);
 		}
 		std::sort(sorted.begin(), sorted.end(), sorter);
+		pos.resize(ws.size());
+		for (unsigned int i = 0; i < sorted.size(); i++) {
+			pos[sorted[i].first] = static_cast<int>(i);
+		}
+
+		in_tree.resize(nbEdges());
+		key.resize(nbEdges());
+		top.resize(nbNodes());
 
 		// for (int i = 0; i < _en.size(); i++)
 		//     for (int j = 0; j < _en[i].size(); j++)
 		//         endnodes[i].push(_en[i][j]);
 
-		const std::pair<int, int> kkl = Kruskal_weight(ws, nbNodes(), endnodes);
+		const std::pair<int, int> kkl = Kruskal_weight(sorted, nbNodes(), endnodes);
 		if (kkl.first > w->getMin()) {
 			w->setMin(kkl.first);
 		}
@@ -127,6 +138,32 @@ public:
 		}
 	}
 
+	// Root every tree of the forest and fill in the lifting tables
+	void buildForest() {
+		for (int e = 0; e < nbEdges(); e++) {
+			key[e] = getEdgeVar(e).isTrue() ? -1 : pos[e];
+		}
+		forest.build(endnodes, in_tree, ws, key);
+		for (int u = 0; u < nbNodes(); u++) {
+			top[u] = u;
+		}
+	}
+
+	// Highest ancestor of u reachable through edges that already have a
+	// substitute
+	int findTop(int u) {
+		int r = u;
+		while (top[r] != r) {
+			r = top[r];
+		}
+		while (top[u] != r) {
+			const int next = top[u];
+			top[u] = r;
+			u = next;
+		}
+		return r;
+	}
+
 	bool propagate() override {
 		if (!TreePropagator::propagate()) {
 			return false;
@@ -139,73 +176,80 @@ public:
 		// Computing the MST with the inedges
 		{
 			UF<int> uf(nbNodes());
-			RerootedUnionFind<int> ruf(nbNodes());
-			std::vector<bool> already(nbEdges(), false);
 			int in = 0;
 			for (int i = 0; i < nbEdges(); i++) {
-				if (getEdgeVar(i).isTrue()) {
-					const bool ok = ruf.unite(endnodes[i][0], endnodes[i][1]);
-					assert(ok);
+				in_tree[i] = getEdgeVar(i).isTrue();
+				if (in_tree[i]) {
 					uf.unite(endnodes[i][0], endnodes[i][1]);
 					in++;
 					c += ws[i];
 				}
 			}
-
-			unsigned int i = 0;
-			while (i < sorted.size()) {
+			for (int i = 0; i < static_cast<int>(sorted.size()) && in < nbNodes() - 1; i++) {
 				const int e = sorted[i].first;
-				if (getEdgeVar(e).isTrue()) {
-					i++;
+				if (getEdgeVar(e).isFixed()) {
 					continue;
 				}
-				// cout <<"Looking at "<<e<<endl;
-				const int w = sorted[i].second;
 				const int u = endnodes[e][0];
 				const int v = endnodes[e][1];
-				const bool connected = uf.connected(u, v);
+				if (!uf.connected(u, v)) {
+					uf.unite(u, v);
+					in_tree[e] = true;
+					in++;
+					c += sorted[i].second;
+				}
+			}
+		}
+		buildForest();
+
+		// Going through the edges in Kruskal's order again: the endnodes of e
+		// were already connected when e was considered iff they are in the
+		// same tree and every edge on the path between them came before e.
+		for (int i = 0; i < static_cast<int>(sorted.size()); i++) {
+			const int e = sorted[i].first;
+			if (getEdgeVar(e).isTrue()) {
+				continue;
+			}
+			// cout <<"Looking at "<<e<<endl;
+			const int w = sorted[i].second;
+			const int u = endnodes[e][0];
+			const int v = endnodes[e][1];
+			if (u == v) {
+				continue;
+			}
+			int max_e = -1;
+			int last = -1;
+			int lca = -1;
+			if (forest.comp(u) == forest.comp(v)) {
+				lca = forest.pathQuery(u, v, max_e, last);
+			}
+			const bool connected = lca != -1 && last < i;
 
-				// I wanted to connected them, but I can't bc I'm out
-				if (getEdgeVar(e).isFalse() && !connected) {
-					if (!already[e]) {
+			// I wanted to connected them, but I can't bc I'm out
+			if (getEdgeVar(e).isFalse() && !connected) {
+				expl_fail.push(getEdgeVar(e).getValLit());
+			}
+			// I wanted to connected them, but I can't bc They are already connected
+			else if (connected) {
+				assert(!in_tree[e]);
+				//  ^ used to see if the path used mandatory edges BECAUSE e is
+				// forbidden and there in no other way of connecting its endnodes
+				if (ws[max_e] > w) {
+					if (getEdgeVar(e).isFalse()) {
 						expl_fail.push(getEdgeVar(e).getValLit());
-						already[e] = true;
 					}
 				}
-				// I wanted to connected them, but I can't bc They are already connected
-				else if (connected) {
-					std::vector<int> path = ruf.connectionsFromTo(u, v);
-					int arg_maxw = findEdge(path[0], path[1]);
-					// int below_cost = 0;
-					// int above_cost = 0;
-					bool heavier = false;
-					//  ^ used to see if the path used mandatory edges BECAUSE e is
-					// forbidden and there in no other way of connecting its endnodes
-
-					for (int k = 0; k < path.size() - 1; k++) {
-						const int e_path = findEdge(path[k], path[k + 1]);
-						arg_maxw = ws[e_path] > ws[arg_maxw] ? e_path : arg_maxw;
-						heavier |= ws[e_path] > w;
-						assert(e_path != e);
-						subs[e_path] =
-								(subs[e_path] == -1) ? e : ((ws[subs[e_path]] > ws[e]) ? e : subs[e_path]);
+				support[e] = max_e;
+
+				// e is the lightest substitute of every path edge that has none yet
+				for (int x : {u, v}) {
+					x = findTop(x);
+					while (forest.depth(x) > forest.depth(lca)) {
+						subs[forest.parentEdge(x)] = e;
+						top[x] = forest.parent(x);
+						x = findTop(x);
 					}
-					if (heavier) {
-						if (getEdgeVar(e).isFalse()) {
-							expl_fail.push(getEdgeVar(e).getValLit());
-						}
-					}
-					support[e] = arg_maxw;
-				}
-				// I can connect them!
-				if (in < nbNodes() - 1 && !getEdgeVar(e).isFixed() && !connected) {
-					const bool ok = ruf.unite(u, v);
-					assert(ok);
-					uf.unite(u, v);
-					in++;
-					c += w;
 				}
-				i++;
 			}
 		}
 		// Lower bound:
@@ -11,6 +11,7 @@
 #include "chuffed/vars/modelling.h"
 #include "chuffed/vars/vars.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 #include <cstdlib>
@@ -38,6 +39,8 @@ public:
 	int defaultRoot{0};  // index of var used as root of scc tree by default
 
 	// Persistent state
+	Tint firstFree;  // no var before it is unfixed (root selection 1)
+	Tint sccStamp;   // sccRuns when the last scc pass pruned nothing
 
 	// Intermediate state
 	vec<int> new_fixed;
@@ -58,9 +61,24 @@ public:
 
 	int* index;
 	int* lowlink;
+	int* order;  // order[i] is the node with index i
 
 	int nodesSeen;
 
+	// The last scc pass, kept so that the next one can be skipped when
+	// nothing it relied on was removed since
+	int sccRuns{0};
+	int sccRoot{-1};
+	vec<int> subStart;  // index of the first node of each subtree of the root
+	int* subtree;       // subtree of each node
+	int* tparent;       // parent in the dfs tree, -1 for the root
+	int* nkids;         // number of dfs tree children
+	int* lowLocal;      // lowest index reached by a non-tree edge
+	int* nback;         // number of back edges counted for the subtree
+	int* dsize;         // domain size
+	bool* wasOut;       // whether the var could still be out of the circuit
+	int* optionPos;     // position in the root options, -1 once removed
+
 	SubCircuit(vec<IntView<U> > _x)
 			: size(_x.size()),
 				x(_x.release()),
@@ -69,7 +87,9 @@ public:
 				scc(so.circuitalg >= 3),
 				pruneRoot(so.sccoptions >= 3),
 
-				pruneWithin(so.sccoptions == 2 || so.sccoptions == 4) {
+				pruneWithin(so.sccoptions == 2 || so.sccoptions == 4),
+				firstFree(0),
+				sccStamp(-1) {
 		priority = 5;
 
 		new_fixed.reserve(size);
@@ -82,6 +102,15 @@ public:
 		later.reserve(size);
 		index = (int*)malloc(size * sizeof(int));
 		lowlink = (int*)malloc(size * sizeof(int));
+		order = (int*)malloc(size * sizeof(int));
+		subtree = (int*)malloc(size * sizeof(int));
+		tparent = (int*)malloc(size * sizeof(int));
+		nkids = (int*)malloc(size * sizeof(int));
+		lowLocal = (int*)malloc(size * sizeof(int));
+		nback = (int*)malloc(size * sizeof(int));
+		dsize = (int*)malloc(size * sizeof(int));
+		wasOut = (bool*)malloc(size * sizeof(bool));
+		optionPos = (int*)malloc(size * sizeof(int));
 
 		if (scc) {
 			for (int i = 0; i < size; i++) {
@@ -110,6 +139,25 @@ public:
 		propQueue.push(newprop);
 	}
 
+	// Appends the nodes with an index in [lo, hi] to out, in increasing order
+	void collectIndices(int lo, int hi, vec<int>& out) {
+		const int first = out.size();
+		for (int i = lo; i <= hi; i++) {
+			out.push(order[i]);
+		}
+		std::sort(static_cast<int*>(out) + first, static_cast<int*>(out) + out.size());
+	}
+
+	// Nodes not visited before the current subtree of the root
+	void collectLater() {
+		later.clear();
+		for (int i = 0; i < size; i++) {
+			if (index[i] < 0 || index[i] >= subStart.last()) {
+				later.push(i);
+			}
+		}
+	}
+
 	// Prunes that partial assigned paths are not completed to cycles,
 	// unless there is no variable outside the chain fixed to an index not its own
 	bool propagatePrevent() {
@@ -286,8 +334,13 @@ public:
 	bool exploreSubtree(int thisNode, int startPrevSubtree, int endPrevSubtree, int* backfrom,
 											int* backto, int* numback) {
 		// fprintf(stderr,"exploring subtree\n");
+		order[nodesSeen] = thisNode;
 		index[thisNode] = nodesSeen++;
 		lowlink[thisNode] = index[thisNode];
+		subtree[thisNode] = subStart.size() - 1;
+		lowLocal[thisNode] = index[thisNode];
+		nkids[thisNode] = 0;
+		nback[thisNode] = 0;
 		bool isFirstChild = true;
 		int child;
 		for (typename IntView<U>::iterator i = x[thisNode].begin(); i != x[thisNode].end(); ++i) {
@@ -295,6 +348,8 @@ public:
 			// If we haven't visited the child yet, do so now
 			if (index[child] == -1) {
 				// fprintf(stderr,"new child %d\n", child);
+				tparent[child] = thisNode;
+				nkids[thisNode]++;
 				if (!exploreSubtree(child, startPrevSubtree, endPrevSubtree, backfrom, backto, numback)) {
 					return false;  // fail if there was an scc contained within this child
 				}
@@ -362,6 +417,7 @@ public:
 				//  If child is within the last subtree we've found a backedge (from this node to the child)
 				if (index[child] >= startPrevSubtree && index[child] <= endPrevSubtree) {
 					(*numback)++;
+					nback[thisNode]++;
 					*backfrom = thisNode;
 					*backto = child;
 				}
@@ -379,6 +435,7 @@ public:
 							// subtree can reach the prev or later subtrees,
 							// and no node in the prev subtree can reach
 							// later subtrees.
+							collectLater();
 							vec<int> prevAndLater;
 							prevAndLater.reserve(prev.size() + later.size());
 							for (int i = 0; i < prev.size(); i++) {
@@ -399,6 +456,9 @@ public:
 				if (index[child] < lowlink[thisNode]) {
 					lowlink[thisNode] = index[child];
 				}
+				if (index[child] < lowLocal[thisNode]) {
+					lowLocal[thisNode] = index[child];
+				}
 			}
 			// fprintf(stderr,"lowpoint is %d\n", lowlink[thisNode]);
 		}
@@ -471,17 +531,36 @@ public:
 		int dom = 0;
 		switch (so.rootSelection) {
 			case 1:  // first non-fixed
-				for (int i = 0; i < size; i++) {
-					if (!x[i].isFixed()) {
-						root = i;
-						break;
-					}
+			{
+				// Vars only get fixed below this point in the search, so the
+				// scan can resume where it stopped last time
+				int i = firstFree;
+				while (i < size && x[i].isFixed()) {
+					i++;
 				}
-				break;
+				if (i < size) {
+					root = i;
+				}
+				if (i != firstFree) {
+					firstFree = i;
+				}
+			} break;
 			case 2:  // random non-fixed
+				// Same as options.remove() on every fixed var, without the search
 				for (int i = 0; i < size; i++) {
-					if (x[i].isFixed()) {
-						options.remove(i);
+					optionPos[i] = -1;
+				}
+				for (int i = 0; i < options.size(); i++) {
+					optionPos[options[i]] = i;
+				}
+				for (int i = 0; i < size; i++) {
+					if (x[i].isFixed() && optionPos[i] != -1) {
+						const int j = optionPos[i];
+						const int l = options.last();
+						options[j] = l;
+						optionPos[l] = j;
+						options.pop();
+						optionPos[i] = -1;
 					}
 				}
 				if (options.size() > 0) {
@@ -522,12 +601,17 @@ public:
 		later.clear();
 
 		assert(!x[root].isFixed() || x[root].getVal() != root);
+		sccRuns++;
+		subStart.clear();
 		for (int i = 0; i < size; i++) {
 			index[i] = -1;  // unvisited
 		}
 
 		index[root] = 0;  // first node visited
 		lowlink[root] = 0;
+		order[0] = root;
+		tparent[root] = -1;
+		nkids[root] = 0;
 
 		nodesSeen = 1;  // only seen root node
 		propQueue.clear();
@@ -543,19 +627,23 @@ public:
 			if (index[child] == -1)  // if haven't explored this yet
 			{
 				numback = 0;
+				subStart.push(nodesSeen);
+				tparent[child] = root;
+				nkids[root]++;
 				if (!exploreSubtree(child, startSubtree, endSubtree, &backfrom, &backto, &numback)) {
 					// fprintf(stderr, "failed in subtree\n");
 					return false;  // fail if we found a scc within the child
 				}
 
-				// Find the nodes in the subtree we just explored and the ones still to be explored
+				// Find the nodes in the subtree we just explored, and the ones still to be
+				// explored when they are needed
 				thisSubtree.clear();
+				collectIndices(subStart.last(), nodesSeen - 1, thisSubtree);
+				const bool needLater = prev.size() == 0 || numback == 0 || (fixReq && numback == 1);
 				later.clear();
-				for (int i = 0; i < size; i++) {
+				for (int i = 0; needLater && i < size; i++) {
 					if (index[i] < 0) {
 						later.push(i);
-					} else if (index[i] > endSubtree) {
-						thisSubtree.push(i);
 					}
 				}
 
@@ -726,6 +814,8 @@ public:
 			}
 		}
 
+		bool pruned = false;
+
 		// If we haven't reached all of the nodes and something we have reached has to
 		// be included, then set everything outside to take its own index
 		if (nodesSeen != size) {
@@ -759,6 +849,7 @@ public:
 				for (int i = 0; i < notseen.size(); i++) {
 					const int outsideVar = notseen[i];
 					if (x[outsideVar].setValNotR(outsideVar)) {
+						pruned = true;
 						if (!x[outsideVar].setVal(outsideVar, r)) {
 							return false;
 						}
@@ -825,18 +916,84 @@ public:
 			// fprintf(stderr, "propagating\n");
 			if (p.fix) {
 				if (x[p.var].setValNotR(p.val)) {
+					pruned = true;
 					if (!x[p.var].setVal(p.val, p.reason)) {
 						return false;
 					}
 				}
 			} else {
 				if (x[p.var].remValNotR(p.val)) {
+					pruned = true;
 					if (!x[p.var].remVal(p.val, p.reason)) {
 						return false;
 					}
 				}
 			}
 		}
+
+		// A pass that pruned nothing ran on the current graph, so it can stand
+		// in for the next ones as long as they would find the same tree
+		if (!pruned) {
+			for (int i = 0; i < size; i++) {
+				dsize[i] = x[i].size();
+				wasOut[i] = x[i].indomain(i);
+			}
+			sccRoot = root;
+			sccStamp = sccRuns;
+		}
+		return true;
+	}
+
+	// Whether an scc pass from root would find what the last one did. Values
+	// only get removed, so the pass visits the nodes in the same order as long
+	// as the tree edges are still there; it then finds the same lowlinks and
+	// back edges if the non-tree edges of the nodes whose domain changed still
+	// give the same lowest index and number of back edges. What the pass may
+	// prune also depends on which nodes have to be in the circuit. Only the
+	// domains that changed since the last pass are looked at.
+	bool sccUnchanged(int r) {
+		if (sccStamp != sccRuns || r != sccRoot) {
+			return false;
+		}
+		for (int v = 0; v < size; v++) {
+			if (x[v].size() == dsize[v]) {
+				continue;
+			}
+			if (x[v].indomain(v) != wasOut[v]) {
+				return false;
+			}
+			if (index[v] < 0) {
+				continue;  // Not reachable then, so not now either
+			}
+			int kids = 0;
+			int low = index[v];
+			int back = 0;
+			int lo = 0;
+			int hi = 0;
+			if (v != r && subtree[v] > 0) {
+				lo = subStart[subtree[v] - 1];
+				hi = subStart[subtree[v]] - 1;
+			}
+			for (typename IntView<U>::iterator i = x[v].begin(); i != x[v].end(); ++i) {
+				const int c = *i;
+				if (tparent[c] == v) {
+					kids++;
+				} else if (v != r && c != v) {
+					if (index[c] < low) {
+						low = index[c];
+					}
+					if (index[c] >= lo && index[c] <= hi) {
+						back++;
+					}
+				}
+			}
+			if (kids != nkids[v]) {
+				return false;
+			}
+			if (v != r && (low != lowLocal[v] || back != nback[v])) {
+				return false;
+			}
+		}
 		return true;
 	}
 
@@ -1136,6 +1293,9 @@ public:
 					}
 					return propagateCheck();
 				}
+				if (sccUnchanged(root)) {
+					return true;
+				}
 				if (!propagateSCC(root)) {
 					return false;
 				}
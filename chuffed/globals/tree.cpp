@@ -489,12 +489,7 @@ TreePropagator::TreePropagator(vec<BoolView>& _vs, vec<BoolView>& _es, vec<vec<e
 		}
 	}
 
-	adj = std::vector<std::vector<int> >(_adj.size(), std::vector<int>());
-	for (int i = 0; i < _adj.size(); i++) {
-		for (int j = 0; j < _adj[i].size(); j++) {
-			adj[i].push_back(_adj[i][j]);
-		}
-	}
+	adj = CSRLists(_adj);
 
 	nodes2edge = std::vector<std::vector<std::vector<int> > >(nbNodes());
 	for (int i = 0; i < nbNodes(); i++) {
@@ -1140,7 +1135,7 @@ public:
 						const int c = q.front();
 						q.pop();
 						visited[c] = true;
-						const std::vector<int> adj = p->getAdjacentEdges(c);
+						const CSRLists::Range adj = p->getAdjacentEdges(c);
 						for (const int e : adj) {
 							if (!p->getEdgeVar(e).isFixed()) {
 								leaving_cc[last_t][last_cc].emplace_back(e, p->getOtherEndnode(e, c));
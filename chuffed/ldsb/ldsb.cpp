@@ -10,6 +10,7 @@
 #include "chuffed/vars/int-var.h"
 #include "chuffed/vars/vars.h"
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <cstdio>
@@ -20,6 +21,12 @@
 
 LDSB ldsb;
 
+// Buffers for building symmetric clauses, shared by the symmetries
+static vec<int> sym_moved;
+static bool sym_moved_ready = false;
+static vec<Lit> sym_images;
+static vec<Lit> sym_ps;
+
 //-------
 
 class Symmetry {
@@ -32,16 +39,47 @@ public:
 	virtual void processDec(Lit p, int pos) = 0;
 	virtual bool processImpl(Clause* r, int pos) = 0;
 	virtual Lit getSymLit(Lit p, int r1, int r2) = 0;
-
-	Clause* getSymClause(Clause* r, int r1, int r2) {
-		vec<Lit> ps(r->size());
-		for (int i = 1; i < r->size(); i++) {
-			ps[i] = getSymLit((*r)[i], r1, r2);
-			if (sat.value(ps[i]) != l_False) {
+	// Whether some permutation of the symmetry can map p to another literal
+	virtual bool mayMove(Lit p) = 0;
+
+	// Starts applying permutations to a new clause. The body literals that the
+	// symmetry can move are found at the first image built, and kept for the
+	// next ones; the other literals are mapped to themselves, and are false.
+	static void newClause() { sym_moved_ready = false; }
+
+	// The image of r, if its body is false
+	template <class C>
+	Clause* getSymClause(C& r, int r1, int r2) {
+		ldsb.sym_tried[sym_id]++;
+		if (!sym_moved_ready) {
+			sym_moved.clear();
+			for (int i = 1; i < r.size(); i++) {
+				if (mayMove(r[i])) {
+					sym_moved.push(i);
+				}
+			}
+			sym_moved_ready = true;
+		}
+		sym_images.clear();
+		for (int k = 0; k < sym_moved.size(); k++) {
+			const Lit q = getSymLit(r[sym_moved[k]], r1, r2);
+			if (sat.value(q) != l_False) {
 				return nullptr;
 			}
+			sym_images.push(q);
+		}
+		vec<Lit>& ps = sym_ps;
+		ps.clear();
+		ps.growTo(r.size());
+		ps[0] = getSymLit(r[0], r1, r2);
+		for (int i = 1; i < r.size(); i++) {
+			assert(sat.value(r[i]) == l_False);
+			ps[i] = r[i];
 		}
-		ps[0] = getSymLit((*r)[0], r1, r2);
+		for (int k = 0; k < sym_moved.size(); k++) {
+			ps[sym_moved[k]] = sym_images[k];
+		}
+		ldsb.sym_produced[sym_id]++;
 		return Clause_new(ps, true);
 	}
 };
@@ -56,6 +94,8 @@ void LDSB::init() {
 	for (int i = 0; i < symmetries.size(); i++) {
 		symmetries[i]->init();
 	}
+	sym_tried.growTo(symmetries.size(), 0);
+	sym_produced.growTo(symmetries.size(), 0);
 }
 
 void LDSB::processDec(Lit p) {
@@ -119,6 +159,21 @@ bool LDSB::processImpl(Clause* c) {
 	return true;
 }
 
+void LDSB::printStats() {
+	long long tried = 0;
+	long long produced = 0;
+	for (int i = 0; i < symmetries.size(); i++) {
+		tried += sym_tried[i];
+		produced += sym_produced[i];
+	}
+	printf("%%%%%%mzn-stat: ldsbSymClausesTried=%lld\n", tried);
+	printf("%%%%%%mzn-stat: ldsbSymClauses=%lld\n", produced);
+	// Symmetries which never produce a clause only cost time
+	for (int i = 0; i < symmetries.size(); i++) {
+		printf("%%%%%%mzn-stat: ldsbSym%dClauses=%lld\n", i, sym_produced[i]);
+	}
+}
+
 void LDSB::addLearntClause(Clause& c, int sym_id) {
 	sym_learnts.push(&c);
 	sl_origin.push(sym_id);
@@ -144,6 +199,8 @@ public:
 	int n;
 	int* vars;
 	Tchar* active;
+	vec<int> pos_of;  // position of each variable, or -1
+	vec<int> base;    // base value literal of each position
 
 	VarSym(vec<IntVar*>& v) : n(v.size()) {
 		vars = (int*)malloc(n * sizeof(int));
@@ -162,9 +219,12 @@ public:
 	}
 
 	void init() override {
+		pos_of.growTo(engine.vars.size(), -1);
 		for (int i = 0; i < n; i++) {
 			assert(engine.vars[vars[i]]->getType() == INT_VAR_EL);
 			ldsb.lookupTable[vars[i]].push(std::pair<int, int>(sym_id, i));
+			pos_of[vars[i]] = i;
+			base.push(((IntVarEL*)engine.vars[vars[i]])->getBaseVLit());
 		}
 	}
 
@@ -182,6 +242,7 @@ public:
 		}
 
 		const Lit p = (*r)[0];
+		newClause();
 
 		for (int i = 0; i < n; i++) {
 			if (!so.ldsbta && (active[i] == 0)) {
@@ -190,14 +251,14 @@ public:
 			if (i == pos) {
 				continue;
 			}
-			const Lit q = getSymLit(p, vars[pos], vars[i]);
+			const Lit q = getSymLit(p, pos, i);
 			const lbool b = sat.value(q);
 			if (b == l_True) {
 				continue;
 			}
 			if (b == l_False) {
 				// can fail here!
-				Clause* c = getSymClause(r, vars[pos], vars[i]);
+				Clause* c = getSymClause(*r, pos, i);
 				if (c == nullptr) {
 					if (LDSB_DEBUG) {
 						printf("Skip VarSym Failure\n");
@@ -212,7 +273,7 @@ public:
 				}
 				return false;
 			}
-			Clause* s = getSymClause(r, vars[pos], vars[i]);
+			Clause* s = getSymClause(*r, pos, i);
 			if (s == nullptr) {
 				if (LDSB_DEBUG) {
 					printf("Skip VarSym Implication");
@@ -230,25 +291,26 @@ public:
 		return true;
 	}
 
+	bool mayMove(Lit p) override {
+		const int var_id = sat.c_info[var(p)].cons_id;
+		return var_id != -1 && pos_of[var_id] != -1;
+	}
+
+	// Swaps the variables at positions a and b
 	Lit getSymLit(Lit p, int a, int b) override {
 		const int var_id = sat.c_info[var(p)].cons_id;
-		Lit q = p;
+		if (var_id == -1) {
+			return p;
+		}
+		const int pos = pos_of[var_id];
 		// Not very safe!!!!
-		if (var_id == a) {
-			const int base_a = ((IntVarEL*)engine.vars[a])->getBaseVLit();
-			const int base_b = ((IntVarEL*)engine.vars[b])->getBaseVLit();
-			q = toLit(toInt(p) - base_a + base_b);
-			//			assert(sat.c_info[var(q)].cons_id == b);
+		if (pos == a) {
+			return toLit(toInt(p) - base[a] + base[b]);
 		}
-		if (var_id == b) {
-			const int base_a = ((IntVarEL*)engine.vars[a])->getBaseVLit();
-			const int base_b = ((IntVarEL*)engine.vars[b])->getBaseVLit();
-			q = toLit(toInt(p) - base_b + base_a);
-			//			assert(sat.c_info[var(q)].cons_id == a);
+		if (pos == b) {
+			return toLit(toInt(p) - base[b] + base[a]);
 		}
-
-		//		assert(sat.c_info[var(q)].v == sat.c_info[var(p)].v);
-		return q;
+		return p;
 	}
 };
 
@@ -326,7 +388,8 @@ public:
 		}
 
 		//		Clause *rc = cleanClause(r);
-		Clause* rc = r;
+		Clause& rc = *r;
+		newClause();
 
 		for (int i = min; i <= max; i++) {
 			if (!so.ldsbta && !active[i - min]) {
@@ -430,6 +493,11 @@ public:
 		return cc;
 	}
 
+	bool mayMove(Lit p) override {
+		const int var_id = sat.c_info[var(p)].cons_id;
+		return var_id != -1 && which_vars[var_id];
+	}
+
 	Lit getSymLit(Lit p, int a, int b) override {
 		const int var_id = sat.c_info[var(p)].cons_id;
 		if (!which_vars[var_id]) {
@@ -528,6 +596,7 @@ public:
 		}
 
 		//	printf("processing var %d implication\n", sat.c_info[var(p)].cons_id);
+		newClause();
 
 		for (int i = 0; i < occ[var_id].size(); i++) {
 			const int r1 = occ[var_id][i] / m;
@@ -545,7 +614,7 @@ public:
 				}
 				if (b == l_False) {
 					// can fail here!
-					Clause* c = getSymClause(r, r1, r2);
+					Clause* c = getSymClause(*r, r1, r2);
 					if (c == nullptr) {
 						if (LDSB_DEBUG) {
 							printf("Skip VarSeqSym Failure\n");
@@ -560,7 +629,7 @@ public:
 					}
 					return false;
 				}
-				Clause* s = getSymClause(r, r1, r2);
+				Clause* s = getSymClause(*r, r1, r2);
 				if (s == nullptr) {
 					if (LDSB_DEBUG) {
 						printf("Skip VarSeqSym implication");
@@ -602,6 +671,11 @@ public:
 		return true;
 	}
 
+	bool mayMove(Lit p) override {
+		const int var_id = sat.c_info[var(p)].cons_id;
+		return var_id != -1 && occ[var_id].size() > 0;
+	}
+
 	Lit getSymLit(Lit p, int r1, int r2) override {
 		const int var_id = sat.c_info[var(p)].cons_id;
 		if (var_id == -1) {
@@ -641,9 +715,11 @@ public:
 	int max;
 	vec<vec<int> > valseqs;
 	vec<vec<int> > occ;
+	vec<int> col_of;  // column of value v in row r at (v - min) * n + r, or -1
 	vec<IntVar*> vars;
 	bool* which_vars;
 	Tchar* active;
+	vec<Lit> cleaned;
 
 	static const int not_a_val = -1000000000;
 
@@ -662,11 +738,15 @@ public:
 		for (int i = min; i <= max; i++) {
 			occ.push();
 		}
+		col_of.growTo((max - min + 1) * n, -1);
 		for (int i = 0; i < n; i++) {
 			valseqs.push();
 			for (int j = 0; j < m; j++) {
 				valseqs[i].push(a[i * m + j]);
 				occ[a[i * m + j] - min].push(i * m + j);
+				if (col_of[(a[i * m + j] - min) * n + i] == -1) {
+					col_of[(a[i * m + j] - min) * n + i] = j;
+				}
 			}
 		}
 		for (int i = 0; i < v.size(); i++) {
@@ -722,7 +802,8 @@ public:
 			return true;
 		}
 
-		Clause* rc = cleanClause(r);
+		vec<Lit>& rc = cleanClause(r);
+		newClause();
 
 		for (int k = 0; k < occ[v - min].size(); k++) {
 			const int r1 = occ[v - min][k] / m;
@@ -756,7 +837,6 @@ public:
 					if (LDSB_DEBUG) {
 						printf("ValSeqSym Failure\n");
 					}
-					free(rc);
 					return false;
 				}
 				Clause* s = getSymClause(rc, r1, r2);
@@ -773,13 +853,14 @@ public:
 			}
 		}
 
-		free(rc);
-
 		return true;
 	}
 
-	Clause* cleanClause(Clause* r) const {
-		vec<Lit> ps;
+	// r, with the bounds literals on variables of the symmetry replaced by
+	// value literals
+	vec<Lit>& cleanClause(Clause* r) {
+		vec<Lit>& ps = cleaned;
+		ps.clear();
 		ps.push((*r)[0]);
 
 		Clause& c = *r;
@@ -820,7 +901,12 @@ public:
 			NEVER;
 		}
 
-		return Clause_new(ps);
+		return ps;
+	}
+
+	bool mayMove(Lit p) override {
+		const int var_id = sat.c_info[var(p)].cons_id;
+		return var_id != -1 && which_vars[var_id];
 	}
 
 	Lit getSymLit(Lit p, int r1, int r2) override {
@@ -832,19 +918,24 @@ public:
 		if (v == not_a_val) {
 			NOT_SUPPORTED;
 		}
-		for (int i = 0; i < occ[v - min].size(); i++) {
-			const int r = occ[v - min][i] / m;
-			const int c = occ[v - min][i] % m;
-			if (r == r1) {
-				const int v2 = valseqs[r2][c];
-				return toLit(toInt(p) - v * 2 + v2 * 2);
-			}
-			if (r == r2) {
-				const int v2 = valseqs[r1][c];
-				return toLit(toInt(p) - v * 2 + v2 * 2);
-			}
+		if (v < min || v > max) {
+			return p;
 		}
-		return p;
+		// The first occurrence of v in rows r1 and r2 takes the value at the same
+		// column of the other row
+		const int lo = std::min(r1, r2);
+		const int hi = std::max(r1, r2);
+		int r = lo;
+		int c = col_of[(v - min) * n + lo];
+		if (c == -1) {
+			r = hi;
+			c = col_of[(v - min) * n + hi];
+		}
+		if (c == -1) {
+			return p;
+		}
+		const int v2 = valseqs[r == r1 ? r2 : r1][c];
+		return toLit(toInt(p) - v * 2 + v2 * 2);
 	}
 
 	static int getLitVal(Lit p) {
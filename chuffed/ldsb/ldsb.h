@@ -21,11 +21,15 @@ public:
 	vec<int> sl_origin;        // Source of new learnt clause
 
 	duration ldsb_time;
+	// Symmetric clauses tried and produced, by symmetry
+	vec<long long> sym_tried;
+	vec<long long> sym_produced;
 
 	void init();
 	void processDec(Lit p);
 	bool processImpl(Clause* c);
 	void addLearntClause(Clause& c, int sym_id);
+	void printStats();
 };
 
 void var_sym_ldsb(vec<IntVar*>& x);
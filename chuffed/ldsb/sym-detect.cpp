@@ -0,0 +1,317 @@
+#include "chuffed/ldsb/sym-detect.h"
+
+#include "chuffed/core/options.h"
+#include "chuffed/globals/globals.h"
+#include "chuffed/ldsb/ldsb.h"
+#include "chuffed/support/automorphism.h"
+#include "chuffed/support/misc.h"
+#include "chuffed/support/vec.h"
+#include "chuffed/vars/int-var.h"
+#include "chuffed/vars/vars.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Refinement work allowed per vertex and edge of the graph
+#define WORK_PER_ELEMENT 2000
+// Failed branches allowed in the search for one exchange
+#define MAX_BACKTRACKS 64
+// Times a pivot is retried on the candidates that did not fit its first group
+#define MAX_PASSES 3
+
+SymDetect sym_detect;
+
+int SymDetect::vertex(const std::string& c) {
+	auto it = colours.find(c);
+	if (it == colours.end()) {
+		it = colours.emplace(c, next_colour++).first;
+	}
+	colour.push_back(it->second);
+	int_var.push_back(nullptr);
+	return static_cast<int>(colour.size()) - 1;
+}
+
+int SymDetect::intVertex(IntVar* x, const std::string& c) {
+	const int v = vertex(c);
+	int_var[v] = x;
+	vars.push_back(v);
+	return v;
+}
+
+int SymDetect::fixedVertex() {
+	colour.push_back(next_colour++);
+	int_var.push_back(nullptr);
+	vars.push_back(static_cast<int>(colour.size()) - 1);
+	return static_cast<int>(colour.size()) - 1;
+}
+
+// Looks for a group of exchanges of p with the candidates, that swap the same
+// sequence of variables containing p with disjoint sequences. The sequence of
+// p is what the first two exchanges found have in common; a single exchange
+// can be split either way into two sequences, which is only done on the first
+// pass. Candidates that do not fit the group are left in rejected. All of
+// them are in the cell of p.
+std::vector<std::vector<int> > SymDetect::findGroup(AutomorphismSearch& search, int p,
+																										const std::vector<int>& cell,
+																										std::vector<int>& cands,
+																										std::vector<int>& rejected,
+																										bool first_pass) {
+	std::vector<std::vector<int> > blocks;
+	std::vector<int> perm;
+	std::vector<int> moved;
+	std::vector<int> first_perm;
+	std::vector<int> first_moved;
+	int first_q = -1;
+	bool alone = true;
+	const int in_group = ++cur_stamp;
+
+	// Whether perm exchanges seq with a sequence outside the group
+	auto exchanges = [&](const std::vector<int>& seq, const std::vector<int>& pm,
+											 const std::vector<int>& mv) {
+		if (mv.size() != 2 * seq.size()) {
+			return false;
+		}
+		const int in_seq = ++cur_stamp;
+		for (const int v : seq) {
+			seq_stamp[v] = in_seq;
+		}
+		for (const int v : seq) {
+			if (pm[v] == v || seq_stamp[pm[v]] == in_seq || group_stamp[pm[v]] == in_group) {
+				return false;
+			}
+		}
+		return true;
+	};
+	auto addBlock = [&](const std::vector<int>& seq, const std::vector<int>& pm) {
+		std::vector<int> b;
+		for (const int v : seq) {
+			b.push_back(pm[v]);
+			group_stamp[pm[v]] = in_group;
+		}
+		blocks.push_back(b);
+	};
+
+	for (const int q : cands) {
+		if (search.work > max_work) {
+			gave_up = true;
+			rejected.push_back(q);
+			continue;
+		}
+		swaps_tried++;
+		// An exchange of p and q alone is much cheaper to look for, since
+		// fixing the rest of their cell leaves little to search. Once there is
+		// none, the other exchanges of p are unlikely to be that simple.
+		bool found = false;
+		if (alone) {
+			found = alone = search.findSwap(p, q, perm, MAX_BACKTRACKS, cell);
+		}
+		if (!found && !search.findSwap(p, q, perm, MAX_BACKTRACKS)) {
+			rejected.push_back(q);
+			continue;
+		}
+		// Only integer variables may move, each exchanged with another
+		bool ok = true;
+		moved.clear();
+		for (const int v : vars) {
+			if (perm[v] != v) {
+				if (int_var[v] == nullptr || perm[perm[v]] != v) {
+					ok = false;
+					break;
+				}
+				moved.push_back(v);
+			}
+		}
+		if (!ok) {
+			rejected.push_back(q);
+			continue;
+		}
+
+		if (!blocks.empty()) {
+			if (exchanges(blocks[0], perm, moved)) {
+				addBlock(blocks[0], perm);
+			} else {
+				rejected.push_back(q);
+			}
+		} else if (first_q == -1) {
+			first_q = q;
+			first_perm.swap(perm);
+			first_moved.swap(moved);
+		} else {
+			std::vector<int> seq;
+			std::set_intersection(first_moved.begin(), first_moved.end(), moved.begin(), moved.end(),
+														std::back_inserter(seq));
+			if (exchanges(seq, first_perm, first_moved) && exchanges(seq, perm, moved)) {
+				blocks.push_back(seq);
+				for (const int v : seq) {
+					group_stamp[v] = in_group;
+				}
+				addBlock(seq, first_perm);
+				if (exchanges(seq, perm, moved)) {
+					addBlock(seq, perm);
+				} else {
+					rejected.push_back(q);
+				}
+			} else {
+				rejected.push_back(q);
+			}
+		}
+	}
+
+	if (blocks.empty() && first_q != -1) {
+		if (first_pass) {
+			std::vector<int> seq;
+			for (const int v : first_moved) {
+				if (v == p || (first_perm[v] != p && v < first_perm[v])) {
+					seq.push_back(v);
+				}
+			}
+			blocks.push_back(seq);
+			addBlock(seq, first_perm);
+		} else {
+			rejected.push_back(first_q);
+		}
+	}
+	return blocks;
+}
+
+// Declares the exchangeable sequences to LDSB, or orders them by lex
+// constraints when they are disjoint from the ones already ordered
+void SymDetect::post(std::vector<std::vector<int> >& blocks, std::vector<bool>& broken) {
+	const int n = static_cast<int>(blocks.size());
+	const int m = static_cast<int>(blocks[0].size());
+	groups++;
+	grouped_vars += n * m;
+
+	if (so.ldsb) {
+		vec<IntVar*> x;
+		bool same_bounds = true;
+		for (const auto& b : blocks) {
+			for (const int v : b) {
+				IntVar* y = int_var[v];
+				// LDSB works on eager literals
+				if (y->getType() != INT_VAR_EL &&
+						(y->getType() != INT_VAR || y->getMax() - y->getMin() > so.eager_limit)) {
+					return;
+				}
+				same_bounds &= y->getMin() == int_var[blocks[0][0]]->getMin() &&
+											 y->getMax() == int_var[blocks[0][0]]->getMax();
+				x.push(y);
+			}
+		}
+		for (int i = 0; i < x.size(); i++) {
+			x[i]->specialiseToEL();
+		}
+		if (m == 1 && same_bounds) {
+			var_sym_ldsb(x);
+		} else {
+			var_seq_sym_ldsb(n, m, x);
+		}
+	} else if (so.sym_static) {
+		for (const auto& b : blocks) {
+			for (const int v : b) {
+				if (broken[v]) {
+					return;
+				}
+			}
+		}
+		for (int i = 0; i + 1 < n; i++) {
+			vec<IntVar*> x;
+			vec<IntVar*> y;
+			for (int j = 0; j < m; j++) {
+				x.push(int_var[blocks[i][j]]);
+				y.push(int_var[blocks[i + 1][j]]);
+			}
+			lex(x, y, false);
+		}
+		for (const auto& b : blocks) {
+			for (const int v : b) {
+				broken[v] = true;
+			}
+		}
+	}
+}
+
+void SymDetect::detect() {
+	const time_point start = chuffed_clock::now();
+	const int n = static_cast<int>(colour.size());
+
+	std::sort(edges.begin(), edges.end());
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+	std::vector<std::vector<int> > adj(n);
+	for (const auto& e : edges) {
+		adj[e.first].push_back(e.second);
+		adj[e.second].push_back(e.first);
+	}
+	max_work = WORK_PER_ELEMENT * (static_cast<long long>(n) + 2 * edges.size());
+	std::vector<std::pair<int, int> >().swap(edges);
+	AutomorphismSearch search(colour, adj);
+	std::vector<std::vector<int> >().swap(adj);
+	seq_stamp.assign(n, 0);
+	group_stamp.assign(n, 0);
+
+	// Integer variables, by cell of the equitable partition
+	std::vector<int> ints;
+	for (const int v : vars) {
+		if (int_var[v] != nullptr) {
+			ints.push_back(v);
+		}
+	}
+	std::stable_sort(ints.begin(), ints.end(),
+									 [&](int u, int v) { return search.cell(u) < search.cell(v); });
+
+	std::vector<bool> covered(n, false);
+	std::vector<bool> broken(n, false);
+	for (size_t s = 0; s < ints.size() && !gave_up;) {
+		size_t e = s + 1;
+		while (e < ints.size() && search.cell(ints[e]) == search.cell(ints[s])) {
+			e++;
+		}
+		const std::vector<int> cell(ints.begin() + s, ints.begin() + e);
+		for (size_t i = s; i < e && !gave_up; i++) {
+			const int p = ints[i];
+			if (covered[p]) {
+				continue;
+			}
+			std::vector<int> cands;
+			for (size_t j = s; j < e; j++) {
+				if (j != i) {
+					cands.push_back(ints[j]);
+				}
+			}
+			for (int pass = 0; pass < MAX_PASSES && !cands.empty() && !gave_up; pass++) {
+				std::vector<int> rejected;
+				std::vector<std::vector<int> > blocks =
+						findGroup(search, p, cell, cands, rejected, pass == 0);
+				if (blocks.empty()) {
+					break;
+				}
+				post(blocks, broken);
+				for (const auto& b : blocks) {
+					for (const int v : b) {
+						covered[v] = true;
+					}
+				}
+				cands.swap(rejected);
+			}
+			covered[p] = true;
+		}
+		s = e;
+	}
+
+	time += std::chrono::duration_cast<duration>(chuffed_clock::now() - start);
+	if (so.verbosity >= 1 && gave_up) {
+		fprintf(stderr, "%% Symmetry detection stopped early, the model is too large\n");
+	}
+}
+
+void SymDetect::printStats() {
+	printf("%%%%%%mzn-stat: symDetectTime=%.3f\n", to_sec(time));
+	printf("%%%%%%mzn-stat: symDetectSwapsTried=%d\n", swaps_tried);
+	printf("%%%%%%mzn-stat: symDetectGroups=%d\n", groups);
+	printf("%%%%%%mzn-stat: symDetectVars=%d\n", grouped_vars);
+}
@@ -0,0 +1,61 @@
+#ifndef sym_detect_h
+#define sym_detect_h
+
+#include "chuffed/support/misc.h"
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+class AutomorphismSearch;
+class IntVar;
+
+// Detection of interchangeable sequences of integer variables. The model is
+// described as a coloured graph with a vertex per variable and per constraint;
+// each automorphism of the graph that exchanges two sequences of integer
+// variables, and fixes every other variable, is a symmetry of the model.
+// The symmetries found are declared to LDSB, or broken by lex constraints.
+class SymDetect {
+public:
+	// A vertex for an integer variable, which symmetries may move
+	int intVertex(IntVar* x, const std::string& colour);
+	// A vertex for any other variable, which symmetries must fix
+	int fixedVertex();
+	int vertex(const std::string& colour);
+	void addEdge(int u, int v) { edges.emplace_back(u, v); }
+	// Gives v a colour of its own, e.g. for the objective
+	void isolate(int v) { colour[v] = next_colour++; }
+
+	void detect();
+	void printStats();
+
+private:
+	std::map<std::string, int> colours;
+	int next_colour{0};
+	std::vector<int> colour;
+	std::vector<IntVar*> int_var;  // nullptr if not an integer variable
+	std::vector<int> vars;  // vertices of all the variables
+	std::vector<std::pair<int, int> > edges;
+
+	// Scratch for findGroup
+	std::vector<int> seq_stamp;
+	std::vector<int> group_stamp;
+	int cur_stamp{0};
+	long long max_work{0};
+
+	int groups{0};
+	int grouped_vars{0};
+	int swaps_tried{0};
+	bool gave_up{false};
+	duration time{duration::zero()};
+
+	std::vector<std::vector<int> > findGroup(AutomorphismSearch& search, int p,
+																					 const std::vector<int>& cell, std::vector<int>& cands,
+																					 std::vector<int>& rejected, bool first_pass);
+	void post(std::vector<std::vector<int> >& blocks, std::vector<bool>& broken);
+};
+
+extern SymDetect sym_detect;
+
+#endif
@@ -3,6 +3,7 @@
 #include "chuffed/mdd/opcache.h"
 #include "chuffed/support/vec.h"
 
+#include <algorithm>
 #include <cassert>
 #include <climits>
 #include <cstdlib>
@@ -10,7 +11,7 @@
 #include <iostream>
 #include <vector>
 
-#define OPCACHE_SZ 100000
+#define OPCACHE_SZ 4096  // initial size, the cache grows as needed
 #define CACHE_SZ 180000
 
 static MDDEdge mkedge(unsigned int val, unsigned int dest) {
@@ -30,7 +31,7 @@ inline void MDDTable::deallocNode(MDDNode node)
 
 MDDTable::MDDTable(int _nvars)
 		: nvars(_nvars),
-			opcache(OpCache(OPCACHE_SZ))
+			opcache(OPCACHE_SZ)
 #ifdef SPLIT_CACHE
 					cache(new NodeCache[nvars])
 #endif
@@ -138,6 +139,82 @@ MDDNodeInt MDDTable::tuple(vec<T>& tpl) {
 
 template MDDNodeInt MDDTable::tuple(vec<int>& tpl);
 
+// Sorts the tuples lexicographically, by a stable counting sort on each column
+// from the last one; a column whose values are too spread out is sorted by
+// comparison instead.
+static void sortTuples(vec<vec<int> >& tpls, unsigned int arity, std::vector<int>& order) {
+	const int n = tpls.size();
+	order.resize(n);
+	for (int i = 0; i < n; i++) {
+		order[i] = i;
+	}
+	std::vector<int> next(n);
+	std::vector<int> counts;
+	for (int col = (int)arity - 1; col >= 0; col--) {
+		int lo = INT_MAX;
+		int hi = INT_MIN;
+		for (int i = 0; i < n; i++) {
+			lo = std::min(lo, tpls[i][col]);
+			hi = std::max(hi, tpls[i][col]);
+		}
+		const long long range = (long long)hi - lo + 1;
+		if (range > std::max(n, 1 << 16)) {
+			std::stable_sort(order.begin(), order.end(),
+											 [&](int a, int b) { return tpls[a][col] < tpls[b][col]; });
+			continue;
+		}
+		counts.assign(range + 1, 0);
+		for (int i = 0; i < n; i++) {
+			counts[tpls[i][col] - lo + 1]++;
+		}
+		for (long long v = 0; v < range; v++) {
+			counts[v + 1] += counts[v];
+		}
+		for (int i = 0; i < n; i++) {
+			next[counts[tpls[order[i]][col] - lo]++] = order[i];
+		}
+		order.swap(next);
+	}
+}
+
+// Unlike or-ing the tuples in one at a time, this creates no intermediate
+// nodes: each call makes a node of the final MDD (or finds it in the cache)
+// from the sorted tuples order[lo..hi), which agree on the variables before
+// var.
+MDDNodeInt MDDTable::tuples(vec<vec<int> >& tpls) {
+	if (tpls.size() == 0) {
+		return MDDFALSE;
+	}
+	const unsigned int arity = tpls[0].size();
+	std::vector<int> order;
+	sortTuples(tpls, arity, order);
+	return tuples_rec(tpls, order, 0, arity, 0, tpls.size());
+}
+
+MDDNodeInt MDDTable::tuples_rec(vec<vec<int> >& tpls, std::vector<int>& order, unsigned int var,
+																unsigned int arity, int lo, int hi) {
+	if (var == arity) {
+		return MDDTRUE;
+	}
+
+	const unsigned int start = stack.size();
+	int i = lo;
+	while (i < hi) {
+		const int val = tpls[order[i]][var];
+		int j = i + 1;
+		while (j < hi && tpls[order[j]][var] == val) {
+			j++;
+		}
+		const MDDNodeInt child = tuples_rec(tpls, order, var + 1, arity, i, j);
+		stack.push_back(mkedge(val, child));
+		if (j == hi || tpls[order[j]][var] != val + 1) {
+			stack.push_back(mkedge(val + 1, MDDFALSE));
+		}
+		i = j;
+	}
+	return insert(var, MDDFALSE, start);
+}
+
 MDDNodeInt MDDTable::mdd_vareq(int var, int val) {
 	assert(var < nvars);
 
@@ -157,6 +157,8 @@ public:
 	template <class T>
 	MDDNodeInt tuple(vec<T>& /*tpl*/);
 	//   MDDNodeInt tuple(std::vector<int>&);
+	// The disjunction of the tuples, built in one pass over them once sorted
+	MDDNodeInt tuples(vec<vec<int> >& /*tpls*/);
 
 	MDD vareq(int var, int val) { return {this, mdd_vareq(var, val)}; }
 	MDD ttt() { return {this, MDDTRUE}; }
@@ -181,6 +183,9 @@ private:
 	static inline MDDNode allocNode(int n_edges);
 	static inline void deallocNode(MDDNode node);
 
+	MDDNodeInt tuples_rec(vec<vec<int> >& tpls, std::vector<int>& order, unsigned int var,
+												unsigned int arity, int lo, int hi);
+
 	int nvars;
 
 	OpCache opcache;
@@ -140,7 +140,11 @@ MDDProp<U>* MDDProp_new(MDDTemplate* _templ, vec<IntView<U> >& _intvars) {
 
 template <int U>
 MDDProp<U>::MDDProp(MDDTemplate* _templ, vec<IntView<U> >& _intvars, const MDDOpts& _opts)
-		: opts(_opts), act_decay(1 / 0.95), fixedvars(_templ->_val_entries.size()) {
+		: opts(_opts),
+			val_edges(_templ->_val_edges),
+			node_edges(_templ->_node_edges),
+			act_decay(1 / 0.95),
+			fixedvars(_templ->_val_entries.size()) {
 	assert(_intvars.size() == _templ->_doms.size());
 
 	// Larger domain stuff
@@ -151,6 +155,13 @@ MDDProp<U>::MDDProp(MDDTemplate* _templ, vec<IntView<U> >& _intvars, const MDDOp
 	_templ->_mdd_nodes.copyTo(nodes);
 	_templ->_edges.copyTo(edges);
 
+	live_edges.growTo((edges.size() + 63) >> 6, ~(uint64_t)0);
+	if ((edges.size() & 63) != 0) {
+		live_edges.last() = ((uint64_t)1 << (edges.size() & 63)) - 1;
+	}
+	live_stamp.growTo(live_edges.size(), 0);
+	touched_stamp.growTo(val_entries.size(), 0);
+
 	_intvars.copyTo(intvars);
 
 	for (int i = 0; i < intvars.size(); i++) {
@@ -184,9 +195,6 @@ MDDProp<U>::MDDProp(MDDTemplate* _templ, vec<IntView<U> >& _intvars, const MDDOp
 		}
 	}
 
-	_templ->_node_edges.copyTo(node_edges);
-	_templ->_val_edges.copyTo(val_edges);
-
 	// Attach to the solver.
 	priority = 1;
 
@@ -1100,6 +1108,9 @@ bool MDDProp<U>::propagate() {
 
 	const vec<int> inf_temp;
 
+	prop_stamp++;
+	touched_vals.clear();
+
 	unsigned int count = fixedvars.size() << 3;
 
 	for (int c = 0; c < clear_queue.size(); c++) {
@@ -1107,23 +1118,32 @@ bool MDDProp<U>::propagate() {
 
 		const int val = clear_queue[c];
 
+#ifdef USE_WATCHES
 		int* edge = VAL_EDGES(val);
 		int* end = VAL_END(val);
 		// Kill the watched edge first, to make backtracking neater.
-#ifdef USE_WATCHES
 		assert(!IS_DEAD_IND(*edge));
-#endif
 		for (; edge != end; edge++) {
 			kill_dom(count, edges + *edge, kfa, kfb);
 		}
-#ifndef USE_WATCHES
-		if (val_entries[val].supp_count == 0) {
-			std::cout << prop_id << "|" << c << "|" << val << std::endl;
-			std::cout << clear_queue << '\n';
+#else
+		assert(has_live_edge(val));
+		// Only the edges still alive are visited, a word at a time.
+		const int lo = val_entries[val].first_off;
+		const int hi = lo + val_entries[val].count;
+		for (int w = lo >> 6; w <= (hi - 1) >> 6; w++) {
+			uint64_t bits = live_edges[w];
+			if (w == lo >> 6) {
+				bits &= ~(uint64_t)0 << (lo & 63);
+			}
+			if (w == (hi - 1) >> 6 && (hi & 63) != 0) {
+				bits &= ((uint64_t)1 << (hi & 63)) - 1;
+			}
+			while (bits != 0) {
+				kill_dom(count, edges + ((w << 6) | lowestBit(bits)), kfa, kfb);
+				bits &= bits - 1;
+			}
 		}
-
-		assert(VAL(val).supp_count != 0);
-		trailChange(VAL(val).supp_count, 0);
 #endif
 	}
 
@@ -1181,6 +1201,7 @@ bool MDDProp<U>::propagate() {
 
 			inc_edge* e(edges + *edge);
 			trailChange(e->kill_flags, count | 1);
+			clear_live(*edge);
 
 			if (WATCHED_BELOW(e)) kfa.push(e->end);
 
@@ -1207,6 +1228,7 @@ bool MDDProp<U>::propagate() {
 
 			inc_edge* e(edges + *edge);
 			trailChange(e->kill_flags, count | 1);
+			clear_live(*edge);
 
 			const int end_node = e->end;
 
@@ -1218,12 +1240,9 @@ bool MDDProp<U>::propagate() {
 			}
 
 			const Value val(e->val);
-			val_entry& valent(VAL(val));
-			//            (valent.supp_count)--;
-			trailChange(valent.supp_count, valent.supp_count - 1);
-			if ((valent.supp_count) == 0) {
-				inferences.push(val);
-				val_entries[val].val_lim = count >> 3;
+			if (touched_stamp[val] != prop_stamp) {
+				touched_stamp[val] = prop_stamp;
+				touched_vals.push(val);
 			}
 		}
 #endif
@@ -1315,6 +1334,7 @@ bool MDDProp<U>::propagate() {
 			inc_edge* e(edges + *edge);
 
 			trailChange(e->kill_flags, count | 2);
+			clear_live(*edge);
 
 			if (WATCHED_ABOVE(e)) kfb.push(e->begin);
 
@@ -1344,6 +1364,7 @@ bool MDDProp<U>::propagate() {
 			const int begin = e->begin;
 
 			trailChange(e->kill_flags, count | 2);
+			clear_live(*edge);
 
 			trailChange(nodes[begin].count_out, nodes[begin].count_out - 1);
 			if ((nodes[begin].count_out == 0) && (nodes[begin].count_in != 0)) {
@@ -1352,12 +1373,9 @@ bool MDDProp<U>::propagate() {
 			}
 
 			const Value val = e->val;
-			val_entry& valent(VAL(val));
-			//            (valent.supp_count)--;
-			trailChange(valent.supp_count, valent.supp_count - 1);
-			if ((valent.supp_count) == 0) {
-				inferences.push(val);
-				val_entries[val].val_lim = count >> 3;
+			if (touched_stamp[val] != prop_stamp) {
+				touched_stamp[val] = prop_stamp;
+				touched_vals.push(val);
 			}
 		}
 
@@ -1439,6 +1457,15 @@ bool MDDProp<U>::propagate() {
 		}
 	}
 #else
+	// A value that lost edges is still supported iff any of its edges is alive.
+	for (int i = 0; i < touched_vals.size(); i++) {
+		const int val = touched_vals[i];
+		if (!has_live_edge(val)) {
+			inferences.push(val);
+			val_entries[val].val_lim = count;
+		}
+	}
+
 	for (int i = 1; i < inferences.size(); i++) {
 		const int val = inferences[i];
 		int j;
@@ -1492,6 +1519,7 @@ void MDDProp<U>::kill_dom(unsigned int lim, inc_edge* e, vec<int>& kfa, vec<int>
 	}
 
 	trailChange(e->kill_flags, lim | 4);
+	clear_live(e - edges);
 
 #ifdef USE_WATCHES
 	if (WATCHED_ABOVE(e)) kfb.push(e->begin);
@@ -1514,6 +1542,31 @@ void MDDProp<U>::kill_dom(unsigned int lim, inc_edge* e, vec<int>& kfa, vec<int>
 #endif
 }
 
+template <int U>
+bool MDDProp<U>::has_live_edge(Value v) {
+	const int lo = val_entries[v].first_off;
+	const int hi = lo + val_entries[v].count;
+	if (lo == hi) {
+		return false;
+	}
+	const int wlo = lo >> 6;
+	const int whi = (hi - 1) >> 6;
+	const uint64_t lo_mask = ~(uint64_t)0 << (lo & 63);
+	const uint64_t hi_mask = (hi & 63) != 0 ? ((uint64_t)1 << (hi & 63)) - 1 : ~(uint64_t)0;
+	if (wlo == whi) {
+		return (live_edges[wlo] & lo_mask & hi_mask) != 0;
+	}
+	if ((live_edges[wlo] & lo_mask) != 0 || (live_edges[whi] & hi_mask) != 0) {
+		return true;
+	}
+	for (int w = wlo + 1; w < whi; w++) {
+		if (live_edges[w] != 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
 MDDTemplate::MDDTemplate(MDDTable& tab, MDDNodeInt root, vec<int>& domain_sizes) {
 	//    tab.print_mdd(root);
 
@@ -1679,6 +1732,30 @@ void MDDCompile(MDDTable& t, MDDNodeInt root, vec<int>& domain_sizes, vec<val_en
 		qindex++;
 	}
 
+	// Renumber the edges so that those of each value form a contiguous range of
+	// ids; val_edges is then the identity, and the propagator can scan the edges
+	// of a value a word at a time in its bitset of live edges.
+	vec<int> edge_id(edge_arr.size());
+	vec<inc_edge> sorted_edges;
+	for (int i = 0; i < val_edges_sep.size(); i++) {
+		for (int j = 0; j < val_edges_sep[i].size(); j++) {
+			const int e = val_edges_sep[i][j];
+			edge_id[e] = sorted_edges.size();
+			sorted_edges.push(edge_arr[e]);
+			val_edges_sep[i][j] = edge_id[e];
+		}
+	}
+	assert(sorted_edges.size() == edge_arr.size());
+	sorted_edges.moveTo(edge_arr);
+	for (int i = 0; i < node_in_edges.size(); i++) {
+		for (int j = 0; j < node_in_edges[i].size(); j++) {
+			node_in_edges[i][j] = edge_id[node_in_edges[i][j]];
+		}
+		for (int j = 0; j < node_out_edges[i].size(); j++) {
+			node_out_edges[i][j] = edge_id[node_out_edges[i][j]];
+		}
+	}
+
 	for (int i = 0; i < val_edges_sep.size(); i++) {
 		val_entries[i].first_off = val_edges.size();     // Start
 		val_entries[i].count = val_edges_sep[i].size();  // Edge count
@@ -9,6 +9,7 @@
 #include "chuffed/vars/int-view.h"
 
 #include <climits>
+#include <cstdint>
 #include <utility>
 
 #ifdef FULLPROP
@@ -20,7 +21,7 @@
 // edges[val_edges[val_entries[(val)].first_off]].kill_flags)
 #define VAL_DEAD(val) (edges[val_edges[val_entries[(val)].first_off]].kill_flags)
 #else
-#define VAL_DEAD(val) (val_entries[(val)].supp_count == 0)
+#define VAL_DEAD(val) (!has_live_edge(val))
 #endif
 
 using Value = int;
@@ -174,6 +175,18 @@ private:
 	void clear_val(Value v);
 	void kill_dom(unsigned int /*lim*/, inc_edge* e, vec<int>& kfa, vec<int>& kfb);
 
+	// Clears the bit of a killed edge; a word goes on the trail at most once per
+	// propagation.
+	void clear_live(int e) {
+		const int w = e >> 6;
+		if (live_stamp[w] != prop_stamp) {
+			trailSave(live_edges[w]);
+			live_stamp[w] = prop_stamp;
+		}
+		live_edges[w] &= ~((uint64_t)1 << (e & 63));
+	}
+	bool has_live_edge(Value v);
+
 	// Parameters
 	MDDOpts opts;
 
@@ -184,11 +197,21 @@ private:
 	vec<val_entry> val_entries;
 	vec<inc_node> nodes;
 
-	vec<int> val_edges;
-	vec<int> node_edges;
+	// Shared with the template, and with the other propagators built from it
+	vec<int>& val_edges;
+	vec<int>& node_edges;
 
 	vec<inc_edge> edges;
 
+	// Bit e is set iff edge e is alive. The edges of a value have contiguous ids,
+	// so its support is a masked test over a few words.
+	vec<uint64_t> live_edges;
+	vec<long long> live_stamp;
+	long long prop_stamp{0};
+	// Values that lost an edge in the current propagation
+	vec<int> touched_vals;
+	vec<long long> touched_stamp;
+
 	double act_decay;
 	double act_inc{1};
 	vec<double> activity;
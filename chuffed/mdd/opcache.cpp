@@ -1,5 +1,6 @@
 #include "chuffed/mdd/opcache.h"
 
+#include <algorithm>
 #include <climits>
 #include <cstdint>
 #include <cstdlib>
@@ -7,19 +8,40 @@
 #include <thirdparty/MurmurHash3/MurmurHash3.h>
 
 #define USE_MURMURHASH
+#define CACHE_LINE 64
+#define EMPTY_OP 0xFF
 
-OpCache::OpCache(unsigned int sz)
-		: tablesz(sz),
+OpCache::Stats OpCache::totals = {0, 0, 0, 0, 0};
 
-			indices((unsigned int*)malloc(sizeof(unsigned int) * sz)),
-			entries((cache_entry*)malloc(sizeof(cache_entry) * sz)) {
-	//    collisions = 0;
+OpCache::OpCache(unsigned int sz, size_t _max_bytes) : max_bytes(_max_bytes) {
+	unsigned int nb = 1;
+	while (nb * BUCKET_SZ < sz && (size_t)2 * nb * sizeof(bucket) <= max_bytes) {
+		nb *= 2;
+	}
+	allocate(nb);
 }
 
 OpCache::~OpCache() {
-	free(indices);
-	free(entries);
-	//    std::cout << members << ", " << collisions << std::endl;
+	free(mem);
+	totals.hits += stats.hits;
+	totals.misses += stats.misses;
+	totals.evictions += stats.evictions;
+	totals.resizes += stats.resizes;
+	totals.peak_bytes = std::max(totals.peak_bytes, stats.peak_bytes);
+}
+
+// Buckets are aligned on cache lines, so that a lookup touches only one
+void OpCache::allocate(unsigned int nb) {
+	nbuckets = nb;
+	mem = malloc(nb * sizeof(bucket) + CACHE_LINE);
+	buckets = (bucket*)(((uintptr_t)mem + CACHE_LINE - 1) & ~(uintptr_t)(CACHE_LINE - 1));
+	for (unsigned int i = 0; i < nb; i++) {
+		for (int j = 0; j < BUCKET_SZ; j++) {
+			buckets[i].entries[j].op = EMPTY_OP;
+		}
+	}
+	members = 0;
+	stats.peak_bytes = std::max(stats.peak_bytes, nb * sizeof(bucket));
 }
 
 struct cache_sig {
@@ -36,45 +58,99 @@ inline unsigned int OpCache::hash(char op, unsigned int a, unsigned int b) const
 	hash = ((hash << 5) + hash) + a;
 	hash = ((hash << 5) + hash) + b;
 
-	return (hash & 0x7FFFFFFF) % tablesz;
+	return hash & (nbuckets - 1);
 #else
 	uint32_t ret;
 	cache_sig sig = {(unsigned int)op, a, b};
 	MurmurHash3_x86_32(&sig, sizeof(cache_sig), 5381, &ret);
-	return ret % tablesz;
+	return ret & (nbuckets - 1);
 #endif
 }
 
 // Returns UINT_MAX on failure.
 unsigned int OpCache::check(char op, unsigned int a, unsigned int b) {
-	const unsigned int hval = hash(op, a, b);
-	const unsigned int index = indices[hval];
-
-	if (index < members && entries[index].hash == hval) {
-		// Something is in the table.
-		if (entries[index].op == op && entries[index].a == a && entries[index].b == b) {
-			return entries[index].res;
+	bucket& bk = buckets[hash(op, a, b)];
+	for (cache_entry& e : bk.entries) {
+		if (e.op == (unsigned char)op && e.a == a && e.b == b) {
+			e.ref = 1;
+			stats.hits++;
+			return e.res;
 		}
 	}
+	stats.misses++;
 	return UINT_MAX;
 }
 
 void OpCache::insert(char op, unsigned int a, unsigned int b, unsigned int res) {
-	const unsigned int hval = hash(op, a, b);
-	unsigned int index = indices[hval];
+	if (place(op, a, b, res)) {
+		return;
+	}
+	if (2 * members >= nbuckets * BUCKET_SZ && 2 * nbuckets * sizeof(bucket) <= max_bytes) {
+		grow();
+		if (place(op, a, b, res)) {
+			return;
+		}
+	}
+
+	// Second chance: the first entry not used since the hand last passed goes
+	bucket& bk = buckets[hash(op, a, b)];
+	int victim = -1;
+	for (int k = 0; k < 2 * BUCKET_SZ && victim == -1; k++) {
+		cache_entry& e = bk.entries[(hand + k) % BUCKET_SZ];
+		if (e.ref != 0) {
+			e.ref = 0;
+		} else {
+			victim = (hand + k) % BUCKET_SZ;
+		}
+	}
+	hand = (victim + 1) % BUCKET_SZ;
+	stats.evictions++;
+	cache_entry& e = bk.entries[victim];
+	e.op = (unsigned char)op;
+	e.a = a;
+	e.b = b;
+	e.res = res;
+	e.ref = 0;
+}
+
+// Stores the entry in its bucket if it is already there or a slot is free
+bool OpCache::place(char op, unsigned int a, unsigned int b, unsigned int res) {
+	bucket& bk = buckets[hash(op, a, b)];
+	cache_entry* slot = nullptr;
+	for (cache_entry& e : bk.entries) {
+		if (e.op == (unsigned char)op && e.a == a && e.b == b) {
+			e.res = res;
+			return true;
+		}
+		if (e.op == EMPTY_OP && slot == nullptr) {
+			slot = &e;
+		}
+	}
+	if (slot == nullptr) {
+		return false;
+	}
+	slot->op = (unsigned char)op;
+	slot->a = a;
+	slot->b = b;
+	slot->res = res;
+	slot->ref = 0;
+	members++;
+	return true;
+}
 
-	if (index >= members || entries[index].hash != hval) {
-		index = members;
-		indices[hval] = index;
-		members++;
+// Doubles the table. Entries that do not fit in their new bucket are dropped.
+void OpCache::grow() {
+	void* old_mem = mem;
+	bucket* old_buckets = buckets;
+	const unsigned int old_nb = nbuckets;
+	allocate(2 * old_nb);
+	for (unsigned int i = 0; i < old_nb; i++) {
+		for (const cache_entry& e : old_buckets[i].entries) {
+			if (e.op != EMPTY_OP) {
+				place((char)e.op, e.a, e.b, e.res);
+			}
+		}
 	}
-	//   else {
-	//      collisions++;
-	//   }
-
-	entries[index].hash = hval;
-	entries[index].op = op;
-	entries[index].a = a;
-	entries[index].b = b;
-	entries[index].res = res;
+	free(old_mem);
+	stats.resizes++;
 }
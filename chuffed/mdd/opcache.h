@@ -1,30 +1,59 @@
 #ifndef OPCACHE_H_
 #define OPCACHE_H_
 
+#include <cstddef>
+
+// Cache of the results of MDD operations, open-addressed with buckets of one
+// cache line. The table doubles when a bucket overflows while it is at least
+// half full, as long as it stays within max_bytes; past that, an entry of the
+// bucket is replaced, by the clock (second chance) policy.
 class OpCache {
 public:
-	OpCache(unsigned int sz);
+	OpCache(unsigned int sz, size_t max_bytes = (size_t)1 << 25);
 	~OpCache();
+	OpCache(const OpCache&) = delete;
+	OpCache& operator=(const OpCache&) = delete;
 
 	unsigned int check(char op, unsigned int a, unsigned int b);  // Returns UINT_MAX on failure.
 	void insert(char op, unsigned int a, unsigned int b, unsigned int res);
 
+	struct Stats {
+		long long hits;
+		long long misses;
+		long long evictions;
+		long long resizes;
+		size_t peak_bytes;
+	};
+	// Summed over the caches destroyed so far
+	static Stats totals;
+
+private:
+	static const int BUCKET_SZ = 4;
+
 	struct cache_entry {
-		unsigned int hash;
-		char op;
 		unsigned int a;
 		unsigned int b;
 		unsigned int res;
+		unsigned char op;   // EMPTY_OP if the slot is free
+		unsigned char ref;  // set when used, cleared when the clock hand passes
 	};
 
-private:
-	inline unsigned int hash(char op, unsigned int a, unsigned int b) const;
+	struct bucket {
+		cache_entry entries[BUCKET_SZ];
+	};
 
-	// Implemented with sparse-array stuff.
-	unsigned int tablesz;
+	inline unsigned int hash(char op, unsigned int a, unsigned int b) const;
+	void allocate(unsigned int nb);
+	bool place(char op, unsigned int a, unsigned int b, unsigned int res);
+	void grow();
 
+	size_t max_bytes;
+	unsigned int nbuckets{0};  // a power of 2
 	unsigned int members{0};
-	unsigned int* indices;
-	cache_entry* entries;
+	unsigned int hand{0};
+	void* mem{nullptr};
+	bucket* buckets{nullptr};
+
+	Stats stats{0, 0, 0, 0, 0};
 };
 #endif
@@ -7,10 +7,12 @@
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <map>
+#include <vector>
 
 #include <thirdparty/MurmurHash3/MurmurHash3.h>
 
-#define OPCACHE_SZ 100000
+#define OPCACHE_SZ 4096  // initial size, the cache grows as needed
 
 const int EVLayerGraph::EVFalse = (-1);
 const int EVLayerGraph::EVTrue = (0);
@@ -21,7 +23,7 @@ struct edge_leq {
 			return e1.val < e2.val;
 		}
 
-		if (e1.dest == e2.dest) {
+		if (e1.dest != e2.dest) {
 			return e1.dest < e2.dest;
 		}
 
@@ -29,7 +31,7 @@ struct edge_leq {
 	}
 } edge_leq;
 
-EVLayerGraph::EVLayerGraph() : opcache(OpCache(OPCACHE_SZ)) {
+EVLayerGraph::EVLayerGraph() : opcache(OPCACHE_SZ) {
 	// Initialize \ttt
 	nodes.push_back(nullptr);  // true node
 	const TravInfo tinfo = {0, -1, 1};
@@ -45,7 +47,7 @@ EVLayerGraph::~EVLayerGraph() {
 	}
 }
 
-EVLayerGraph::NodeID EVLayerGraph::insert(int level, vec<EInfo>& edges) {
+EVLayerGraph::NodeID EVLayerGraph::insert(int level, vec<EInfo>& edges, int* offset) {
 	// Ensure there's adequate space in the intermed node.
 	if (intermed_maxsz < edges.size()) {
 		while (intermed_maxsz < edges.size()) {
@@ -84,6 +86,20 @@ EVLayerGraph::NodeID EVLayerGraph::insert(int level, vec<EInfo>& edges) {
 		return EVFalse;
 	}
 
+	// Normalise the weights so that the cheapest edge costs 0. Nodes whose
+	// weights differ by a constant are then shared, the difference moving to
+	// the edges into them.
+	if (offset != nullptr) {
+		int minW = intermed->edges[0].weight;
+		for (int ei = 1; ei < jj; ei++) {
+			minW = std::min(minW, intermed->edges[ei].weight);
+		}
+		for (int ei = 0; ei < jj; ei++) {
+			intermed->edges[ei].weight -= minW;
+		}
+		*offset = minW;
+	}
+
 	intermed->var = level;
 	intermed->sz = jj;
 
@@ -157,8 +173,9 @@ EVLayerGraph::NodeRef EVLayerGraph::allocNode(int sz) {
 inline void EVLayerGraph::deallocNode(EVLayerGraph::NodeRef node) { free(node); }
 
 inline void create_edges(EVLayerGraph& /*graph*/, vec<EVLayerGraph::EInfo>& edges,
-												 const vec<EVLayerGraph::NodeID>& previous_layer, const WDFATrans* T,
-												 int dom, int /*nstates*/, int soff) {
+												 const vec<EVLayerGraph::NodeID>& previous_layer,
+												 const vec<int>& previous_offset, const WDFATrans* T, int dom,
+												 int /*nstates*/, int soff) {
 	edges.clear();
 	for (int xi = 0; xi < dom; xi++) {
 		const int tidx = soff + xi;
@@ -169,22 +186,121 @@ inline void create_edges(EVLayerGraph& /*graph*/, vec<EVLayerGraph::EInfo>& edge
 			destination--;
 			const EVLayerGraph::NodeID dest = previous_layer[destination];
 			if (dest != EVLayerGraph::EVFalse) {
-				const EVLayerGraph::EInfo edge = {xi + 1, trans.weight, previous_layer[destination]};
+				const EVLayerGraph::EInfo edge = {xi + 1, trans.weight + previous_offset[destination],
+																					previous_layer[destination]};
 				edges.push(edge);
 			}
 		}
 	}
 }
 
-EVLayerGraph::NodeID wdfa_to_layergraph(EVLayerGraph& graph, int nvars, int dom, WDFATrans* T,
-																				int nstates, int q0, vec<int>& accepts) {
+// Minimises the weighted DFA by partition refinement (Moore's algorithm): two
+// states are merged when they are both accepting or both not, and for every
+// value they move at the same weight to merged states. Unreachable states are
+// dropped, and the states are renumbered from 1 in the order they are reached
+// from q0.
+static void minimise_wdfa(const WDFATrans* T, int nstates, int dom, int q0, vec<int>& accepts,
+													vec<WDFATrans>& minT, int& min_nstates, int& min_q0,
+													vec<int>& min_accepts) {
+	// Reachable states, in breadth-first order.
+	vec<int> order;
+	std::vector<int> cls(nstates, -1);
+	order.push(q0 - 1);
+	cls[q0 - 1] = 0;
+	for (int qi = 0; qi < order.size(); qi++) {
+		const int si = order[qi];
+		for (int xi = 0; xi < dom; xi++) {
+			const int dest = T[si * dom + xi].dest - 1;
+			if (dest >= 0 && cls[dest] == -1) {
+				cls[dest] = 0;
+				order.push(dest);
+			}
+		}
+	}
+	for (int ai = 0; ai < accepts.size(); ai++) {
+		if (cls[accepts[ai] - 1] != -1) {
+			cls[accepts[ai] - 1] = 1;
+		}
+	}
+
+	// Refine until the number of classes is stable. Classes are numbered by
+	// the first state in order, so the result doesn't depend on the hashing.
+	int nclasses = 0;
+	std::vector<int> next(nstates, -1);
+	std::map<std::vector<int>, int> sigs;
+	std::vector<int> sig;
+	while (true) {
+		sigs.clear();
+		for (int qi = 0; qi < order.size(); qi++) {
+			const int si = order[qi];
+			sig.clear();
+			sig.push_back(cls[si]);
+			for (int xi = 0; xi < dom; xi++) {
+				const WDFATrans& trans(T[si * dom + xi]);
+				sig.push_back(trans.dest > 0 ? cls[trans.dest - 1] : -1);
+				sig.push_back(trans.dest > 0 ? trans.weight : 0);
+			}
+			auto res = sigs.insert(std::make_pair(sig, (int)sigs.size()));
+			next[si] = res.first->second;
+		}
+		const bool stable = ((int)sigs.size() == nclasses);
+		nclasses = sigs.size();
+		cls.swap(next);
+		if (stable) {
+			break;
+		}
+	}
+
+	min_nstates = nclasses;
+	min_q0 = cls[q0 - 1] + 1;
+	minT.clear();
+	minT.growTo(nclasses * dom);
+	std::vector<bool> done(nclasses, false);
+	for (int qi = 0; qi < order.size(); qi++) {
+		const int si = order[qi];
+		const int c = cls[si];
+		if (done[c]) {
+			continue;
+		}
+		done[c] = true;
+		for (int xi = 0; xi < dom; xi++) {
+			const WDFATrans& trans(T[si * dom + xi]);
+			const WDFATrans mtrans = {trans.dest > 0 ? trans.weight : 0,
+																trans.dest > 0 ? cls[trans.dest - 1] + 1 : 0};
+			minT[c * dom + xi] = mtrans;
+		}
+	}
+	min_accepts.clear();
+	for (int ai = 0; ai < accepts.size(); ai++) {
+		const int si = accepts[ai] - 1;
+		if (cls[si] != -1 && done[cls[si]]) {
+			done[cls[si]] = false;
+			min_accepts.push(cls[si] + 1);
+		}
+	}
+}
+
+// Unrolls the weighted DFA into layers, bottom-up. Each node is normalised
+// (see EVLayerGraph::insert), so states with the same suffixes up to a
+// constant shift share a node; the root keeps its weights.
+EVLayerGraph::NodeID wdfa_to_layergraph(EVLayerGraph& graph, int nvars, int dom, WDFATrans* T0,
+																				int nstates0, int q00, vec<int>& accepts0) {
+	vec<WDFATrans> minT;
+	int nstates;
+	int q0;
+	vec<int> accepts;
+	minimise_wdfa(T0, nstates0, dom, q00, accepts0, minT, nstates, q0, accepts);
+	const WDFATrans* T = (WDFATrans*)minT;
+
 	vec<EVLayerGraph::NodeID> layers[2];
+	vec<int> offsets[2];
 	int curr = 0;
 	int prev = 1;
 
 	// At the bottom level, only accept states can reach T
 	for (int si = 0; si < nstates; si++) {
 		layers[curr].push(EVLayerGraph::EVFalse);
+		offsets[curr].push(0);
 	}
 
 	for (int ai = 0; ai < accepts.size(); ai++) {
@@ -198,17 +314,20 @@ EVLayerGraph::NodeID wdfa_to_layergraph(EVLayerGraph& graph, int nvars, int dom,
 		curr = 1 - curr;
 		prev = 1 - prev;
 		layers[curr].clear();
+		offsets[curr].clear();
 
 		for (int si = 0; si < nstates; si++) {
 			const int soff = si * dom;
-			create_edges(graph, edges, layers[prev], T, dom, nstates, soff);
-			layers[curr].push(graph.insert(vv, edges));
+			create_edges(graph, edges, layers[prev], offsets[prev], T, dom, nstates, soff);
+			int offset = 0;
+			layers[curr].push(graph.insert(vv, edges, &offset));
+			offsets[curr].push(offset);
 		}
 	}
 
 	const int soff = (q0 - 1) * dom;
 	prev = 1 - prev;
-	create_edges(graph, edges, layers[prev], T, dom, nstates, soff);
+	create_edges(graph, edges, layers[prev], offsets[prev], T, dom, nstates, soff);
 	const int root = graph.insert(0, edges);
 	return root;
 }
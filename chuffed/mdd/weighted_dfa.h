@@ -17,10 +17,10 @@
 // Similarly, it does not ensure that the levels are
 // increasing.
 
-// TODO: Add a normalization step, so that:
-// x1: [0, 3 -> y]
-// x2: [0, 2 -> y]
-// are mapped to the same node.
+// Nodes may be normalised on insertion, so that
+// x1: [1 -> y (weight 2), 2 -> z (weight 5)]
+// x1: [1 -> y (weight 0), 2 -> z (weight 3)]
+// are mapped to the same node, the offset of 2 moving to the edges into it.
 class EVLayerGraph;
 
 class EVEdge;
@@ -122,7 +122,9 @@ public:
 	EVLayerGraph();  // Do we need the number of variables as a parameter?
 	~EVLayerGraph();
 
-	NodeID insert(int level, vec<EInfo>& edges);
+	// If offset is given, the node is normalised, and the weight taken off its
+	// edges is stored there.
+	NodeID insert(int level, vec<EInfo>& edges, int* offset = nullptr);
 
 	// Initialize the traversal info stuff.
 	// Returns the size of the computed subgraph.
@@ -159,8 +161,9 @@ struct WDFATrans {
 };
 
 inline void create_edges(EVLayerGraph& graph, vec<EVLayerGraph::EInfo>& edges,
-												 const vec<EVLayerGraph::NodeID>& previous_layer, const WDFATrans* T,
-												 int dom, int nstates, int soff);
+												 const vec<EVLayerGraph::NodeID>& previous_layer,
+												 const vec<int>& previous_offset, const WDFATrans* T, int dom,
+												 int nstates, int soff);
 EVLayerGraph::NodeID wdfa_to_layergraph(EVLayerGraph& graph, int nvars, int dom, WDFATrans* T,
 																				int nstates, int q0, vec<int>& accepts);
 
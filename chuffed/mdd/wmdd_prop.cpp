@@ -461,20 +461,21 @@ void WMDDProp::incPropDown(vec<int>& clear_queue, int maxC, vec<int>& valQ) {
 				break;
 			}
 
+			// Edges already dead still count towards the path lengths until their
+			// value is removed (the values we infer come back this way).
 			DisjRef es(vals[vv].edges);
 			for (int ei = 0; ei < es->sz; ei++) {
 				const int eid = es->edges[ei];
 				assert(eid < edges.size());
-				if (dead_edges.elem(eid)) {
-					continue;
+				if (!dead_edges.elem(eid)) {
+					dead_edges.insert(eid);
 				}
-
-				dead_edges.insert(eid);
 				Edge& e(edges[eid]);
 				e.kill_flags |= EDGE_PROC;
 
-				// Enqueue e.end if the loss of e might change the shortest path.
-				if (nodes[e.end].status == 0) {
+				// Enqueue e.end only if e was one of its shortest in-edges; otherwise
+				// the loss of e can't change c(r -> e.end).
+				if (nodes[e.end].status == 0 && in_tight(e, nodes[e.begin].in_pathC)) {
 					nodes[e.end].status = 1;
 					downQ.push(e.end);
 				}
@@ -535,7 +536,7 @@ void WMDDProp::incPropDown(vec<int>& clear_queue, int maxC, vec<int>& valQ) {
 
 					const Edge& e(edges[eid]);
 
-					if (nodes[e.end].status == 0) {
+					if (nodes[e.end].status == 0 && in_tight(e, oldC)) {
 						nodes[e.end].status = 1;
 						downQ.push(e.end);
 					}
@@ -558,7 +559,7 @@ void WMDDProp::incPropDown(vec<int>& clear_queue, int maxC, vec<int>& valQ) {
 						}
 					}
 
-					if (nodes[e.end].status == 0) {
+					if (nodes[e.end].status == 0 && in_tight(e, oldC)) {
 						nodes[e.end].status = 1;
 						downQ.push(e.end);
 					}
@@ -599,10 +600,8 @@ void WMDDProp::incPropUp(vec<int>& clear_queue, int maxC, vec<int>& valQ) {
 				}
 				e.kill_flags &= (~EDGE_PROC);
 
-				// Enqueue e.begin if the loss of e might change the shortest path.
-				// FIXME: This actually needs to be the value of pathC
-				//        before propagation started, not at the current time.
-				if (nodes[e.begin].status == 0) {
+				// Enqueue e.begin only if e was one of its shortest out-edges.
+				if (nodes[e.begin].status == 0 && out_tight(e, nodes[e.end].out_pathC)) {
 					assert(e.begin < nodes.size());
 					nodes[e.begin].status = 1;
 					upQ.push(e.begin);
@@ -664,7 +663,7 @@ void WMDDProp::incPropUp(vec<int>& clear_queue, int maxC, vec<int>& valQ) {
 					}
 
 					const Edge& e(edges[eid]);
-					if (nodes[e.begin].status == 0) {
+					if (nodes[e.begin].status == 0 && out_tight(e, oldC)) {
 						assert(e.begin < nodes.size());
 						nodes[e.begin].status = 1;
 						upQ.push(e.begin);
@@ -688,7 +687,7 @@ void WMDDProp::incPropUp(vec<int>& clear_queue, int maxC, vec<int>& valQ) {
 						}
 					}
 
-					if (nodes[e.begin].status == 0) {
+					if (nodes[e.begin].status == 0 && out_tight(e, oldC)) {
 						assert(e.begin < nodes.size());
 						nodes[e.begin].status = 1;
 						upQ.push(e.begin);
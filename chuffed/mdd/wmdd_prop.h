@@ -136,6 +136,16 @@ public:
 		return nodes[e.begin].in_pathC + e.weight + nodes[e.end].out_pathC;
 	}
 
+	// Whether e, leaving a node at distance beginC from r, is a shortest in-edge
+	// of e.end. Only the loss of such an edge can lengthen c(r -> e.end).
+	inline bool in_tight(const Edge& e, int beginC) {
+		return beginC != INT_MAX && beginC + e.weight == nodes[e.end].in_pathC;
+	}
+	// Likewise for e.begin, with e entering a node at distance endC from T.
+	inline bool out_tight(const Edge& e, int endC) {
+		return endC != INT_MAX && endC + e.weight == nodes[e.begin].out_pathC;
+	}
+
 	inline void kill_edge(int eid, KillCause cause) {
 		assert(!dead_edges.elem(eid));
 		edges[eid].kill_flags = cause;
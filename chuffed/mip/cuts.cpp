@@ -0,0 +1,415 @@
+#include "chuffed/core/engine.h"
+#include "chuffed/core/options.h"
+#include "chuffed/core/sat-types.h"
+#include "chuffed/core/sat.h"
+#include "chuffed/mip/mip.h"
+#include "chuffed/mip/simplex.h"
+#include "chuffed/support/vec.h"
+#include "chuffed/vars/int-var.h"
+#include "chuffed/vars/vars.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#define CUT_ROUNDS 5
+#define MAX_ROUND_CUTS 100
+#define CUT_VIOLATION 1e-3
+#define FRAC_MIN 0.01
+#define CG_DENOM (1 << 20)  // CG multipliers are multiples of 1 / CG_DENOM
+#define CG_SNAP 1000         // coefficients this close to an integer are snapped
+#define MAX_CG_SUM 1e12      // keeps the scaled sums of CG cuts within 64 bits
+#define MAX_CUT_BOUND 1e6    // vars with larger bounds are left out of CG cuts
+#define MAX_CUT_COEFF 1e6
+#define MAX_CLIQUE_STARTS 1000
+#define MAX_CUT_DENSITY 0.1  // dense cuts would slow down every pivot of the search
+
+// Cuts are added to the root LP as new rows, so every cut must hold for all
+// the integer solutions within the root bounds. To keep this exact, cuts have
+// integer coefficients and are derived with integer arithmetic only.
+
+static long long floorDiv(long long a, long long b) {
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static long long ceilDiv(long long a, long long b) { return -floorDiv(-a, b); }
+
+static bool isBinary(int v) { return simplex.lb[v] == 0 && simplex.ub[v] == 1; }
+
+// Separates cuts violated by the root LP optimum for a few rounds, the rows
+// being rebuilt from the previous optimal basis after each round
+void MIP::presolve() {
+	vec<long double> x(vars.size());
+	for (int round = 0; round < CUT_ROUNDS; round++) {
+		if (!solveRootLP(x)) {
+			return;
+		}
+		const int old_m = ineqs.size();
+		int found = separateGomory(x);
+		found += separateCovers(x);
+		found += separateCliques(x);
+		if (so.verbosity >= 2) {
+			fprintf(stderr, "cut round %d: LP bound %.3Lf, %d cuts\n", round, simplex.optimum(), found);
+		}
+		if (found == 0) {
+			return;
+		}
+
+		// The old basis stays dual feasible with the slacks of the cuts basic
+		const int n = vars.size();
+		SimplexState s;
+		simplex.saveState(s);
+		simplex.init();
+		SimplexState t;
+		t.basic = new int[n + ineqs.size()];
+		t.shift = new int[n + ineqs.size()];
+		t.simplexs = simplex.simplexs;
+		for (int i = 0; i < n + old_m; i++) {
+			t.basic[i] = s.basic[i];
+			t.shift[i] = s.shift[i];
+		}
+		for (int i = n + old_m; i < n + ineqs.size(); i++) {
+			t.basic[i] = 1;
+			t.shift[i] = 0;
+		}
+		simplex.loadState(t);
+		delete[] s.basic;
+		delete[] s.shift;
+		delete[] t.basic;
+		delete[] t.shift;
+	}
+}
+
+// Solves the root LP, and gets the values of the vars at the optimum
+bool MIP::solveRootLP(vec<long double>& x) {
+	int r = SIMPLEX_IN_PROGRESS;
+	const int limit = getLimit();
+	for (int steps = 0; steps < limit && r == SIMPLEX_IN_PROGRESS; steps++) {
+		r = simplex.simplex();
+	}
+	if (r == SIMPLEX_UNBOUNDED) {
+		// The first propagation will fail again, with the usual explanation
+		sat.confl = nullptr;
+	}
+	if (r != SIMPLEX_OPTIMAL) {
+		return false;
+	}
+	simplex.calcObjBound();
+	simplex.calcRHS();
+	for (int j = 0; j < vars.size(); j++) {
+		const int bound = simplex.shift[j] != 0 ? simplex.ub[j] : simplex.lb[j];
+		x[j] = bound + (simplex.ctor[j] >= 0 ? simplex.rhs[simplex.ctor[j]] : 0);
+	}
+	return true;
+}
+
+// Adds sum a[j] * x[j] <= rhs if it is violated by the LP optimum x, and
+// clears a
+bool MIP::addCut(vec<long long>& a, long long rhs, const vec<long double>& x) {
+	vec<int> ca;
+	vec<IntVar*> cx;
+	long double lhs = 0;
+	std::vector<long long> key;
+	bool ok = true;
+	for (int j = 1; j < a.size(); j++) {
+		if (a[j] == 0) {
+			continue;
+		}
+		if (std::llabs(a[j]) > MAX_CUT_COEFF) {
+			ok = false;
+		}
+		lhs += a[j] * x[j];
+		ca.push((int)a[j]);
+		cx.push(vars[j]);
+		key.push_back(j);
+		key.push_back(a[j]);
+		a[j] = 0;
+	}
+	if (!ok || cx.size() == 0 || cx.size() > 10 + MAX_CUT_DENSITY * vars.size() ||
+			lhs <= rhs + CUT_VIOLATION || std::llabs(rhs) > INT_MAX / 2) {
+		return false;
+	}
+	key.push_back(rhs);
+	if (!cut_keys.insert(key).second) {
+		return false;
+	}
+	addConstraint(ca, cx, -1e100, rhs);
+	cuts++;
+	return true;
+}
+
+// Chvatal-Gomory cuts from the rows of the optimal tableau where a var has a
+// fractional value. The multipliers of the rows of the tableau are rounded to
+// multiples of 1 / CG_DENOM so that the cuts can be computed exactly, and the
+// vars are shifted to their bound at the optimum. The rounding leaves the
+// coefficients which should be integral (those of the basic vars) slightly
+// off, so these are snapped up to the integer, paying for it in the rhs.
+int MIP::separateGomory(const vec<long double>& x) {
+	const int n = simplex.n;
+	const int m = simplex.m;
+	vec<long double> lambda(m);
+	vec<long long> c(n, 0);
+	vec<long long> a(n, 0);
+	int found = 0;
+	for (int r = 0; r < m && found < MAX_ROUND_CUTS; r++) {
+		const int k = simplex.rtoc[r];
+		if (k == 0 || k >= n) {
+			continue;
+		}
+		const long double f = x[k] - floorl(x[k]);
+		if (f < FRAC_MIN || f > 1 - FRAC_MIN) {
+			continue;
+		}
+		simplex.calcBInvRow(&lambda[0], r);
+
+		// c.x <= d is the sum of the rows, each oriented so that its slack is at
+		// its bound, scaled by CG_DENOM
+		long long d = 0;
+		for (int i = 0; i < m; i++) {
+			if (simplex.ctor[n + i] >= 0) {
+				continue;
+			}
+			const int sigma = simplex.shift[n + i] != 0 ? -1 : 1;
+			const long double l = sigma * lambda[i];
+			const long long u = llroundl((l - floorl(l)) * CG_DENOM) % CG_DENOM;
+			if (u == 0) {
+				continue;
+			}
+			d += u * (sigma == 1 ? -(long long)simplex.lb[n + i] : (long long)simplex.ub[n + i]);
+			for (int j = 0; j < simplex.AH_nz[i]; j++) {
+				c[simplex.AH[i][j].index()] += sigma * u * llroundl(simplex.AH[i][j].val());
+			}
+		}
+
+		// The objective var has no bounds in the LP
+		bool ok = (c[0] == 0);
+		long long rhs_shift = 0;
+		for (int j = 1; j < n; j++) {
+			if (c[j] == 0) {
+				continue;
+			}
+			const long long lb = simplex.lb[j];
+			const long long ub = simplex.ub[j];
+			if (std::llabs(lb) > MAX_CUT_BOUND || std::llabs(ub) > MAX_CUT_BOUND ||
+					std::llabs(c[j]) > MAX_CG_SUM) {
+				ok = false;
+				c[j] = 0;
+				continue;
+			}
+			// K x' with x' = x - lb or x' = ub - x in [0, ub - lb]
+			const bool at_ub = simplex.ctor[j] < 0 && simplex.shift[j] != 0;
+			long long K = at_ub ? -c[j] : c[j];
+			d -= c[j] * (at_ub ? ub : lb);
+			const long long R = floorDiv(K + CG_DENOM / 2, CG_DENOM) * CG_DENOM;
+			if (K < R && R - K <= CG_DENOM / CG_SNAP) {
+				d += (R - K) * (ub - lb);
+				K = R;
+			}
+			const long long a_shifted = floorDiv(K, CG_DENOM);
+			a[j] = at_ub ? -a_shifted : a_shifted;
+			rhs_shift += a[j] * (at_ub ? ub : lb);
+			c[j] = 0;
+		}
+		c[0] = 0;
+		if (ok && addCut(a, floorDiv(d, CG_DENOM) + rhs_shift, x)) {
+			found++;
+		}
+		for (int j = 0; j < n; j++) {
+			a[j] = 0;
+		}
+	}
+	return found;
+}
+
+// Cover cuts from the rows over 0-1 vars: if the weights of the items of C
+// exceed the capacity, at most |C| - 1 of them can be taken. Vars with a
+// negative coefficient are complemented.
+int MIP::separateCovers(const vec<long double>& x) {
+	struct Item {
+		int v;
+		bool neg;
+		long long w;
+		long double y;
+	};
+	const int n = simplex.n;
+	std::vector<Item> items;
+	std::vector<Item> cover;
+	vec<long long> a(n, 0);
+	int found = 0;
+	for (int i = 0; i < simplex.m && found < MAX_ROUND_CUTS; i++) {
+		for (int side = 1; side >= -1; side -= 2) {
+			// side * AH[i] . x <= b
+			long long b = side == 1 ? -(long long)simplex.lb[n + i] : (long long)simplex.ub[n + i];
+			items.clear();
+			bool ok = true;
+			for (int j = 0; j < simplex.AH_nz[i] && ok; j++) {
+				const int v = simplex.AH[i][j].index();
+				const long long c = side * llroundl(simplex.AH[i][j].val());
+				if (v == 0) {
+					ok = false;
+				} else if (simplex.lb[v] == simplex.ub[v]) {
+					b -= c * simplex.lb[v];
+				} else if (!isBinary(v)) {
+					ok = false;
+				} else if (c > 0) {
+					items.push_back({v, false, c, x[v]});
+				} else if (c < 0) {
+					items.push_back({v, true, -c, 1 - x[v]});
+					b -= c;
+				}
+			}
+			if (!ok || b < 0) {
+				continue;
+			}
+
+			// Greedy cover, taking first the items the LP takes most of per unit of
+			// weight, then made minimal by dropping the items the LP takes least of
+			std::sort(items.begin(), items.end(), [](const Item& p, const Item& q) {
+				return (1 - p.y) * q.w < (1 - q.y) * p.w;
+			});
+			cover.clear();
+			long long weight = 0;
+			for (int j = 0; j < static_cast<int>(items.size()) && weight <= b; j++) {
+				cover.push_back(items[j]);
+				weight += items[j].w;
+			}
+			if (weight <= b) {
+				continue;
+			}
+			std::sort(cover.begin(), cover.end(),
+								[](const Item& p, const Item& q) { return p.y < q.y; });
+			for (int j = 0; j < static_cast<int>(cover.size());) {
+				if (weight - cover[j].w > b) {
+					weight -= cover[j].w;
+					cover.erase(cover.begin() + j);
+				} else {
+					j++;
+				}
+			}
+
+			long long rhs = static_cast<long long>(cover.size()) - 1;
+			for (const Item& it : cover) {
+				a[it.v] = it.neg ? -1 : 1;
+				rhs -= it.neg ? 1 : 0;
+			}
+			if (addCut(a, rhs, x)) {
+				found++;
+			}
+		}
+	}
+	return found;
+}
+
+// Clique cuts from the binary clauses between the literals of the 0-1 vars
+// with eager literals: node 2 * j stands for x_j = 1, and 2 * j + 1 for
+// x_j = 0. Literals equivalent to these through binary clauses (e.g. from
+// bool2int) are mapped to the same nodes.
+int MIP::separateCliques(const vec<long double>& x) {
+	const int n = simplex.n;
+	std::unordered_map<int, int> lit_node;
+	const auto implies = [](Lit p, Lit q) {
+		const vec<WatchElem>& ws = sat.watches[toInt(p)];
+		for (int i = 0; i < ws.size(); i++) {
+			if (ws[i].d.type == 1 && toLit(ws[i].d.d2) == q) {
+				return true;
+			}
+		}
+		return false;
+	};
+	for (int j = 1; j < n; j++) {
+		if (!isBinary(j) || vars[j]->getType() != INT_VAR_EL) {
+			continue;
+		}
+		const Lit p = vars[j]->getLit(1, LR_GE);
+		if (var(p) == 0) {
+			continue;
+		}
+		lit_node[toInt(p)] = 2 * j;
+		lit_node[toInt(~p)] = 2 * j + 1;
+		const vec<WatchElem>& ws = sat.watches[toInt(p)];
+		for (int i = 0; i < ws.size(); i++) {
+			const Lit q = toLit(ws[i].d.d2);
+			if (ws[i].d.type == 1 && implies(q, p)) {
+				lit_node.emplace(toInt(q), 2 * j);
+				lit_node.emplace(toInt(~q), 2 * j + 1);
+			}
+		}
+	}
+	if (lit_node.empty()) {
+		return 0;
+	}
+
+	// p -> q forbids p and ~q together
+	std::vector<std::vector<int> > adj(2 * n);
+	for (const auto& ln : lit_node) {
+		const vec<WatchElem>& ws = sat.watches[ln.first];
+		for (int i = 0; i < ws.size(); i++) {
+			if (ws[i].d.type != 1) {
+				continue;
+			}
+			auto it = lit_node.find(toInt(~toLit(ws[i].d.d2)));
+			if (it != lit_node.end() && it->second / 2 != ln.second / 2) {
+				adj[ln.second].push_back(it->second);
+				adj[it->second].push_back(ln.second);
+			}
+		}
+	}
+	const auto value = [&](int u) { return u % 2 == 0 ? x[u / 2] : 1 - x[u / 2]; };
+	std::vector<int> starts;
+	for (int u = 0; u < 2 * n; u++) {
+		std::sort(adj[u].begin(), adj[u].end());
+		adj[u].erase(std::unique(adj[u].begin(), adj[u].end()), adj[u].end());
+		if (!adj[u].empty() && value(u) > CUT_VIOLATION) {
+			starts.push_back(u);
+		}
+	}
+	std::sort(starts.begin(), starts.end(), [&](int u, int v) { return value(u) > value(v); });
+	if (starts.size() > MAX_CLIQUE_STARTS) {
+		starts.resize(MAX_CLIQUE_STARTS);
+	}
+
+	// Greedy cliques, grown by the nodes the LP takes most of
+	vec<long long> a(n, 0);
+	std::vector<int> cand;
+	std::vector<int> clique;
+	int found = 0;
+	for (const int s : starts) {
+		if (found >= MAX_ROUND_CUTS) {
+			break;
+		}
+		cand = adj[s];
+		std::sort(cand.begin(), cand.end(), [&](int u, int v) { return value(u) > value(v); });
+		clique.assign(1, s);
+		long double sum = value(s);
+		for (const int u : cand) {
+			bool all = true;
+			for (const int w : clique) {
+				if (!std::binary_search(adj[u].begin(), adj[u].end(), w)) {
+					all = false;
+					break;
+				}
+			}
+			if (all) {
+				clique.push_back(u);
+				sum += value(u);
+			}
+		}
+		if (sum <= 1 + CUT_VIOLATION) {
+			continue;
+		}
+		long long rhs = 1;
+		for (const int u : clique) {
+			a[u / 2] = u % 2 == 0 ? 1 : -1;
+			rhs -= u % 2;
+		}
+		if (addCut(a, rhs, x)) {
+			found++;
+		}
+	}
+	return found;
+}
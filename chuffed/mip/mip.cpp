@@ -11,6 +11,7 @@
 #include "chuffed/vars/int-view.h"
 #include "chuffed/vars/vars.h"
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <cmath>
@@ -26,6 +27,10 @@
 #define RAND_RC 1
 #define ULEVEL_LIMIT 3
 #define LLEVEL_LIMIT 3
+#define RESTORE_PIVOTS 1
+#define RELAX_EPS 1e-6
+#define NODE_PIVOTS 20
+#define MAX_PIVOT_BUDGET 2000
 
 MIP* mip;
 
@@ -91,6 +96,7 @@ void MIP::wakeup(int i, int /*c*/) {
 }
 
 bool MIP::propagate() {
+	trailed_cert_sz = false;
 	const time_point start = chuffed_clock::now();
 	//	printObjective();
 
@@ -132,7 +138,10 @@ void MIP::clearPropState() {
 //-----
 // Interface methods
 
-void MIP::newDecisionLevel() { bctrail_lim.push(bctrail.size()); }
+void MIP::newDecisionLevel() {
+	bctrail_lim.push(bctrail.size());
+	pivot_budget = std::min(pivot_budget + NODE_PIVOTS, (long long)MAX_PIVOT_BUDGET);
+}
 
 void MIP::btToLevel(int level) {
 	if (RESTORE_ROOT && level == 0) {
@@ -149,6 +158,17 @@ void MIP::btToLevel(int level) {
 	}
 	bctrail.resize(bctrail_lim[level]);
 	bctrail_lim.resize(level);
+	for (int i = level + 1; i < level_state.size(); i++) {
+		level_state[i].simplexs = -1;
+	}
+	// Going back to the basis that was optimal at this level is cheaper than
+	// pivoting back from the current one if many pivots were done since then
+	if (level < level_state.size() && level_state[level].simplexs >= 0 &&
+			simplex.simplexs - level_state[level].simplexs >= RESTORE_PIVOTS) {
+		simplex.loadState(level_state[level]);
+		level_state[level].simplexs = simplex.simplexs;
+		restores++;
+	}
 	if (level > 0) {
 		//		printf("reset level limit\n");
 		level_lb = level - LLEVEL_LIMIT;
@@ -192,17 +212,25 @@ bool MIP::propagateAllBounds() {
 	const bool rc = false;
 
 	ps.clear();
+	ps_cost.clear();
+	cert_start = -1;
 
+	// The LP bound holds given the bounds of the non-basic vars with a non-zero
+	// reduced cost. ps_cost is how much relaxing a bound back to its initial
+	// value would weaken the LP bound.
 	if (so.lazy) {
 		place[0] = 0;
 		ps.push(engine.opt_type == OPT_MIN ? vars[0]->getMaxLit() : vars[0]->getMinLit());
+		ps_cost.push(0);
 		for (int i = 1; i < vars.size(); i++) {
 			place[i] = ps.size();
 			if (RL[i] > 0) {
 				ps.push(vars[i]->getMinLit());
+				ps_cost.push(RL[i] * (vars[i]->getMin() - vars[i]->getMin0()));
 			}
 			if (RL[i] < 0) {
 				ps.push(vars[i]->getMaxLit());
+				ps_cost.push(-RL[i] * (vars[i]->getMax0() - vars[i]->getMax()));
 			}
 		}
 	}
@@ -261,20 +289,68 @@ bool MIP::propagateBound(int i, long double s) {
 	const int64_t max = v.getMin() + (int64_t)floor(s);
 	//	fprintf(stderr, "%.3Lf %lld %lld %lld\n", s, v.getMin(), v.getMax(), max);
 	if (v.setMaxNotR(max)) {
-		Clause* m_r = nullptr;
+		Reason r;
 		if (so.lazy) {
-			m_r = Clause_new(ps);
-			(*m_r)[place[i]] = (*m_r)[0];
-			m_r->temp_expl = 1;
-			sat.rtrail.last().push(m_r);
+			// The LP bound exceeds what is needed to exclude max + 1 by this much
+			const long double spare = (floor(s) + 1 - s) * (i == 0 ? 1 : fabsl(RL[i]));
+			r = createReason(i, spare);
 		}
-		if (!v.setMax(max, m_r)) {
+		if (!v.setMax(max, r)) {
 			return false;
 		}
 	}
 	return true;
 }
 
+Reason MIP::createReason(int i, long double spare) {
+	if (cert_start == -1) {
+		if (!trailed_cert_sz) {
+			engine.trail.push(TrailElem(&cert_lits._size(), 4));
+			engine.trail.push(TrailElem(&cert_cost._size(), 4));
+			engine.trail.push(TrailElem(&p_info._size(), 4));
+			trailed_cert_sz = true;
+		}
+		cert_start = cert_lits.size();
+		for (int j = 0; j < ps.size(); j++) {
+			cert_lits.push(ps[j]);
+			cert_cost.push(ps_cost[j]);
+		}
+	}
+	p_info.push(Pinfo(cert_start, ps.size(), place[i], spare));
+	return {prop_id, p_info.size() - 1};
+}
+
+// The certificate of the LP bound, without the bound of the inferred var
+// itself, and without the bounds which can be relaxed together while the LP
+// bound still implies the inference
+Clause* MIP::explain(Lit /*p*/, int inf_id) {
+	const Pinfo& pi = p_info[inf_id];
+	vec<int> order;
+	for (int j = 1; j < pi.size; j++) {
+		if (j != pi.place) {
+			order.push(j);
+		}
+	}
+	const long double* cost = &cert_cost[pi.start];
+	std::sort((int*)order, (int*)order + order.size(),
+						[cost](int a, int b) { return cost[a] < cost[b]; });
+	long double budget = pi.spare - RELAX_EPS;
+	int nb_relaxed = 0;
+	while (nb_relaxed < order.size() && cost[order[nb_relaxed]] < budget) {
+		budget -= cost[order[nb_relaxed++]];
+	}
+
+	vec<Lit> c;
+	c.push();
+	if (pi.place != 0) {
+		c.push(cert_lits[pi.start]);
+	}
+	for (int k = nb_relaxed; k < order.size(); k++) {
+		c.push(cert_lits[pi.start + order[k]]);
+	}
+	return Reason_new(c);
+}
+
 long double MIP::objVarBound() {
 	return engine.opt_type == OPT_MIN ? vars[0]->getMax() : -vars[0]->getMin();
 }
@@ -340,13 +416,15 @@ int MIP::getLimit() const {
 	if (decisionLevel() == 0) {
 		return 100000;
 	}
+	// Away from the root, pivots are paid for by the search nodes, so that the
+	// LP never takes over the search
 	if (level_lb <= decisionLevel() && decisionLevel() <= level_ub) {
-		return 100;
+		return (int)std::min(100LL, pivot_budget);
 	}
-	return DEFAULT_ROUNDS;
+	return (int)std::min((long long)DEFAULT_ROUNDS, pivot_budget);
 }
 
-int MIP::doSimplex() const {
+int MIP::doSimplex() {
 	//	printf("start simplex\n");
 	int r = SIMPLEX_IN_PROGRESS;
 	int steps = 0;
@@ -359,6 +437,9 @@ int MIP::doSimplex() const {
 		//		if (i == limit-1) printf("limit exceeded\n");
 		//		if (i%10 == 0) printf("Optimum = %.3f, ", optimum());
 	}
+	if (decisionLevel() > 0) {
+		pivot_budget -= steps;
+	}
 	simplex.calcObjBound();
 
 	//	if (MIP_DEBUG) {
@@ -379,6 +460,10 @@ int MIP::doSimplex() const {
 	if (decisionLevel() == 0) {
 		simplex.saveState(simplex.root);
 	}
+	if (r == SIMPLEX_OPTIMAL) {
+		level_state.growTo(decisionLevel() + 1);
+		simplex.saveState(level_state[decisionLevel()]);
+	}
 
 	return r;
 }
@@ -386,4 +471,6 @@ int MIP::doSimplex() const {
 void MIP::printStats() {
 	printf("%%%%%%mzn-stat: simplex=%lld\n", simplex.simplexs);
 	printf("%%%%%%mzn-stat: refactors=%lld\n", simplex.refactors);
+	printf("%%%%%%mzn-stat: basisRestores=%lld\n", restores);
+	printf("%%%%%%mzn-stat: cuts=%lld\n", cuts);
 }
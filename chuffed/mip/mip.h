@@ -2,10 +2,12 @@
 #define mip_h
 
 #include "chuffed/core/propagator.h"
+#include "chuffed/mip/simplex.h"
 #include "chuffed/support/misc.h"
 
 #include <map>
 #include <set>
+#include <vector>
 
 class VarGroup;
 
@@ -42,11 +44,39 @@ public:
 
 	vec<long double> RL;
 	vec<Lit> ps;
+	vec<long double> ps_cost;
 	vec<int> place;
 
+	// Lazy explanations: the certificates of the LP bounds that made inferences
+	// (trailed), and for each inference, its certificate, the position of the
+	// inferred var in it, and by how much the LP bound may be weakened
+	struct Pinfo {
+		int start;
+		int size;
+		int place;
+		long double spare;
+		Pinfo(int _start, int _size, int _place, long double _spare)
+				: start(_start), size(_size), place(_place), spare(_spare) {}
+	};
+	vec<Lit> cert_lits;
+	vec<long double> cert_cost;
+	vec<Pinfo> p_info;
+	int cert_start{-1};  // certificate of the current propagation, if stored
+	bool trailed_cert_sz{false};
+
 	vec<BoundChange> bctrail;
 	vec<int> bctrail_lim;
 
+	// Optimal basis found at each decision level, to warm start the dual simplex
+	// after backtracking instead of pivoting back from a deeper basis
+	vec<SimplexState> level_state;
+	long long restores{0};
+
+	// Cuts added at the root, as (var, coefficient)* rhs, to avoid duplicates
+	std::set<std::vector<long long> > cut_keys;
+	long long cuts{0};
+	long long pivot_budget{0};
+
 	int level_lb{-1};
 	int level_ub{-1};
 
@@ -65,7 +95,7 @@ public:
 
 	void addConstraint(vec<int>& a, vec<IntVar*>& x, long double lb, long double ub);
 	void init();
-	void presolve() {}
+	void presolve();
 
 	void newDecisionLevel();
 	void btToLevel(int level);
@@ -84,13 +114,23 @@ public:
 
 	int getLimit() const;
 	void updateBounds();
-	int doSimplex() const;
+	int doSimplex();
 	void unboundedFailure();
 	bool propagateAllBounds();
 	template <int T>
 	bool propagateBound(int i, long double s);
+	Reason createReason(int i, long double spare);
+	Clause* explain(Lit p, int inf_id) override;
 	long double objVarBound();
 
+	// Cutting planes
+
+	bool solveRootLP(vec<long double>& x);
+	bool addCut(vec<long long>& a, long long rhs, const vec<long double>& x);
+	int separateGomory(const vec<long double>& x);
+	int separateCovers(const vec<long double>& x);
+	int separateCliques(const vec<long double>& x);
+
 	// Inline functions
 
 	inline int decisionLevel() const { return bctrail_lim.size(); }
@@ -3,9 +3,16 @@
 
 #include <algorithm>
 #include <cassert>
-#include <cstddef>
+#include <cmath>
 #include <cstdio>
 #include <cstring>
+#include <utility>
+#include <vector>
+
+// A pivot must be at least this fraction of the largest entry of its column
+#define MARKOWITZ_TOL 0.1
+// Number of sparsest columns and rows searched for a pivot
+#define MARKOWITZ_SEARCH 4
 
 void LUFactor::multiply(long double* a) {
 	for (int i = 0; i < vals.size(); i++) {
@@ -21,18 +28,20 @@ void LUFactor::Tmultiply(long double* a) {
 	}
 }
 
+// L is unit lower triangular, its entries being the elimination multipliers,
+// and a is replaced by L^-1 a (or a L^-1) by substitution
 void Simplex::Lmultiply(long double* a) {
 	for (int i = L_cols_zeros; i < m; i++) {
 		tm[i] = 0;
 	}
 	for (int i = L_cols_zeros; i < m; i++) {
+		a[i] += tm[i];
+		checkZero13(a[i]);
 		if (a[i] != 0) {
 			for (int j = 0; j < L_cols[i].size(); j++) {
 				tm[L_cols[i][j].index()] += a[i] * L_cols[i][j].val();
 			}
 		}
-		a[i] += tm[i];
-		checkZero13(a[i]);
 	}
 }
 
@@ -41,13 +50,13 @@ void Simplex::LTmultiply(long double* a) {
 		tm[i] = 0;
 	}
 	for (int i = m - 1; i >= L_cols_zeros; i--) {
+		a[i] += tm[i];
+		checkZero13(a[i]);
 		if (a[i] != 0) {
 			for (int j = 0; j < L_rows[i].size(); j++) {
 				tm[L_rows[i][j].index()] += a[i] * L_rows[i][j].val();
 			}
 		}
-		a[i] += tm[i];
-		checkZero13(a[i]);
 	}
 }
 
@@ -371,31 +380,29 @@ void Simplex::refactorB() {
 
 	std::sort(col_perm2 + cs, col_perm2 + m, sort_col_nz);
 
+	// Sparse LU of the remaining part with Markowitz pivoting. Rows and columns
+	// of the active submatrix are numbered from 0 (row r is row cs + r, column q
+	// is var col_perm2[cs + q]); pivot k gets row and column position cs + k.
+	const int p = m - cs;
+	std::vector<std::vector<std::pair<int, long double> > > arow(p);  // active rows
+	std::vector<std::vector<int> > acol(p);  // rows which may have a non-zero in column q
+	std::vector<std::vector<std::pair<int, long double> > > lrow(p);  // multipliers, by position
+	std::vector<int> ccount(p, 0);
+	std::vector<char> row_done(p, 0);
+	std::vector<char> col_done(p, 0);
+	std::vector<int> piv_col(p);
+
+	struct Entry {
+		int r;  // row position
+		int q;  // local column
+		long double v;
+	};
+	vec<Entry> u_entries;
+
 	for (int i = cs; i < m; i++) {
 		row_perm2[i] = -1;
-		col_perm[ctor[col_perm2[i]]] = i;
 	}
 
-	// Do col perms
-	//	int old_rtoc[m];
-	int* old_rtoc = new int[m];
-	for (int i = 0; i < m; i++) {
-		old_rtoc[i] = rtoc[i];
-	}
-	for (int i = 0; i < m; i++) {
-		rtoc[col_perm[i]] = old_rtoc[i];
-		ctor[old_rtoc[i]] = col_perm[i];
-	}
-
-	// Initialise R1, R2 (for storing U and L)
-	const int p = m - cs;
-	for (int i = 1; i < p; i++) {
-		R1[i] = R1[0] + static_cast<ptrdiff_t>(i * p);
-		R2[i] = R2[0] + static_cast<ptrdiff_t>(i * p);
-	}
-	memset(R1[0], 0, sizeof(R1[0][0]) * p * p);
-	memset(R2[0], 0, sizeof(R2[0][0]) * p * p);
-
 	int rows_used = cs;
 	for (int i = cs; i < m; i++) {
 		const int c = col_perm2[i];
@@ -406,66 +413,183 @@ void Simplex::refactorB() {
 				r = rows_used++;
 			}
 			if (r < cs) {
-				U_rows[r].push(IndexVal(i, AV[c][j].val()));
-				U_cols[i].push(IndexVal(r, AV[c][j].val()));
+				u_entries.push(Entry{r, i - cs, AV[c][j].val()});
 			} else {
-				R1[r - cs][i - cs] = AV[c][j].val();
+				arow[r - cs].emplace_back(i - cs, AV[c][j].val());
+				acol[i - cs].push_back(r - cs);
+				ccount[i - cs]++;
 			}
 		}
 	}
 
-	//	fprintf(stderr, "R:\n");
-	//	for (int i = 0; i < m; i++) {
-	//		fprintf(stderr, "row %d: ", i);
-	//		for (int j = 0; j < m; j++) fprintf(stderr, "%d:%.3Lf ", j, R[i][j]);
-	//		fprintf(stderr, "\n");
-	//	}
+	std::vector<long double> wval(p);
+	std::vector<int> wmark(p, -1);
+	std::vector<int> seen(p, -1);
 
-	// calculate U and L
-	for (int i = 0; i < p; i++) {
-		int nr = -1;
-		for (int j = 0; j < p; j++) {
-			checkZero13(R1[j][i]);
-			if (R1[j][i] != 0 && row_perm2[j + cs] == -1) {
-				nr = j;
-				break;
+	auto find = [&](int r, int q) -> int {
+		for (int t = 0; t < static_cast<int>(arow[r].size()); t++) {
+			if (arow[r][t].first == q) {
+				return t;
 			}
 		}
-		assert(nr != -1);
-		assert(R1[nr][i] != 0);
-		row_perm2[nr + cs] = i + cs;
-		U_diag[i + cs] = R1[nr][i];
-		if (SIMPLEX_DEBUG && -0.0001 < U_diag[i + cs] && U_diag[i + cs] < 0.0001) {
-			fprintf(stderr, "Very small diag %d, %.18Lf\n", i + cs, U_diag[i + cs]);
+		return -1;
+	};
+
+	for (int k = 0; k < p; k++) {
+		// Pivot search: the non-zero of least Markowitz cost in the few sparsest
+		// columns and rows, among those that are not too small for their column
+		int cmin = m + 1;
+		int rmin = m + 1;
+		for (int q = 0; q < p; q++) {
+			if (col_done[q] == 0 && ccount[q] < cmin) {
+				cmin = ccount[q];
+			}
+			if (row_done[q] == 0 && static_cast<int>(arow[q].size()) < rmin) {
+				rmin = static_cast<int>(arow[q].size());
+			}
 		}
-		for (int j = i + 1; j < p; j++) {
-			checkZero13(R1[nr][j]);
-			if (R1[nr][j] != 0) {
-				U_rows[i + cs].push(IndexVal(j + cs, R1[nr][j]));
-				U_cols[j + cs].push(IndexVal(i + cs, R1[nr][j]));
+		int nr = -1;
+		int nq = -1;
+		long long best_cost = -1;
+		auto colMax = [&](int q) {
+			long double cmax = 0;
+			for (const int r : acol[q]) {
+				const int t = row_done[r] != 0 ? -1 : find(r, q);
+				if (t >= 0) {
+					cmax = std::max(cmax, std::fabs(arow[r][t].second));
+				}
+			}
+			return cmax;
+		};
+		auto consider = [&](int r, int q, long double v, long double cmax) {
+			if (std::fabs(v) < MARKOWITZ_TOL * cmax) {
+				return;
+			}
+			const long long cost = static_cast<long long>(arow[r].size() - 1) * (ccount[q] - 1);
+			if (best_cost == -1 || cost < best_cost) {
+				best_cost = cost;
+				nr = r;
+				nq = q;
+			}
+		};
+		int searched = 0;
+		for (int q = 0; q < p && searched < MARKOWITZ_SEARCH; q++) {
+			if (col_done[q] != 0 || ccount[q] != cmin) {
+				continue;
+			}
+			searched++;
+			const long double cmax = colMax(q);
+			for (const int r : acol[q]) {
+				const int t = row_done[r] != 0 ? -1 : find(r, q);
+				if (t >= 0) {
+					consider(r, q, arow[r][t].second, cmax);
+				}
 			}
 		}
-		for (int j = 0; j < i; j++) {
-			checkZero13(R2[nr][j]);
-			if (R2[nr][j] != 0) {
-				L_rows[i + cs].push(IndexVal(j + cs, R2[nr][j]));
-				L_cols[j + cs].push(IndexVal(i + cs, R2[nr][j]));
+		searched = 0;
+		for (int r = 0; r < p && searched < MARKOWITZ_SEARCH && best_cost != 0; r++) {
+			if (row_done[r] != 0 || static_cast<int>(arow[r].size()) != rmin) {
+				continue;
+			}
+			searched++;
+			for (const auto& e : arow[r]) {
+				consider(r, e.first, e.second, colMax(e.first));
 			}
 		}
-		for (int j = 0; j < p; j++) {
-			checkZero13(R1[j][i]);
-			if (R1[j][i] == 0 || row_perm2[j + cs] >= 0) {
+		assert(nr != -1);
+
+		const int pos = cs + k;
+		row_done[nr] = 1;
+		col_done[nq] = 1;
+		piv_col[k] = nq;
+		row_perm2[nr + cs] = pos;
+
+		std::vector<std::pair<int, long double> >& prow = arow[nr];
+		const int pt = find(nr, nq);
+		const long double pv = prow[pt].second;
+		prow[pt] = prow.back();
+		prow.pop_back();
+		U_diag[pos] = pv;
+		if (SIMPLEX_DEBUG && -0.0001 < pv && pv < 0.0001) {
+			fprintf(stderr, "Very small diag %d, %.18Lf\n", pos, pv);
+		}
+		for (const auto& e : prow) {
+			u_entries.push(Entry{pos, e.first, e.second});
+			ccount[e.first]--;
+		}
+		for (const auto& e : lrow[nr]) {
+			L_rows[pos].push(IndexVal(e.first, e.second));
+			L_cols[e.first].push(IndexVal(pos, e.second));
+		}
+
+		// Eliminate the pivot column from the other rows
+		for (const int j : acol[nq]) {
+			if (row_done[j] != 0 || seen[j] == k) {
 				continue;
 			}
-			const long double a = -R1[j][i] / R1[nr][i];
-			for (int k = 0; k < U_rows[i + cs].size(); k++) {
-				R1[j][U_rows[i + cs][k].index() - cs] += a * U_rows[i + cs][k].val();
+			seen[j] = k;
+			const int t = find(j, nq);
+			if (t < 0) {
+				continue;
+			}
+			const long double a = -arow[j][t].second / pv;
+			std::vector<std::pair<int, long double> >& row = arow[j];
+			row[t] = row.back();
+			row.pop_back();
+
+			for (int s = 0; s < static_cast<int>(row.size()); s++) {
+				wmark[row[s].first] = s;
+			}
+			for (const auto& e : prow) {
+				if (wmark[e.first] >= 0) {
+					row[wmark[e.first]].second += a * e.second;
+				} else {
+					wmark[e.first] = static_cast<int>(row.size());
+					row.emplace_back(e.first, a * e.second);
+					acol[e.first].push_back(j);
+					ccount[e.first]++;
+				}
 			}
-			for (int k = 0; k < L_rows[i + cs].size(); k++) {
-				R2[j][L_rows[i + cs][k].index() - cs] += a * L_rows[i + cs][k].val();
+			int nz = 0;
+			for (auto& e : row) {
+				wmark[e.first] = -1;
+				checkZero13(e.second);
+				if (e.second != 0) {
+					row[nz++] = e;
+				} else {
+					ccount[e.first]--;
+				}
 			}
-			R2[j][i] += a * 1;
+			row.resize(nz);
+
+			lrow[j].emplace_back(pos, a);
 		}
+		prow.clear();
+		lrow[nr].clear();
+	}
+
+	for (int k = 0; k < p; k++) {
+		col_perm[ctor[col_perm2[cs + piv_col[k]]]] = cs + k;
+	}
+	std::vector<int> qpos(p);
+	for (int k = 0; k < p; k++) {
+		qpos[piv_col[k]] = cs + k;
+	}
+	for (int i = 0; i < u_entries.size(); i++) {
+		const Entry& e = u_entries[i];
+		U_rows[e.r].push(IndexVal(qpos[e.q], e.v));
+		U_cols[qpos[e.q]].push(IndexVal(e.r, e.v));
+	}
+
+	// Do col perms
+	//	int old_rtoc[m];
+	int* old_rtoc = new int[m];
+	for (int i = 0; i < m; i++) {
+		old_rtoc[i] = rtoc[i];
+	}
+	for (int i = 0; i < m; i++) {
+		rtoc[col_perm[i]] = old_rtoc[i];
+		ctor[old_rtoc[i]] = col_perm[i];
 	}
 
 	L_cols_zeros = cs;
@@ -506,6 +630,7 @@ void Simplex::refactorB() {
 	int* old_ub = new int[m];
 	int* old_shift = new int[m];
 	int* old_ctor = new int[m];
+	int* old_con = new int[m];
 	// slack var i -> slack var row_perm[i]
 
 	for (int i = 0; i < m; i++) {
@@ -516,6 +641,7 @@ void Simplex::refactorB() {
 		old_ub[i] = ub[n + i];
 		old_shift[i] = shift[n + i];
 		old_ctor[i] = ctor[n + i];
+		old_con[i] = con[i];
 	}
 
 	for (int i = 0; i < m; i++) {
@@ -526,6 +652,7 @@ void Simplex::refactorB() {
 		ub[n + row_perm[i]].v = old_ub[i];
 		shift[n + row_perm[i]] = old_shift[i];
 		ctor[n + row_perm[i]] = old_ctor[i];
+		con[row_perm[i]] = old_con[i];
 		if (old_ctor[i] >= 0) {
 			rtoc[old_ctor[i]] = n + row_perm[i];
 		}
@@ -537,7 +664,7 @@ void Simplex::refactorB() {
 
 	num_lu_factors = 0;
 
-	if (simplexs > 0) {
+	if (ctor[0] >= 0) {
 		calcObjective();
 	}
 
@@ -553,46 +680,57 @@ void Simplex::refactorB() {
 	delete[] old_ub;
 	delete[] old_shift;
 	delete[] old_ctor;
+	delete[] old_con;
 
 	//	printB();
 }
 
 void Simplex::saveState(SimplexState& s) const {
-	if (s.rtoc == nullptr) {
-		s.rtoc = new int[m];
-	}
-	if (s.ctor == nullptr) {
-		s.ctor = new int[n + m];
+	if (s.basic == nullptr) {
+		s.basic = new int[n + m];
 	}
 	if (s.shift == nullptr) {
-		s.shift = new int[n + m + 1];
+		s.shift = new int[n + m];
 	}
 
-	for (int i = 0; i < m; i++) {
-		s.rtoc[i] = rtoc[i];
-	}
 	for (int i = 0; i < n + m; i++) {
-		s.ctor[i] = ctor[i];
-	}
-	for (int i = 0; i < n + m + 1; i++) {
-		s.shift[i] = shift[i];
+		const int k = (i < n ? i : n + con[i - n]);
+		s.basic[k] = static_cast<int>(ctor[i] >= 0);
+		s.shift[k] = shift[i];
 	}
+	s.simplexs = simplexs;
 
 	//	fprintf(stderr, "Saving state:\n");
 	//	printTableau(true);
 }
 
-void Simplex::loadState(SimplexState& s) const {
+// The bounds may have changed since the state was saved, so the basis is
+// refactorised and the objective row and the bound offsets are recomputed
+void Simplex::loadState(SimplexState& s) {
+	assert(s.simplexs >= 0);
+	int r = 0;
+	for (int i = 0; i < n + m; i++) {
+		const int k = (i < n ? i : n + con[i - n]);
+		shift[i] = s.shift[k];
+		if (s.basic[k] != 0) {
+			rtoc[r] = i;
+			ctor[i] = r++;
+		} else {
+			ctor[i] = -1;
+		}
+	}
+	assert(r == m);
+
 	for (int i = 0; i < m; i++) {
-		rtoc[i] = s.rtoc[i];
+		BC[i] = 0;
 	}
 	for (int i = 0; i < n + m; i++) {
-		ctor[i] = s.ctor[i];
-	}
-	for (int i = 0; i < n + m + 1; i++) {
-		shift[i] = s.shift[i];
+		boundChange(i, shift[i] != 0 ? ub[i] : lb[i]);
 	}
 
+	refactorB();
+	calcObjBound();
+
 	//	fprintf(stderr, "loading state:\n");
 	//	printTableau(true);
 }
@@ -24,6 +24,10 @@ Simplex simplex;
 Simplex::Simplex() : sort_col_ratio(ratio), sort_col_nz(AV_nz) {}
 
 void Simplex::init() {
+	if (AH != nullptr) {
+		freeMemory();
+	}
+
 	m = mip->ineqs.size();
 	n = mip->vars.size();
 
@@ -51,8 +55,6 @@ void Simplex::init() {
 	BZ = new long double[m];
 	obj = new long double[n + m];
 	rhs = new long double[m];
-	R1 = new2d<long double>(m, m);
-	R2 = new2d<long double>(m, m);
 	tm = new long double[m];
 	BC = new int[m];
 
@@ -75,6 +77,7 @@ void Simplex::init() {
 	rtoc = new int[m];
 	ctor = new int[n + m];
 	shift = new int[n + m + 1];
+	con = new int[m];
 
 	row = new long double[n + m];
 	column = new long double[m];
@@ -129,6 +132,9 @@ void Simplex::init() {
 		shift[i] = 0;
 	}
 	shift[n + m] = 2;
+	for (int i = 0; i < m; i++) {
+		con[i] = i;
+	}
 
 	// Initialise var bounds
 
@@ -189,6 +195,37 @@ void Simplex::init() {
 	pivotObjVar();
 }
 
+// Releases the arrays of a previous init, when the rows are rebuilt at the root
+void Simplex::freeMemory() {
+	delete[] AH;
+	delete[] AV;
+	delete[] AH_mem;
+	delete[] AV_mem;
+	delete[] AH_nz;
+	delete[] AV_nz;
+	delete[] Y;
+	delete[] BZ;
+	delete[] obj;
+	delete[] rhs;
+	delete[] tm;
+	delete[] BC;
+	delete[] norm2;
+	delete[] reduced_costs;
+	delete[] U_diag;
+	delete[] U_perm;
+	delete[] lu_factors;
+	delete[] lb;
+	delete[] ub;
+	delete[] rtoc;
+	delete[] ctor;
+	delete[] shift;
+	delete[] con;
+	delete[] row;
+	delete[] column;
+	delete[] ratio;
+	AH = nullptr;
+}
+
 void Simplex::pivotObjVar() {
 	pivot_col = 0;
 	pivot_row = -1;
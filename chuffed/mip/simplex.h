@@ -10,11 +10,13 @@
 
 enum SimplexStatus { SIMPLEX_OPTIMAL, SIMPLEX_GOOD_ENOUGH, SIMPLEX_IN_PROGRESS, SIMPLEX_UNBOUNDED };
 
+// A basis, independent of the row order chosen by refactorisations: variables
+// are indexed as in the original problem, slack n + i standing for constraint i
 class SimplexState {
 public:
-	int* rtoc{nullptr};
-	int* ctor{nullptr};
+	int* basic{nullptr};
 	int* shift{nullptr};
+	long long simplexs{-1};  // number of pivots when saved, -1 if never saved
 	SimplexState() = default;
 };
 
@@ -59,20 +61,18 @@ public:
 	int m;       // number of constraints
 	int A_size;  // number of coefficients
 
-	IndexVal** AH;     // original constraints horizontally
-	IndexVal** AV;     // original constraints vertically
-	IndexVal* AH_mem;  // memory for AH
-	IndexVal* AV_mem;  // memory for AV
-	int* AH_nz;        // number of non-zeros in AH
-	int* AV_nz;        // number of non-zeros in AV
+	IndexVal** AH{nullptr};  // original constraints horizontally
+	IndexVal** AV;           // original constraints vertically
+	IndexVal* AH_mem;        // memory for AH
+	IndexVal* AV_mem;        // memory for AV
+	int* AH_nz;              // number of non-zeros in AH
+	int* AV_nz;              // number of non-zeros in AV
 
 	long double* Z;    // pivot row of B^-1
 	long double* Y;    // pivot column
 	long double* BZ;   // B^-1 . Z
 	long double* obj;  // objective function
 	long double* rhs;  // right hand side of constraints
-	long double** R1;  // memory for refactorising B
-	long double** R2;  // memory for refactorising B
 	long double* tm;   // temp memory for various things
 	int* BC;           // values of linear expressions at current bounds
 	long double obj_bound;
@@ -100,6 +100,7 @@ public:
 	int* rtoc;   // row to var
 	int* ctor;   // var to row, -1 if non-basic
 	int* shift;  // whether we're using upper or lower bound offset
+	int* con;    // constraint of slack var n + i, rows being permuted by refactorB
 
 	int pivot_col;
 	int pivot_row;
@@ -132,6 +133,7 @@ public:
 	// Simplex methods
 
 	void init();
+	void freeMemory();
 	void pivotObjVar();
 	void boundChange(int v, int d) const;
 	void boundSwap(int v) const;
@@ -158,7 +160,7 @@ public:
 	void refactorB();
 
 	void saveState(SimplexState& s) const;
-	void loadState(SimplexState& s) const;
+	void loadState(SimplexState& s);
 
 	// Debug methods
 
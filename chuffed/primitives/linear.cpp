@@ -180,6 +180,23 @@ public:
 		ps[R + inf_id] = ps[0];
 		return Reason_new(ps);
 	}
+
+	bool getLinearTerms(vec<int>& a, vec<IntVar*>& vars) override {
+		if (R != 0) {
+			return false;
+		}
+		a.clear();
+		vars.clear();
+		for (int i = 0; i < x.size(); i++) {
+			a.push(x[i].a);
+			vars.push(x[i].var);
+		}
+		for (int i = 0; i < y.size(); i++) {
+			a.push(-y[i].a);
+			vars.push(y[i].var);
+		}
+		return true;
+	}
 };
 
 //-----
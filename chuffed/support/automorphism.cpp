@@ -0,0 +1,320 @@
+#include "chuffed/support/automorphism.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+static inline uint64_t mix(uint64_t h, uint64_t x) { return (h ^ x) * 1099511628211ULL; }
+
+AutomorphismSearch::AutomorphismSearch(const std::vector<int>& colour,
+																			 const std::vector<std::vector<int> >& adj)
+		: n(static_cast<int>(colour.size())) {
+	offsets.reserve(n + 1);
+	offsets.push_back(0);
+	for (int v = 0; v < n; v++) {
+		items.insert(items.end(), adj[v].begin(), adj[v].end());
+		std::sort(items.begin() + offsets.back(), items.end());
+		offsets.push_back(static_cast<int>(items.size()));
+	}
+	count.assign(n, 0);
+	in_queue.assign(n, 0);
+
+	// The colour classes, refined to an equitable partition
+	pl.elems.resize(n);
+	std::iota(pl.elems.begin(), pl.elems.end(), 0);
+	std::stable_sort(pl.elems.begin(), pl.elems.end(),
+									 [&](int u, int v) { return colour[u] < colour[v]; });
+	pl.pos.resize(n);
+	pl.cell_of.resize(n);
+	pl.cell_end.resize(n);
+	for (int i = 0; i < n; i++) {
+		pl.pos[pl.elems[i]] = i;
+	}
+	for (int s = 0; s < n;) {
+		int e = s + 1;
+		while (e < n && colour[pl.elems[e]] == colour[pl.elems[s]]) {
+			e++;
+		}
+		for (int i = s; i < e; i++) {
+			pl.cell_of[pl.elems[i]] = s;
+		}
+		pl.cell_end[s] = e;
+		pl.ncells++;
+		queue.push_back(s);
+		in_queue[s] = 1;
+		s = e;
+	}
+	refine(pl);
+	pl.splits.clear();
+	base_cell = pl.cell_of;
+	pr = pl;
+}
+
+void AutomorphismSearch::Partition::split(int c, int s) {
+	const int e = cell_end[c];
+	cell_end[c] = s;
+	cell_end[s] = e;
+	for (int i = s; i < e; i++) {
+		cell_of[elems[i]] = s;
+	}
+	splits.push_back(s);
+	ncells++;
+}
+
+// Merges back the cells split off after the mark, latest first
+void AutomorphismSearch::Partition::undo(int mark) {
+	while (static_cast<int>(splits.size()) > mark) {
+		const int s = splits.back();
+		splits.pop_back();
+		const int c = cell_of[elems[s - 1]];
+		const int e = cell_end[s];
+		for (int i = s; i < e; i++) {
+			cell_of[elems[i]] = c;
+		}
+		cell_end[c] = e;
+		ncells--;
+	}
+}
+
+void AutomorphismSearch::Partition::swap(int i, int j) {
+	std::swap(elems[i], elems[j]);
+	pos[elems[i]] = i;
+	pos[elems[j]] = j;
+}
+
+// Makes v a cell of its own, at the start of its old cell, and queues it
+int AutomorphismSearch::individualise(Partition& p, int v) {
+	const int c = p.cell_of[v];
+	if (p.cell_end[c] - c > 1) {
+		p.swap(p.pos[v], c);
+		p.split(c, c + 1);
+	}
+	if (in_queue[c] == 0) {
+		queue.push_back(c);
+		in_queue[c] = 1;
+	}
+	return c;
+}
+
+// Splits the cells of p by their number of neighbours in each queued cell,
+// until the partition is equitable. Cells are processed and split in an order
+// that only depends on the partition, so that refining partitions that an
+// automorphism maps to each other gives the same trace.
+uint64_t AutomorphismSearch::refine(Partition& p) {
+	uint64_t h = 1469598103934665603ULL;
+	for (size_t head = 0; head < queue.size(); head++) {
+		const int w = queue[head];
+		in_queue[w] = 0;
+		for (int i = w; i < p.cell_end[w]; i++) {
+			const int v = p.elems[i];
+			for (int k = offsets[v]; k < offsets[v + 1]; k++) {
+				if (count[items[k]]++ == 0) {
+					touched.push_back(items[k]);
+				}
+			}
+			work += offsets[v + 1] - offsets[v];
+		}
+		std::sort(touched.begin(), touched.end(),
+							[&](int u, int v) { return p.cell_of[u] < p.cell_of[v]; });
+
+		for (size_t t = 0; t < touched.size();) {
+			const int c = p.cell_of[touched[t]];
+			const int e = p.cell_end[c];
+			size_t t2 = t;
+			while (t2 < touched.size() && p.cell_of[touched[t2]] == c) {
+				t2++;
+			}
+			if (e - c == 1) {
+				t = t2;
+				continue;
+			}
+			// Touched vertices go to the end of the cell, by increasing count
+			int back = e;
+			for (size_t i = t; i < t2; i++) {
+				p.swap(p.pos[touched[i]], --back);
+			}
+			std::sort(p.elems.begin() + back, p.elems.begin() + e,
+								[&](int u, int v) { return count[u] < count[v]; });
+			for (int i = back; i < e; i++) {
+				p.pos[p.elems[i]] = i;
+			}
+			std::vector<int> starts;
+			if (back > c) {
+				starts.push_back(c);
+			}
+			for (int i = back; i < e; i++) {
+				if (i == back || count[p.elems[i]] != count[p.elems[i - 1]]) {
+					starts.push_back(i);
+				}
+			}
+			h = mix(mix(h, c), starts.size());
+			for (size_t j = 0; j < starts.size(); j++) {
+				const int end = j + 1 < starts.size() ? starts[j + 1] : e;
+				h = mix(mix(h, end - starts[j]), starts[j] < back ? 0 : count[p.elems[starts[j]]]);
+			}
+			if (starts.size() > 1) {
+				for (size_t j = 1; j < starts.size(); j++) {
+					p.split(starts[j - 1], starts[j]);
+				}
+				// All the pieces are needed as splitters if the cell was queued,
+				// otherwise all but a largest one
+				size_t largest = 0;
+				if (in_queue[c] == 0) {
+					for (size_t j = 1; j < starts.size(); j++) {
+						if (p.cell_end[starts[j]] - starts[j] >
+								p.cell_end[starts[largest]] - starts[largest]) {
+							largest = j;
+						}
+					}
+				}
+				for (size_t j = 0; j < starts.size(); j++) {
+					if ((in_queue[c] != 0 || j != largest) && in_queue[starts[j]] == 0) {
+						queue.push_back(starts[j]);
+						in_queue[starts[j]] = 1;
+					}
+				}
+			}
+			t = t2;
+		}
+		for (const int u : touched) {
+			count[u] = 0;
+		}
+		touched.clear();
+	}
+	queue.clear();
+	return mix(h, p.ncells);
+}
+
+// The first non-singleton cell in which some vertex can be mapped to itself,
+// or failing that the first non-singleton cell. first is set to the start of
+// the first non-singleton cell, which is never before from.
+int AutomorphismSearch::targetCell(int from, int& first) const {
+	first = -1;
+	for (int c = from; c < n; c = pl.cell_end[c]) {
+		if (pl.cell_end[c] - c == 1) {
+			continue;
+		}
+		if (first == -1) {
+			first = c;
+		}
+		for (int i = c; i < pl.cell_end[c]; i++) {
+			if (pr.cell_of[pl.elems[i]] == c) {
+				return c;
+			}
+		}
+	}
+	return first;
+}
+
+bool AutomorphismSearch::adjacent(int u, int v) const {
+	return std::binary_search(items.begin() + offsets[u], items.begin() + offsets[u + 1], v);
+}
+
+// Vertices are only mapped within their cell, so colours and degrees are
+// preserved and checking the edges one way is enough
+bool AutomorphismSearch::isAutomorphism(std::vector<int>& perm) const {
+	for (int v = 0; v < n; v++) {
+		for (int k = offsets[v]; k < offsets[v + 1]; k++) {
+			if (!adjacent(perm[v], perm[items[k]])) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool AutomorphismSearch::findSwap(int a, int b, std::vector<int>& perm, int max_backtracks,
+																	const std::vector<int>& fixed) {
+	if (base_cell[a] != base_cell[b]) {
+		return false;
+	}
+	const int mark_l = static_cast<int>(pl.splits.size());
+	const int mark_r = static_cast<int>(pr.splits.size());
+	individualise(pl, a);
+	individualise(pl, b);
+	for (const int v : fixed) {
+		if (v != a && v != b) {
+			individualise(pl, v);
+		}
+	}
+	const uint64_t trace = refine(pl);
+	individualise(pr, b);
+	individualise(pr, a);
+	for (const int v : fixed) {
+		if (v != a && v != b) {
+			individualise(pr, v);
+		}
+	}
+	bool found = false;
+	if (refine(pr) == trace) {
+		perm.resize(n);
+		std::vector<Level> stack;
+		int backtracks = 0;
+		bool descend = true;
+		while (true) {
+			if (descend && pl.ncells == n) {
+				for (int i = 0; i < n; i++) {
+					perm[pl.elems[i]] = pr.elems[i];
+				}
+				if (isAutomorphism(perm)) {
+					found = true;
+					break;
+				}
+				descend = false;
+			}
+			if (descend) {
+				// Branch on the images of a vertex x, trying x itself first
+				Level lv;
+				lv.c = targetCell(stack.empty() ? 0 : stack.back().first, lv.first);
+				int x = pl.elems[lv.c];
+				for (int i = lv.c; i < pl.cell_end[lv.c]; i++) {
+					if (pr.cell_of[pl.elems[i]] == lv.c) {
+						x = pl.elems[i];
+						break;
+					}
+				}
+				lv.cands.assign(pr.elems.begin() + lv.c, pr.elems.begin() + pr.cell_end[lv.c]);
+				auto it = std::find(lv.cands.begin(), lv.cands.end(), x);
+				if (it != lv.cands.end()) {
+					std::swap(*it, lv.cands.front());
+				}
+				lv.mark_l = static_cast<int>(pl.splits.size());
+				individualise(pl, x);
+				lv.trace = refine(pl);
+				lv.mark_r = static_cast<int>(pr.splits.size());
+				lv.next = 0;
+				stack.push_back(std::move(lv));
+			} else if (stack.empty() || ++backtracks > max_backtracks) {
+				break;
+			}
+			Level& lv = stack.back();
+			pr.undo(lv.mark_r);
+			descend = false;
+			while (lv.next < static_cast<int>(lv.cands.size())) {
+				individualise(pr, lv.cands[lv.next++]);
+				if (refine(pr) == lv.trace) {
+					descend = true;
+					break;
+				}
+				pr.undo(lv.mark_r);
+				if (++backtracks > max_backtracks) {
+					break;
+				}
+			}
+			if (!descend) {
+				pl.undo(lv.mark_l);
+				pr.undo(lv.mark_r);
+				stack.pop_back();
+				if (backtracks > max_backtracks) {
+					break;
+				}
+			}
+		}
+	}
+	pl.undo(mark_l);
+	pr.undo(mark_r);
+	return found;
+}
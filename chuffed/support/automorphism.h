@@ -0,0 +1,78 @@
+#ifndef AUTOMORPHISM_H
+#define AUTOMORPHISM_H
+
+#include <cstdint>
+#include <vector>
+
+// Automorphisms of an undirected vertex coloured graph, found by
+// individualisation and refinement of equitable partitions, as in nauty, saucy
+// or bliss, but without their pruning of the search tree: the searches are
+// for one automorphism with a prescribed action on two vertices, not for the
+// whole group.
+class AutomorphismSearch {
+public:
+	// colour[v] is the colour of vertex v, and adj[v] its neighbours, without
+	// duplicates
+	AutomorphismSearch(const std::vector<int>& colour, const std::vector<std::vector<int> >& adj);
+
+	int nbVertices() const { return n; }
+	// Cell of v in the coarsest equitable partition refining the colours. No
+	// automorphism maps a vertex to one of another cell.
+	int cell(int v) const { return base_cell[v]; }
+
+	// Looks for an automorphism exchanging a and b, and fixing the vertices of
+	// fixed other than a and b. Other vertices are fixed whenever possible too,
+	// so the automorphism found tends to move only what the exchange forces.
+	// Gives up after max_backtracks failed branches.
+	bool findSwap(int a, int b, std::vector<int>& perm, int max_backtracks,
+								const std::vector<int>& fixed = std::vector<int>());
+
+	// Adjacency lists visited so far by refinement
+	long long work{0};
+
+private:
+	struct Partition {
+		std::vector<int> elems;     // vertices, cell by cell
+		std::vector<int> pos;       // position of each vertex in elems
+		std::vector<int> cell_of;   // start of the cell of each vertex
+		std::vector<int> cell_end;  // end of the cell starting at each position
+		std::vector<int> splits;    // starts of the cells split off, to undo them
+		int ncells{0};
+
+		void split(int c, int s);
+		void undo(int mark);
+		void swap(int i, int j);
+	};
+
+	struct Level {
+		int c;
+		int first;  // first non-singleton cell
+		int mark_l;
+		int mark_r;
+		uint64_t trace;
+		std::vector<int> cands;
+		int next;
+	};
+
+	int n;
+	std::vector<int> offsets;  // CSR adjacency, each list sorted
+	std::vector<int> items;
+	std::vector<int> base_cell;
+
+	Partition pl;  // partition of the domain of the automorphism
+	Partition pr;  // partition of its image
+
+	// Refinement scratch
+	std::vector<int> queue;
+	std::vector<char> in_queue;
+	std::vector<int> count;
+	std::vector<int> touched;
+
+	int individualise(Partition& p, int v);
+	uint64_t refine(Partition& p);
+	int targetCell(int from, int& first) const;
+	bool isAutomorphism(std::vector<int>& perm) const;
+	bool adjacent(int u, int v) const;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#include "chuffed/support/csr_graph.h"
+
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+CSRLists::CSRLists() {
+	Data d;
+	d.offsets.push_back(0);
+	setData(intern(d));
+}
+
+const CSRLists::Data* CSRLists::intern(Data& d) {
+	// Graphs are built once per model, so the pool is never emptied
+	static std::unordered_multimap<size_t, const Data*> pool;
+
+	size_t h = d.offsets.size();
+	for (const int x : d.offsets) {
+		h = h * 31 + static_cast<size_t>(x);
+	}
+	for (const int x : d.items) {
+		h = h * 31 + static_cast<size_t>(x);
+	}
+
+	auto range = pool.equal_range(h);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (*it->second == d) {
+			return it->second;
+		}
+	}
+	const Data* nd = new Data(std::move(d));
+	pool.emplace(h, nd);
+	return nd;
+}
+
+CSRGraph CSRGraph::reversed() const {
+	std::vector<std::vector<int> > ren(nbEdges(), std::vector<int>(2));
+	for (int e = 0; e < nbEdges(); e++) {
+		ren[e][0] = head(e);
+		ren[e][1] = tail(e);
+	}
+	return {CSRLists(ren), ou, in};
+}
+
+CSRGraph CSRGraph::withEdge(int u, int v) const {
+	const int ne = nbEdges();
+	std::vector<std::vector<int> > nen(ne + 1);
+	for (int e = 0; e < ne; e++) {
+		nen[e] = {tail(e), head(e)};
+	}
+	nen[ne] = {u, v};
+	std::vector<std::vector<int> > nin(nbNodes());
+	std::vector<std::vector<int> > nou(nbNodes());
+	for (int x = 0; x < nbNodes(); x++) {
+		nin[x].assign(in[x].begin(), in[x].end());
+		nou[x].assign(ou[x].begin(), ou[x].end());
+	}
+	nou[u].push_back(ne);
+	nin[v].push_back(ne);
+	return {CSRLists(nen), CSRLists(nin), CSRLists(nou)};
+}
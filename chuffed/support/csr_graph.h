@@ -0,0 +1,105 @@
+#ifndef CSR_GRAPH_H
+#define CSR_GRAPH_H
+
+#include <cassert>
+#include <vector>
+
+// Immutable family of integer lists (adjacency lists, edge endnodes, ...) stored
+// in compressed sparse row form: list i is items[offsets[i] .. offsets[i+1]).
+//
+// The storage is hash-consed, so that all the propagators and graph algorithms
+// built over the same graph share a single copy. A CSRLists is only a handle on
+// that storage: copying it copies a pointer.
+class CSRLists {
+	struct Data {
+		std::vector<int> offsets;
+		std::vector<int> items;
+		bool operator==(const Data& o) const { return offsets == o.offsets && items == o.items; }
+	};
+
+public:
+	class Range {
+		const int* first;
+		const int* last;
+
+	public:
+		Range(const int* _first, const int* _last) : first(_first), last(_last) {}
+		const int* begin() const { return first; }
+		const int* end() const { return last; }
+		int size() const { return static_cast<int>(last - first); }
+		bool empty() const { return first == last; }
+		int operator[](int i) const {
+			assert(i >= 0 && i < size());
+			return first[i];
+		}
+	};
+
+	CSRLists();
+
+	// Works with vec<vec<int> > as well as std::vector<std::vector<int> >
+	template <class Lists>
+	explicit CSRLists(const Lists& lists) {
+		Data d;
+		d.offsets.reserve(lists.size() + 1);
+		d.offsets.push_back(0);
+		for (int i = 0; i < static_cast<int>(lists.size()); i++) {
+			for (int j = 0; j < static_cast<int>(lists[i].size()); j++) {
+				d.items.push_back(lists[i][j]);
+			}
+			d.offsets.push_back(static_cast<int>(d.items.size()));
+		}
+		setData(intern(d));
+	}
+
+	int size() const { return nb_lists; }
+	int totalSize() const { return offsets[nb_lists]; }
+
+	Range operator[](int i) const {
+		assert(i >= 0 && i < size());
+		return {items + offsets[i], items + offsets[i + 1]};
+	}
+
+	bool operator==(const CSRLists& o) const { return data == o.data; }
+	bool operator!=(const CSRLists& o) const { return data != o.data; }
+
+private:
+	const Data* data;
+	// Cached from data, to save an indirection on every access
+	const int* offsets;
+	const int* items;
+	int nb_lists;
+
+	void setData(const Data* d) {
+		data = d;
+		offsets = d->offsets.data();
+		items = d->items.data();
+		nb_lists = static_cast<int>(d->offsets.size()) - 1;
+	}
+
+	static const Data* intern(Data& d);
+};
+
+// Directed graph over nodes 0..nbNodes()-1 and edges 0..nbEdges()-1, where edge
+// e goes from en[e][0] to en[e][1]. Undirected graphs use the same structure
+// and simply ignore the direction.
+class CSRGraph {
+public:
+	CSRLists en;  // edge -> {tail, head}
+	CSRLists in;  // node -> incoming edges
+	CSRLists ou;  // node -> outgoing edges
+
+	CSRGraph() = default;
+	CSRGraph(CSRLists _en, CSRLists _in, CSRLists _ou) : en(_en), in(_in), ou(_ou) {}
+
+	int nbNodes() const { return in.size(); }
+	int nbEdges() const { return en.size(); }
+	int tail(int e) const { return en[e][0]; }
+	int head(int e) const { return en[e][1]; }
+
+	// The same graph with every edge reversed
+	CSRGraph reversed() const;
+	// The same graph with an extra edge u -> v, numbered nbEdges()
+	CSRGraph withEdge(int u, int v) const;
+};
+
+#endif
@@ -11,48 +11,126 @@
 // The label on each node counts the cost of its duration! (i.e. Duration included)
 //  i.e. the label on each node says when will you be done with it.
 
-Dijkstra::Dijkstra(int _s, vvi_t _en, const vvi_t& _in, vvi_t _ou, std::vector<int>& _ws)
+Dijkstra::Dijkstra(int _s, const CSRGraph& g, std::vector<int>& _ws)
 		: source(_s),
-			nb_nodes(_in.size()),
-			en(std::move(_en)),
-			in(_in),
-			out(std::move(_ou)),
+			nb_nodes(g.nbNodes()),
+			en(g.en),
+			in(g.in),
+			out(g.ou),
 			ws(_ws),
-			verbose(false) {}
-Dijkstra::Dijkstra(int _s, vvi_t _en, const vvi_t& _in, vvi_t _ou,
-									 std::vector<std::vector<int> >& _wst, std::vector<int> d)
+			verbose(false),
+			stamp(-1),
+			last_run(0),
+			last_source(-1) {}
+Dijkstra::Dijkstra(int _s, const CSRGraph& g, std::vector<std::vector<int> >& _wst,
+									 std::vector<int> d)
 		: source(_s),
-			nb_nodes(_in.size()),
-			en(std::move(_en)),
-			in(_in),
-			out(std::move(_ou)),
+			nb_nodes(g.nbNodes()),
+			en(g.en),
+			in(g.in),
+			out(g.ou),
 			wst(_wst),
 			job(std::move(d)),
-			verbose(false) {}
+			verbose(false),
+			stamp(-1),
+			last_run(0),
+			last_source(-1) {}
 
 void Dijkstra::run() {
-	q = std::priority_queue<tuple, std::vector<tuple>, Dijkstra::Priority>();
-	std::vector<bool> vis = std::vector<bool>(nb_nodes, false);
+	q.clear();
+	vis.assign(nb_nodes, false);
+	order.clear();
 
-	int count = 0;
-
-	pred = std::vector<int>(nb_nodes, -1);
-	has_kids = std::vector<bool>(nb_nodes, false);
-	cost = std::vector<int>(nb_nodes, -1);
+	pred.assign(nb_nodes, -1);
+	pred_edge.assign(nb_nodes, -1);
+	has_kids.assign(nb_nodes, false);
+	cost.assign(nb_nodes, -1);
 
 	pred[source] = source;
 	cost[source] = duration(source);
-	const tuple initial(source, cost[source]);
-	q.push(initial);
+	q.push(cost[source], source);
 
 	if (verbose) {
 		std::cout << "START" << '\n';
 	}
 
+	search();
+
+	last_source = source;
+	stamp = ++last_run;
+}
+
+void Dijkstra::update() {
+	if (stamp != last_run || source != last_source) {
+		run();
+		return;
+	}
+
+	// A node has to be recomputed if the edge to its parent was removed, or
+	// if its parent has to be recomputed. Parents are visited before their
+	// children, so this can be done in one pass over the visit order. Nodes
+	// reached but never visited (filtered out by enqueue) come last.
+	affected.assign(nb_nodes, false);
+	bool any = false;
+	for (const int u : order) {
+		if (u != source &&
+				(affected[pred[u]] || ignore_edge(pred_edge[u]) || ignore_node(u))) {
+			affected[u] = true;
+			any = true;
+		}
+	}
+	for (int u = 0; u < nb_nodes; u++) {
+		if (!vis[u] && cost[u] != -1 &&
+				(affected[pred[u]] || ignore_edge(pred_edge[u]) || ignore_node(u))) {
+			affected[u] = true;
+			any = true;
+		}
+	}
+	if (!any) {
+		return;
+	}
+
+	int k = 0;
+	for (const int u : order) {
+		if (!affected[u]) {
+			order[k++] = u;
+		}
+	}
+	order.resize(k);
+	for (int u = 0; u < nb_nodes; u++) {
+		if (affected[u]) {
+			vis[u] = false;
+			cost[u] = -1;
+			pred[u] = -1;
+			pred_edge[u] = -1;
+		}
+	}
+
+	// Best entry point of each affected node from the part of the tree
+	// that is still valid
+	q.clear();
+	for (const int u : order) {
+		relax(u, true);
+	}
+
+	search();
+
+	has_kids.assign(nb_nodes, false);
+	for (int u = 0; u < nb_nodes; u++) {
+		if (u != source && pred[u] != -1) {
+			has_kids[pred[u]] = true;
+		}
+	}
+
+	// The tree now depends on the removals made since the last run, so it
+	// must not survive backtracking past them either
+	stamp = ++last_run;
+}
+
+void Dijkstra::search() {
+	int count = static_cast<int>(order.size());
 	while (!q.empty() && count < nb_nodes) {
-		const tuple top = q.top();
-		q.pop();
-		const int curr = top.node;
+		const int curr = q.pop();
 
 		if (vis[curr]) {
 			continue;
@@ -60,6 +138,7 @@ void Dijkstra::run() {
 
 		on_visiting_node(curr);
 		vis[curr] = true;
+		order.push_back(curr);
 		count++;
 
 		if (verbose) {
@@ -67,36 +146,48 @@ void Dijkstra::run() {
 								<< '\n';
 		}
 
-		for (unsigned int i = 0; i < out[curr].size(); i++) {
-			const int e = out[curr][i];
-			assert(en[e][0] == curr);
-			if (ignore_edge(e) || weight(e) < 0) {
-				if (verbose) {
-					std::cout << "Ignoring edge " << e << " from " << en[e][0] << " to " << en[e][1] << '\n';
-				}
-				on_ignore_edge(e);
-				continue;
-			}
-			const int other = en[e][1];  // Head of e
+		relax(curr, false);
+	}
+}
 
-			if (ignore_node(other)) {
-				continue;
-			}
-			if (vis[other]) {
-				continue;
+void Dijkstra::relax(int curr, bool only_affected) {
+	for (const int e : out[curr]) {
+		assert(en[e][0] == curr);
+		const int other = en[e][1];  // Head of e
+		if (only_affected && !affected[other]) {
+			continue;
+		}
+		if (ignore_edge(e) || weight(e) < 0) {
+			if (verbose) {
+				std::cout << "Ignoring edge " << e << " from " << en[e][0] << " to " << en[e][1] << '\n';
 			}
+			on_ignore_edge(e);
+			continue;
+		}
 
-			if (cost[other] == -1 || cost[other] > cost[curr] + weight(e, cost[curr]) + duration(other)) {
-				cost[other] = cost[curr] + weight(e, cost[curr]) + duration(other);
-				assert(cost[other] != -1);
-				pred[other] = curr;
-				has_kids[curr] = true;
-				if (verbose) {
-					std::cout << "Marked " << other << " from " << curr << " of cost " << cost[other] << '\n';
-				}
-				const tuple new_node(other, cost[other]);
-				enqueue(new_node);
+		if (ignore_node(other)) {
+			continue;
+		}
+		if (vis[other]) {
+			continue;
+		}
+
+		const int w = weight(e, cost[curr]);
+		// Keys must not decrease for the radix heap
+		if (w < 0 || cost[curr] + w + duration(other) < cost[curr]) {
+			continue;
+		}
+		if (cost[other] == -1 || cost[other] > cost[curr] + w + duration(other)) {
+			cost[other] = cost[curr] + w + duration(other);
+			assert(cost[other] != -1);
+			pred[other] = curr;
+			pred_edge[other] = e;
+			has_kids[curr] = true;
+			if (verbose) {
+				std::cout << "Marked " << other << " from " << curr << " of cost " << cost[other] << '\n';
 			}
+			const tuple new_node(other, cost[other]);
+			enqueue(new_node);
 		}
 	}
 }
@@ -220,39 +311,37 @@ int main(int argc, char* argv[]) {
 //*/
 
 std::vector<int> DijkstraMandatory::DEFAULT_VECTOR;
-DijkstraMandatory::DijkstraMandatory(int _s, int _d, vvi_t _en, const vvi_t& _in, vvi_t _ou,
-																		 std::vector<int> _ws)
+DijkstraMandatory::DijkstraMandatory(int _s, int _d, const CSRGraph& g, std::vector<int> _ws)
 		: source(_s),
 			dest(_d),
-			nb_nodes(_in.size()),
-			en(std::move(_en)),
-			in(_in),
-			out(std::move(_ou)),
+			nb_nodes(g.nbNodes()),
+			en(g.en),
+			in(g.in),
+			out(g.ou),
 			ws(std::move(_ws)),
-			sccs(new FilteredKosarajuSCC(this, nb_nodes, out, in, en)),
+			sccs(new FilteredKosarajuSCC(this, g)),
 			clustering(nullptr) {
 #ifdef DIJKSTRAMANDATORY_ALLOW_CYCLE
 	// Extra edge from dest to source of cost 0
-	out[dest].push_back(en.size());
-	in[source].push_back(en.size());
-	en.push_back(vector<int>());
-	en[en.size() - 1].push_back(dest);
-	en[en.size() - 1].push_back(source);
+	const CSRGraph cg = g.withEdge(dest, source);
+	en = cg.en;
+	in = cg.in;
+	out = cg.ou;
 	ws.push_back(0);
 
 #endif
 }
-DijkstraMandatory::DijkstraMandatory(int _s, int _d, vvi_t _en, const vvi_t& _in, vvi_t _ou,
+DijkstraMandatory::DijkstraMandatory(int _s, int _d, const CSRGraph& g,
 																		 std::vector<std::vector<int> > _wst, std::vector<int> _ds)
 		: source(_s),
 			dest(_d),
-			nb_nodes(_in.size()),
-			en(std::move(_en)),
-			in(_in),
-			out(std::move(_ou)),
+			nb_nodes(g.nbNodes()),
+			en(g.en),
+			in(g.in),
+			out(g.ou),
 			wst(std::move(_wst)),
 			job(std::move(_ds)),
-			sccs(new FilteredKosarajuSCC(this, nb_nodes, out, in, en)),
+			sccs(new FilteredKosarajuSCC(this, g)),
 			clustering(nullptr) {}
 
 void DijkstraMandatory::init() {
@@ -301,7 +390,7 @@ int DijkstraMandatory::run(bool* ok, bool use_set_target) {
 
 	if (!use_set_target) {  // Create the target bitset here
 
-		target = std::vector<bool>(target.size(), false);
+		target = std::vector<bool>(nb_nodes, false);
 		const std::vector<int>& mands = mandatory_nodes();
 
 #ifdef CLUSTERING
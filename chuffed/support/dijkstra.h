@@ -1,8 +1,10 @@
 #ifndef DIJKSTRA_H
 #define DIJKSTRA_H
 #include "chuffed/core/propagator.h"  //For Tint
+#include "chuffed/support/csr_graph.h"
 #include "chuffed/support/dynamic_kmeans.h"
 #include "chuffed/support/kosaraju_scc.h"
+#include "chuffed/support/radix_heap.h"
 
 #include <bitset>
 #include <cassert>
@@ -15,17 +17,21 @@
 
 class Dijkstra {
 protected:
-	using vvi_t = std::vector<std::vector<int>>;
 	int source;
 	int nb_nodes;
-	vvi_t en;
-	vvi_t in;
-	vvi_t out;
+	CSRLists en;
+	CSRLists in;
+	CSRLists out;
 
 private:
 	std::vector<int> pred;
+	std::vector<int> pred_edge;
 	std::vector<bool> has_kids;
 	std::vector<int> cost;
+	std::vector<bool> vis;
+	// Visited nodes, in the order they were visited
+	std::vector<int> order;
+	std::vector<bool> affected;
 	std::vector<int> ws;
 	std::vector<std::vector<int>> wst;
 	std::vector<int> job;
@@ -44,14 +50,27 @@ public:
 	};
 
 private:
-	std::priority_queue<tuple, std::vector<tuple>, Dijkstra::Priority> q;
+	RadixHeap<int> q;
+
+	// The shortest path tree can be repaired by update() as long as stamp
+	// still holds the id of the last run: stamp is trailed, so backtracking
+	// past that run (and thus possibly restoring edges) invalidates it.
+	Tint stamp;
+	int last_run;
+	int last_source;
+	void search();
+	void relax(int curr, bool only_affected);
 
 public:
-	Dijkstra(int _s, vvi_t _en, const vvi_t& _in, vvi_t _ou, std::vector<int>& _ws);
-	Dijkstra(int _s, vvi_t _en, const vvi_t& _in, vvi_t _ou, std::vector<std::vector<int>>& _wst,
+	Dijkstra(int _s, const CSRGraph& g, std::vector<int>& _ws);
+	Dijkstra(int _s, const CSRGraph& g, std::vector<std::vector<int>>& _wst,
 					 std::vector<int> d = std::vector<int>());
 	virtual ~Dijkstra() = default;
 	void run();
+	// Same result as run(), but if nodes and edges have only been removed
+	// since the last call, only recomputes the subtrees of the shortest path
+	// tree that hang from a removed node or edge.
+	void update();
 
 	virtual void set_source(int s) { source = s; }
 	inline int parentOf(int n) { return pred[n]; }
@@ -62,7 +81,7 @@ public:
 	virtual bool ignore_edge(int /*e*/) { return false; }
 	virtual void on_ignore_edge(int e) {}
 	virtual bool ignore_node(int /*n*/) { return false; }
-	virtual void enqueue(tuple node) { q.push(node); }
+	virtual void enqueue(tuple node) { q.push(node.cost, node.node); }
 	void set_verbose(bool v) { verbose = v; }
 	void print_pred() const;
 	bool is_leaf(int n) const { return !has_kids[n]; }
@@ -92,17 +111,14 @@ public:
 // #define DIJKSTRAMANDATORY_ALLOW_CYCLE
 
 class DijkstraMandatory {
-public:
-	using vvi_t = std::vector<std::vector<int>>;
-
 protected:
 	int source;
 	int dest;
 	int nb_nodes;
 
-	vvi_t en;
-	vvi_t in;
-	vvi_t out;
+	CSRLists en;
+	CSRLists in;
+	CSRLists out;
 
 	std::vector<int> pred;
 	std::vector<int> cost;
@@ -139,9 +155,7 @@ private:
 		DijkstraMandatory* d;
 
 	public:
-		FilteredKosarajuSCC(DijkstraMandatory* _d, int v, std::vector<std::vector<int>> outgoing,
-												std::vector<std::vector<int>> ingoing, std::vector<std::vector<int>> ends)
-				: KosarajuSCC(v, std::move(outgoing), std::move(ingoing), std::move(ends)), d(_d) {}
+		FilteredKosarajuSCC(DijkstraMandatory* _d, const CSRGraph& g) : KosarajuSCC(g), d(_d) {}
 		bool ignore_edge(int e) override { return d->ignore_edge_scc(e); }
 		bool ignore_node(int u) override { return d->ignore_node_scc(u); }
 		bool mandatory_node(int u) override { return d->mandatory_node(u); }
@@ -163,9 +177,9 @@ public:
 	using table_iterator = std::unordered_map<size_t, tuple>::const_iterator;
 	using table_type = std::vector<map_type>;
 
-	DijkstraMandatory(int _s, int _d, vvi_t _en, const vvi_t& _in, vvi_t _ou, std::vector<int> _ws);
-	DijkstraMandatory(int _s, int _d, vvi_t _en, const vvi_t& _in, vvi_t _ou,
-										std::vector<std::vector<int>> _wst, std::vector<int> _ds = std::vector<int>());
+	DijkstraMandatory(int _s, int _d, const CSRGraph& g, std::vector<int> _ws);
+	DijkstraMandatory(int _s, int _d, const CSRGraph& g, std::vector<std::vector<int>> _wst,
+										std::vector<int> _ds = std::vector<int>());
 	virtual void init();
 	virtual ~DijkstraMandatory() = default;
 
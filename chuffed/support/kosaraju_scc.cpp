@@ -8,12 +8,11 @@
 #include <utility>
 #include <vector>
 
-KosarajuSCC::KosarajuSCC(int v, std::vector<std::vector<int> > out,
-												 std::vector<std::vector<int> > in, std::vector<std::vector<int> > en)
-		: nb_nodes(v),
-			outgoing(std::move(out)),
-			ingoing(std::move(in)),
-			ends(std::move(en)),
+KosarajuSCC::KosarajuSCC(const CSRGraph& g)
+		: nb_nodes(g.nbNodes()),
+			outgoing(g.ou),
+			ingoing(g.in),
+			ends(g.en),
 			scc(nb_nodes, -1) {}
 
 // A recursive function to print DFS starting from v
@@ -1,6 +1,8 @@
 #ifndef KOSARAJU_H
 #define KOSARAJU_H
 
+#include "chuffed/support/csr_graph.h"
+
 #include <queue>
 #include <stack>
 #include <string>
@@ -9,10 +11,10 @@
 
 class KosarajuSCC {
 protected:
-	int nb_nodes;                             // No. of vertices
-	std::vector<std::vector<int> > outgoing;  // node-> outgoing edges
-	std::vector<std::vector<int> > ingoing;   // node-> outgoing edgse
-	std::vector<std::vector<int> > ends;      // edge -> endnodes
+	int nb_nodes;       // No. of vertices
+	CSRLists outgoing;  // node-> outgoing edges
+	CSRLists ingoing;   // node-> outgoing edgse
+	CSRLists ends;      // edge -> endnodes
 
 	std::vector<int> scc;
 	std::vector<std::vector<int> > sccs;
@@ -30,8 +32,7 @@ protected:
 	std::vector<int> levels;
 
 public:
-	KosarajuSCC(int v, std::vector<std::vector<int> > outgoing,
-							std::vector<std::vector<int> > ingoing, std::vector<std::vector<int> > ends);
+	KosarajuSCC(const CSRGraph& g);
 
 	virtual ~KosarajuSCC() = default;
 
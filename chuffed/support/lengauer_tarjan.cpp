@@ -1,14 +1,21 @@
 #include "chuffed/support/lengauer_tarjan.h"
 
 #include <iostream>
-#include <utility>
 #include <vector>
 
-std::vector<int> child;
-std::vector<int> size_;
+LengauerTarjan::LengauerTarjan(int r, const CSRGraph& g)
+		: root(r),
+			en(g.en),
+			in(g.in),
+			ou(g.ou),
+			nb_nodes(g.nbNodes()),
+			count(-1),
+			computed(0),
+			dom(nb_nodes, Tint(-1)),
+			depth(nb_nodes, Tint(0)),
+			alive(g.nbEdges(), Tchar(0)) {}
 
-std::vector<std::vector<int> > preds;
-std::vector<std::vector<int> > succs;
+LengauerTarjan::~LengauerTarjan() = default;
 
 void LengauerTarjan::LINK(int v, int w) { ancestor[w] = v; }
 
@@ -21,127 +28,138 @@ int LengauerTarjan::EVAL(int v) {
 }
 
 void LengauerTarjan::COMPRESS(int v) {
-	if (ancestor[v] == -1) {
-		return;
+	// Iterative version of the recursive path compression, from the top of
+	// the path down
+	stack.clear();
+	while (ancestor[ancestor[v]] != -1) {
+		stack.push_back(v);
+		v = ancestor[v];
 	}
-	if (ancestor[ancestor[v]] != -1) {
-		COMPRESS(ancestor[v]);
-		if (semi[label[ancestor[v]]] < semi[label[v]]) {
-			label[v] = label[ancestor[v]];
+	while (!stack.empty()) {
+		const int x = stack.back();
+		stack.pop_back();
+		if (semi[label[ancestor[x]]] < semi[label[x]]) {
+			label[x] = label[ancestor[x]];
 		}
-		ancestor[v] = ancestor[ancestor[v]];
+		ancestor[x] = ancestor[ancestor[x]];
+	}
+}
+
+bool LengauerTarjan::usableEdge(int e) {
+	if (ignore_edge(e)) {
+		return false;
+	}
+	const int o = en[e][1];
+	if (ignore_node(o)) {
+		return false;
 	}
+	return en[e][0] != o;
+}
+
+void LengauerTarjan::buildArcs() {
+	const int nb_arcs = static_cast<int>(arc_src.size());
+	succ_start.assign(nb_nodes + 1, 0);
+	pred_start.assign(nb_nodes + 1, 0);
+	for (int k = 0; k < nb_arcs; k++) {
+		succ_start[arc_src[k] + 1]++;
+		pred_start[arc_dst[k] + 1]++;
+	}
+	for (int i = 0; i < nb_nodes; i++) {
+		succ_start[i + 1] += succ_start[i];
+		pred_start[i + 1] += pred_start[i];
+	}
+	succ.resize(nb_arcs);
+	pred.resize(nb_arcs);
+	for (int k = 0; k < nb_arcs; k++) {
+		succ[succ_start[arc_src[k]]++] = arc_dst[k];
+		pred[pred_start[arc_dst[k]]++] = arc_src[k];
+	}
+	for (int i = nb_nodes; i > 0; i--) {
+		succ_start[i] = succ_start[i - 1];
+		pred_start[i] = pred_start[i - 1];
+	}
+	succ_start[0] = 0;
+	pred_start[0] = 0;
 }
 
 void LengauerTarjan::init() {
-	const int n = in.size();
-	preds = std::vector<std::vector<int> >(n, std::vector<int>());
-	succs = std::vector<std::vector<int> >(n, std::vector<int>());
-	for (int i = 0; i < n; i++) {
-		// succs.push_back(vector<int>());
-		// cout <<"Succs of "<<i<<": ";
-		for (int j = 0; j < ou[i].size(); j++) {
-			const int e = ou[i][j];
-			if (ignore_edge(e)) {
-				continue;
-			}
-			const int o = en[e][1];
-			if (ignore_node(o)) {
-				continue;
-			}
-			if (i != en[ou[i][j]][1]) {
-				succs[i].push_back(en[ou[i][j]][1]);
-				// cout <<en[ou[i][j]][1]<<", ";
+	arc_src.clear();
+	arc_dst.clear();
+	usable.assign(en.size(), 0);
+	for (int i = 0; i < nb_nodes; i++) {
+		for (const int e : ou[i]) {
+			if (usableEdge(e)) {
+				usable[e] = 1;
+				arc_src.push_back(i);
+				arc_dst.push_back(en[e][1]);
 			}
 		}
-		// cout<<endl;
 	}
+	buildArcs();
+}
 
-	parent = std::vector<int>(n, -1);
-	vertex = std::vector<int>(n, -1);
-	semi = std::vector<int>(n, -1);
-	idom = std::vector<int>(n, -1);
-
+void LengauerTarjan::DFS() {
+	parent.assign(nb_nodes, -1);
+	vertex.assign(nb_nodes, -1);
+	semi.assign(nb_nodes, -1);
+	idom.assign(nb_nodes, -1);
+	ancestor.assign(nb_nodes, -1);
+	label.assign(nb_nodes, -1);
+	next_arc.resize(nb_nodes);
 	count = -1;
 
-	ancestor = std::vector<int>(n, -1);
-	label = std::vector<int>(n, -1);
-
-	child = std::vector<int>(n, root);
-	size_ = std::vector<int>(n, 0);
-}
-
-//*
-void LengauerTarjan::DFS(int v) {
-	// cout <<"DFS at "<<v<<endl;
-	count = count + 1;
-	semi[v] = count;
-	vertex[count] = v;
-	// Init vars for step 3 and 4
-	label[v] = v;
-	ancestor[v] = -1;
-	std::vector<int>::iterator it;
-	for (it = succs[v].begin(); it != succs[v].end(); it++) {
-		const int w = *it;
+	stack.clear();
+	count++;
+	semi[root] = count;
+	vertex[count] = root;
+	label[root] = root;
+	next_arc[root] = succ_start[root];
+	stack.push_back(root);
+	while (!stack.empty()) {
+		const int v = stack.back();
+		if (next_arc[v] == succ_start[v + 1]) {
+			stack.pop_back();
+			continue;
+		}
+		const int w = succ[next_arc[v]++];
 		if (semi[w] == -1) {
 			parent[w] = v;
-			DFS(w);
+			count++;
+			semi[w] = count;
+			vertex[count] = w;
+			label[w] = w;
+			next_arc[w] = succ_start[w];
+			stack.push_back(w);
 		}
-		preds[w].push_back(v);
 	}
 }
 
-//*/
-//* //It is a mystery why this causes a bug in the instance
-// complete_15_7_true_152
-
-void LengauerTarjan::find_doms() {
-	// for (int i = 0; i < preds.size(); i++) {
-	//     cout <<"Preds of "<<i<<": ";
-	//     for (int j = 0; j < preds[i].size(); j++) {
-	//             cout <<preds[i][j]<<", ";
-	//     }
-	//     cout<<endl;
-	// }
-	// cout << "Semi ";
-	// for (int i = 0; i < in.size(); i++)
-	//     cout <<"("<<i <<","<< semi[i]<<") ";
-	// cout<<endl;
-	// cout << "vertex ";
-	// for (int i = 0; i < in.size(); i++)
-	//     cout <<"("<<i <<","<< vertex[i]<<") ";
-	// cout<<endl;
-	// cout << "label ";
-	// for (int i = 0; i < in.size(); i++)
-	//     cout <<"("<<i <<","<< label[i]<<") ";
-	// cout<<endl;
-	// cout << "parent ";
-	// for (int i = 0; i < in.size(); i++)
-	//     cout <<"("<<i <<","<< parent[i]<<") ";
-	// cout<<endl;
-	// cout <<"count "<<count<<endl;
-
-	std::vector<std::vector<int> > buckets =
-			std::vector<std::vector<int> >(in.size(), std::vector<int>());
+void LengauerTarjan::dominators() {
+	bucket_head.assign(nb_nodes, -1);
+	bucket_next.resize(nb_nodes);
 
 	for (int i = count; i >= 1; i--) {
 		const int w = vertex[i];
-		std::vector<int>::iterator it;
-		for (it = preds[w].begin(); it != preds[w].end(); it++) {
-			const int v = *it;
+		for (int k = pred_start[w]; k < pred_start[w + 1]; k++) {
+			const int v = pred[k];
+			if (semi[v] == -1) {
+				continue;  // Unreached predecessor
+			}
 			const int u = EVAL(v);
 			if (semi[u] < semi[w]) {
 				semi[w] = semi[u];
 			}
 		}
-		buckets[vertex[semi[w]]].push_back(w);
-		LINK(parent[w], w);
-		for (it = buckets[parent[w]].begin(); it != buckets[parent[w]].end(); it++) {
-			const int v = *it;
+		const int s = vertex[semi[w]];
+		bucket_next[w] = bucket_head[s];
+		bucket_head[s] = w;
+		const int pw = parent[w];
+		LINK(pw, w);
+		for (int v = bucket_head[pw]; v != -1; v = bucket_next[v]) {
 			const int u = EVAL(v);
-			idom[v] = (semi[u] < semi[v]) ? u : parent[w];
+			idom[v] = (semi[u] < semi[v]) ? u : pw;
 		}
-		buckets[parent[w]].clear();
+		bucket_head[pw] = -1;
 	}
 
 	for (int i = 1; i <= count; i++) {
@@ -151,97 +169,142 @@ void LengauerTarjan::find_doms() {
 		}
 	}
 	idom[root] = root;
-
-}  //*/
-
-std::vector<int> bucket;
-void addToBucket(int buckIdx, int element) {
-	if (bucket[buckIdx] == -1) {
-		bucket[buckIdx] = element;
-	} else {
-		const int old = bucket[buckIdx];
-		bucket[buckIdx] = element;
-		bucket[element] = old;
-	}
 }
 
-/*
-// Implementation from Choco3 by cprudhom
-void LengauerTarjan::find_doms() {
-		int n = count + 1;//in.size();
-		bucket = vector<int>(in.size(),-1);
-		int w, v, u;
-		for (int i = n - 1; i >= 1; i--) {
-				w = vertex[i];
-				for (unsigned int j = 0; j < in[w].size(); j++) {
-						if (ignore_edge(in[w][j]))
-								continue;
-						v = en[in[w][j]][0];//pred
-						if (ignore_node(v))
-								continue;
-						u = EVAL(v);
-						if (semi[u] < semi[w]) {
-								semi[w] = semi[u];
-						}
-				}
-				if (vertex[semi[w]] != parent[w]) {
-						addToBucket(vertex[semi[w]], w);
-				} else {
-						idom[w] = parent[w];
-				}
-				LINK(parent[w], w);
-				int oldBI = parent[w];
-				v = bucket[oldBI];
-				while (v != -1) {
-						bucket[oldBI] = -1;
-						u = EVAL(v);
-						if (semi[u] < semi[v]) {
-								idom[v] = u;
-						} else {
-								idom[v] = parent[w];
-						}
-						oldBI = v;
-						v = bucket[v];
-				}
+void LengauerTarjan::commit(bool all) {
+	if (all) {
+		for (int u = 0; u < nb_nodes; u++) {
+			const int d = semi[u] != -1 ? idom[u] : -1;
+			if (dom[u] != d) {
+				dom[u] = d;
+			}
+		}
+		for (int e = 0; e < en.size(); e++) {
+			const char a = static_cast<char>(usable[e] != 0 && semi[en[e][0]] != -1);
+			if (alive[e] != a) {
+				alive[e] = a;
+			}
+		}
+		if (computed == 0) {
+			computed = 1;
+		}
+	} else {
+		for (const int u : affected_list) {
+			const int d = semi[u] != -1 ? idom[u] : -1;
+			if (dom[u] != d) {
+				dom[u] = d;
+			}
 		}
-		for (int i = 1; i < n; i++) {
-				w = vertex[i];
-				if (idom[w] != vertex[semi[w]]) {
-						idom[w] = idom[idom[w]];
-				}
+	}
+	// Dominators come before the nodes they dominate in DFS order
+	for (int i = 1; i <= count; i++) {
+		const int w = vertex[i];
+		if (all || affected[w] != 0) {
+			const int d = depth[idom[w]] + 1;
+			if (depth[w] != d) {
+				depth[w] = d;
+			}
 		}
-		idom[root] = root;
+	}
 }
-//*/
 
-LengauerTarjan::LengauerTarjan(int r, vvi_t _en, vvi_t _in, vvi_t _ou)
-		: root(r), en(std::move(_en)), in(std::move(_in)), ou(std::move(_ou)) {
-	// init();
+void LengauerTarjan::find_doms() {
+	dominators();
+	commit(true);
 }
 
-LengauerTarjan::~LengauerTarjan() = default;
-
 void LengauerTarjan::run(int /*root*/) {
 	init();
 	DFS();
+	find_doms();
+}
+
+bool LengauerTarjan::dominates(int u, int v) const {
+	while (depth[v] > depth[u]) {
+		v = dom[v];
+	}
+	return u == v;
+}
 
-	/*for (int i = 0; i <= count; i++) {
-		cout << "("<<i<<","<<semi[i] <<") ";
+void LengauerTarjan::update() {
+	if (computed == 0) {
+		run(root);
+		return;
+	}
+
+	// Edges of the last graph that are gone. A path through such an edge
+	// (x,y) where y dominates x already went through y, so only the other
+	// ones can change anything, and only for the nodes reachable from y.
+	affected.assign(nb_nodes, 0);
+	affected_list.clear();
+	gone.clear();
+	int nb_reached = 0;
+	for (int x = 0; x < nb_nodes; x++) {
+		if (dom[x] == -1) {
+			continue;
 		}
-		cout <<endl;
-	*/
-	find_doms();
-	/*
-		for (int i = 0; i <= count; i++) {
-		cout << "("<<i<<","<<idom[i] <<") ";
+		nb_reached++;
+		for (const int e : ou[x]) {
+			if (alive[e] == 0 || usableEdge(e)) {
+				continue;
+			}
+			gone.push_back(e);
+			const int y = en[e][1];
+			if (affected[y] == 0 && !dominates(y, x)) {
+				affected[y] = 1;
+				affected_list.push_back(y);
+			}
+		}
+	}
+	for (int k = 0; k < static_cast<int>(affected_list.size()); k++) {
+		for (const int e : ou[affected_list[k]]) {
+			const int y = en[e][1];
+			if (alive[e] != 0 && affected[y] == 0) {
+				affected[y] = 1;
+				affected_list.push_back(y);
+			}
 		}
-		cout <<endl;
-	*/
+	}
+	for (const int e : gone) {
+		alive[e] = 0;
+	}
+	if (affected_list.empty()) {
+		return;
+	}
+	if (2 * static_cast<int>(affected_list.size()) > nb_reached) {
+		run(root);
+		return;
+	}
+
+	// The dominators of the other nodes did not change, and replacing the
+	// edges between them by their dominator tree keeps all the dominators
+	// of the graph. What is left to compute is small.
+	arc_src.clear();
+	arc_dst.clear();
+	for (int u = 0; u < nb_nodes; u++) {
+		if (u != root && dom[u] != -1 && affected[u] == 0) {
+			arc_src.push_back(dom[u]);
+			arc_dst.push_back(u);
+		}
+	}
+	for (const int w : affected_list) {
+		for (const int e : in[w]) {
+			const int v = en[e][0];
+			if (dom[v] != -1 && alive[e] != 0) {
+				arc_src.push_back(v);
+				arc_dst.push_back(w);
+			}
+		}
+	}
+	buildArcs();
+	DFS();
+	dominators();
+	commit(false);
 }
 
-bool LengauerTarjan::visited_dfs(int u) { return semi[u] != -1; }
+bool LengauerTarjan::visited_dfs(int u) { return dom[u] != -1; }
 
-int LengauerTarjan::dominator(int u) { return idom[u]; }
+int LengauerTarjan::dominator(int u) { return dom[u]; }
 
 bool LengauerTarjan::ignore_node(int /*u*/) {
 	// return u==13;
@@ -331,7 +394,7 @@ void ex1() {
 	ou[10].push_back(14);
 	ou[11].push_back(15);
 
-	LengauerTarjan lt = LengauerTarjan(12, endnodes, in, ou);
+	LengauerTarjan lt = LengauerTarjan(12, CSRGraph(CSRLists(endnodes), CSRLists(in), CSRLists(ou)));
 	lt.run(12);
 
 	const std::vector<bool> vis(in.size(), false);
@@ -1,6 +1,9 @@
 #ifndef LENGAUER_TARJAN_H
 #define LENGAUER_TARJAN_H
 
+#include "chuffed/core/engine.h"
+#include "chuffed/support/csr_graph.h"
+
 #include <vector>
 
 class LengauerTarjan {
@@ -18,10 +21,20 @@ class LengauerTarjan {
 
 private:
 	int root;
-	using vvi_t = std::vector<std::vector<int>>;
-	vvi_t en;
-	vvi_t in;
-	vvi_t ou;
+	CSRLists en;
+	CSRLists in;
+	CSRLists ou;
+	int nb_nodes;
+
+	// Graph the algorithm runs on: either the filtered graph, or the derived
+	// graph built by update(). Adjacency in CSR form.
+	std::vector<int> arc_src;
+	std::vector<int> arc_dst;
+	std::vector<int> succ_start;
+	std::vector<int> succ;
+	std::vector<int> pred_start;
+	std::vector<int> pred;
+	std::vector<char> usable;  // Per edge, for the filtered graph
 
 	std::vector<int> parent;
 	std::vector<int> vertex;
@@ -32,21 +45,42 @@ private:
 
 	std::vector<int> ancestor;
 	std::vector<int> label;
+	std::vector<int> bucket_head;
+	std::vector<int> bucket_next;
+	std::vector<int> next_arc;
+	std::vector<int> stack;
+
+	// Result of the last computation. It is trailed, so that after
+	// backtracking it describes a supergraph of the current graph, which is
+	// all update() needs.
+	Tchar computed;
+	std::vector<Tint> dom;    // Immediate dominator, -1 if unreached
+	std::vector<Tint> depth;  // Depth in the dominator tree
+	std::vector<Tchar> alive;  // Whether the edge was in the graph
+	std::vector<char> affected;
+	std::vector<int> affected_list;
+	std::vector<int> gone;
 
 	void LINK(int v, int w);
 	int EVAL(int v);
 	void COMPRESS(int v);
 
-protected:
-	virtual void DFS(int v);
+	bool usableEdge(int e);
+	void buildArcs();
+	bool dominates(int u, int v) const;
+	void dominators();
+	void commit(bool all);
 
 public:
 	virtual void init();
-	virtual void DFS() { DFS(root); };
+	virtual void DFS();
 	virtual void find_doms();
-	LengauerTarjan(int r, vvi_t _en, vvi_t _in, vvi_t _ou);
+	LengauerTarjan(int r, const CSRGraph& g);
 	virtual ~LengauerTarjan();
 	virtual void run(int root);
+	// Same result as run(), but only recomputes the part of the dominator tree
+	// that the edges and nodes removed since the last computation can change
+	virtual void update();
 	virtual bool visited_dfs(int u);
 	virtual int dominator(int u);
 	virtual bool ignore_node(int u);
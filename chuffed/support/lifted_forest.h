@@ -0,0 +1,147 @@
+#ifndef LIFTED_FOREST_H
+#define LIFTED_FOREST_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+// A spanning forest, rooted, with binary lifting tables so that path queries
+// (heaviest edge, largest edge key) take O(log n) instead of walking the path.
+// W is the type of the edge weights.
+template <class W>
+class LiftedForest {
+	int nb_nodes;
+	int nb_levels;
+	const std::vector<W>* weight;
+
+	std::vector<std::vector<int> > adj;
+	std::vector<int> depth_;
+	std::vector<int> comp_;
+	std::vector<int> parent_edge;
+	std::vector<int> stack;
+	std::vector<std::vector<int> > up;      // up[k][u]: 2^k-th ancestor of u
+	std::vector<std::vector<int> > up_max;  // heaviest edge on that jump
+	std::vector<std::vector<int> > up_key;  // largest edge key on that jump
+
+	int heavier(int e1, int e2) const {
+		if (e1 == -1) {
+			return e2;
+		}
+		if (e2 == -1) {
+			return e1;
+		}
+		return (*weight)[e2] > (*weight)[e1] ? e2 : e1;
+	}
+
+public:
+	explicit LiftedForest(int n)
+			: nb_nodes(n),
+				nb_levels(1),
+				weight(nullptr),
+				adj(n),
+				depth_(n),
+				comp_(n),
+				parent_edge(n) {
+		while ((1 << nb_levels) < nb_nodes) {
+			nb_levels++;
+		}
+		up.assign(nb_levels, std::vector<int>(nb_nodes));
+		up_max.assign(nb_levels, std::vector<int>(nb_nodes));
+		up_key.assign(nb_levels, std::vector<int>(nb_nodes));
+	}
+
+	// Roots every tree of the forest made of the edges e with in_forest[e],
+	// where edge e joins ends[e][0] and ends[e][1]. The weights decide which
+	// edge of a path is the heaviest, and must outlive the forest; keys are
+	// maximised over paths, -1 being the neutral key.
+	template <class Ends>
+	void build(const Ends& ends, const std::vector<bool>& in_forest, const std::vector<W>& w,
+						 const std::vector<int>& key) {
+		weight = &w;
+		for (int u = 0; u < nb_nodes; u++) {
+			adj[u].clear();
+			comp_[u] = -1;
+		}
+		for (int e = 0; e < static_cast<int>(in_forest.size()); e++) {
+			if (in_forest[e]) {
+				adj[ends[e][0]].push_back(e);
+				adj[ends[e][1]].push_back(e);
+			}
+		}
+		for (int r = 0; r < nb_nodes; r++) {
+			if (comp_[r] != -1) {
+				continue;
+			}
+			comp_[r] = r;
+			depth_[r] = 0;
+			parent_edge[r] = -1;
+			up[0][r] = r;
+			stack.push_back(r);
+			while (!stack.empty()) {
+				const int u = stack.back();
+				stack.pop_back();
+				for (const int e : adj[u]) {
+					if (e == parent_edge[u]) {
+						continue;
+					}
+					const int v = ends[e][0] == u ? ends[e][1] : ends[e][0];
+					comp_[v] = r;
+					depth_[v] = depth_[u] + 1;
+					parent_edge[v] = e;
+					up[0][v] = u;
+					stack.push_back(v);
+				}
+			}
+		}
+		for (int u = 0; u < nb_nodes; u++) {
+			up_max[0][u] = parent_edge[u];
+			up_key[0][u] = parent_edge[u] == -1 ? -1 : key[parent_edge[u]];
+		}
+		for (int k = 1; k < nb_levels; k++) {
+			for (int u = 0; u < nb_nodes; u++) {
+				const int mid = up[k - 1][u];
+				up[k][u] = up[k - 1][mid];
+				up_max[k][u] = heavier(up_max[k - 1][u], up_max[k - 1][mid]);
+				up_key[k][u] = std::max(up_key[k - 1][u], up_key[k - 1][mid]);
+			}
+		}
+	}
+
+	int comp(int u) const { return comp_[u]; }
+	int depth(int u) const { return depth_[u]; }
+	int parent(int u) const { return up[0][u]; }
+	int parentEdge(int u) const { return parent_edge[u]; }
+
+	// Lowest common ancestor of u and v (in the same tree), with the heaviest
+	// edge and the largest key on the path between them
+	int pathQuery(int u, int v, int& max_e, int& max_key) const {
+		max_e = -1;
+		max_key = -1;
+		if (depth_[u] < depth_[v]) {
+			std::swap(u, v);
+		}
+		for (int k = nb_levels - 1; k >= 0; k--) {
+			if (depth_[u] - (1 << k) >= depth_[v]) {
+				max_e = heavier(max_e, up_max[k][u]);
+				max_key = std::max(max_key, up_key[k][u]);
+				u = up[k][u];
+			}
+		}
+		if (u == v) {
+			return u;
+		}
+		for (int k = nb_levels - 1; k >= 0; k--) {
+			if (up[k][u] != up[k][v]) {
+				max_e = heavier(max_e, heavier(up_max[k][u], up_max[k][v]));
+				max_key = std::max(max_key, std::max(up_key[k][u], up_key[k][v]));
+				u = up[k][u];
+				v = up[k][v];
+			}
+		}
+		max_e = heavier(max_e, heavier(up_max[0][u], up_max[0][v]));
+		max_key = std::max(max_key, std::max(up_key[0][u], up_key[0][v]));
+		return up[0][u];
+	}
+};
+
+#endif
@@ -99,6 +99,43 @@ static inline int bitcount(T s) {
 	return c;
 }
 
+// Index of the least significant set bit, s must be non-zero
+static inline int lowestBit(uint64_t s) {
+	assert(s != 0);
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(s);
+#else
+	int i = 0;
+	while (!(s & 1)) {
+		s >>= 1;
+		i++;
+	}
+	return i;
+#endif
+}
+
+// Index of the most significant set bit, s must be non-zero
+static inline int highestBit(uint64_t s) {
+	assert(s != 0);
+#if defined(__GNUC__) || defined(__clang__)
+	return 63 - __builtin_clzll(s);
+#else
+	int i = 0;
+	while (s >>= 1) {
+		i++;
+	}
+	return i;
+#endif
+}
+
+static inline int popcount64(uint64_t s) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_popcountll(s);
+#else
+	return bitcount<uint64_t>(s);
+#endif
+}
+
 static inline double wallClockTime() {
 #ifdef WIN32
 	static const unsigned __int64 epoch = ((unsigned __int64)116444736000000000ULL);
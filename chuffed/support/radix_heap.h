@@ -0,0 +1,80 @@
+#ifndef RADIX_HEAP_H
+#define RADIX_HEAP_H
+
+#include "chuffed/support/misc.h"
+
+#include <cassert>
+#include <utility>
+#include <vector>
+
+// Monotone priority queue over non-negative integer keys. The keys pushed must
+// never be smaller than the key of the last element popped, which is always the
+// case in Dijkstra's algorithm with non-negative weights.
+//
+// Element with key k sits in bucket 0 if k equals the last popped key, and in
+// bucket i+1 otherwise, where i is the highest bit in which k differs from it.
+// Pop only redistributes the first non-empty bucket, and every element moves to
+// a lower bucket each time, so push and pop are amortised O(log C) where C is the
+// largest key, with no comparisons between elements.
+template <class T>
+class RadixHeap {
+	static const int NB_BUCKETS = 33;
+
+	std::vector<std::pair<unsigned int, T> > buckets[NB_BUCKETS];
+	unsigned int last;
+	int count;
+
+	int bucketOf(unsigned int key) const {
+		return key == last ? 0 : highestBit(key ^ last) + 1;
+	}
+
+public:
+	RadixHeap() : last(0), count(0) {}
+
+	bool empty() const { return count == 0; }
+	int size() const { return count; }
+	// Key of the last element popped
+	unsigned int lastKey() const { return last; }
+
+	void clear() {
+		for (auto& b : buckets) {
+			b.clear();
+		}
+		last = 0;
+		count = 0;
+	}
+
+	void push(unsigned int key, const T& val) {
+		assert(key >= last);
+		buckets[bucketOf(key)].emplace_back(key, val);
+		count++;
+	}
+
+	// Remove and return an element of minimum key
+	T pop() {
+		assert(count > 0);
+		if (buckets[0].empty()) {
+			int i = 1;
+			while (buckets[i].empty()) {
+				i++;
+			}
+			unsigned int m = buckets[i][0].first;
+			for (const auto& x : buckets[i]) {
+				if (x.first < m) {
+					m = x.first;
+				}
+			}
+			last = m;
+			for (const auto& x : buckets[i]) {
+				buckets[bucketOf(x.first)].push_back(x);
+			}
+			buckets[i].clear();
+		}
+		const T val = buckets[0].back().second;
+		buckets[0].pop_back();
+		count--;
+		return val;
+	}
+};
+
+#endif
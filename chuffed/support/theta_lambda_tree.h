@@ -0,0 +1,141 @@
+#ifndef THETA_LAMBDA_TREE_H
+#define THETA_LAMBDA_TREE_H
+
+#include "chuffed/support/vec.h"
+
+#include <cassert>
+#include <cstdint>
+
+//=================================================================================================
+// Theta-Lambda tree (Vilim) over a fixed sequence of leaves.
+//
+// Every leaf may hold a value 'v' and an energy 'e'.  A leaf is either
+// - empty,
+// - a begin leaf (only the value counts),
+// - a Theta leaf (value and energy count), or
+// - a gray leaf (the value counts, the energy only for the gray envelope), or
+// - a Lambda leaf (value and energy count only for the gray envelope).
+// The tree maintains
+//   env()     = max over non-empty leaves k of v_k + sum of Theta energies at positions >= k
+//   envGray() = the same, where the energy of at most one gray leaf at a position >= k is
+//               added as well.
+// For the disjunctive edge-finding v is the est and e the processing time of a task, so that
+// env() is the earliest completion time of Theta.  For energetic reasoning on a resource of
+// capacity C, v is C * est and e the energy of a task.
+
+class ThetaLambdaTree {
+public:
+	static const int64_t NONE = INT64_MIN / 4;
+
+	ThetaLambdaTree() : size(0) {}
+
+	// Resets the tree to 'n' empty leaves
+	void reset(int n) {
+		size = 1;
+		while (size < n) {
+			size <<= 1;
+		}
+		nodes.growTo(2 * size);
+		for (int i = 1; i < 2 * size; i++) {
+			nodes[i] = Node();
+		}
+	}
+
+	void setBegin(int pos, int64_t v) { setLeaf(pos, v, 0, NONE); }
+	void setTheta(int pos, int64_t v, int64_t e) { setLeaf(pos, v, e, NONE); }
+	void setGray(int pos, int64_t v, int64_t g) { setLeaf(pos, v, 0, g); }
+	void setLambda(int pos, int64_t v, int64_t g) { setLeaf(pos, v, 0, g, false); }
+	void clear(int pos) { setLeaf(pos, NONE, 0, NONE); }
+
+	int64_t env() const { return nodes[1].env; }
+	int64_t envGray() const { return nodes[1].env_g; }
+	bool isGray(int pos) const { return nodes[size + pos].gray; }
+
+	// Leaf responsible for env()
+	int envLeaf() const {
+		assert(env() > NONE);
+		int i = 1;
+		while (i < size) {
+			i = (nodes[i].env == nodes[2 * i + 1].env) ? 2 * i + 1 : 2 * i;
+		}
+		return i - size;
+	}
+
+	// Leaves responsible for envGray(): the leaf 'begin' where the envelope starts
+	// and the gray leaf 'gray' whose energy is counted.  Requires envGray() > env().
+	void envGrayLeaves(int& begin, int& gray) const {
+		assert(envGray() > env());
+		int i = 1;
+		while (i < size) {
+			const Node& n = nodes[i];
+			const Node& l = nodes[2 * i];
+			const Node& r = nodes[2 * i + 1];
+			if (n.env_g == r.env_g) {
+				i = 2 * i + 1;
+			} else if (n.env_g == l.env + r.sum_g) {
+				begin = envLeafFrom(2 * i);
+				gray = sumGrayLeafFrom(2 * i + 1);
+				return;
+			} else {
+				assert(n.env_g == l.env_g + r.sum);
+				i = 2 * i;
+			}
+		}
+		assert(nodes[i].gray);
+		begin = i - size;
+		gray = i - size;
+	}
+
+private:
+	struct Node {
+		int64_t sum{0};      // Sum of the Theta energies
+		int64_t env{NONE};   // Envelope of Theta
+		int64_t sum_g{0};    // Sum of the energies with at most one gray leaf
+		int64_t env_g{NONE};  // Envelope with at most one gray leaf
+		bool gray{false};
+	};
+
+	int size;
+	vec<Node> nodes;
+
+	static inline int64_t max(int64_t a, int64_t b) { return a < b ? b : a; }
+
+	void setLeaf(int pos, int64_t v, int64_t e, int64_t g, bool begin = true) {
+		assert(0 <= pos && pos < size);
+		int i = size + pos;
+		Node& leaf = nodes[i];
+		leaf.gray = (g != NONE);
+		leaf.sum = e;
+		leaf.env = (v == NONE || !begin ? NONE : v + e);
+		leaf.sum_g = (leaf.gray ? g : e);
+		leaf.env_g = (v == NONE ? NONE : v + leaf.sum_g);
+		for (i >>= 1; i >= 1; i >>= 1) {
+			Node& n = nodes[i];
+			const Node& l = nodes[2 * i];
+			const Node& r = nodes[2 * i + 1];
+			n.sum = l.sum + r.sum;
+			n.env = max(r.env, l.env + r.sum);
+			n.sum_g = max(l.sum_g + r.sum, l.sum + r.sum_g);
+			n.env_g = max(r.env_g, max(l.env_g + r.sum, l.env + r.sum_g));
+		}
+	}
+
+	int envLeafFrom(int i) const {
+		while (i < size) {
+			i = (nodes[i].env == nodes[2 * i + 1].env) ? 2 * i + 1 : 2 * i;
+		}
+		return i - size;
+	}
+
+	int sumGrayLeafFrom(int i) const {
+		while (i < size) {
+			const Node& l = nodes[2 * i];
+			const Node& r = nodes[2 * i + 1];
+			i = (nodes[i].sum_g == l.sum + r.sum_g) ? 2 * i + 1 : 2 * i;
+		}
+		assert(nodes[i].gray);
+		return i - size;
+	}
+};
+
+#endif